@@ -0,0 +1,719 @@
+#include "ikcp.h"
+#include "kcp_client_pool.h"
+#include "kcp_histogram.h"
+#include "kcp_log.h"
+#include "kcp_server.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * KCP基准测试
+ * 在同一进程、同一事件循环中运行服务器、N个客户端和一个丢包/延迟注入代理：
+ *
+ *   KCPClientPool(N个会话)  <-->  ImpairmentProxy（丢包、延迟、抖动）  <-->  KCPServer（回显）
+ *
+ * 所有客户端会话共享一个UDP socket和调度时间轮，--clients可以设置到数万。
+ * 每个客户端保持固定数量的在途消息（闭环），收到回显后立即发送下一条，
+ * 消息头部携带发送时间戳用于计算往返延迟。
+ * 对 预设KCP参数 x 消息长度 x 丢包率 的组合逐一测试，结果以JSON或CSV输出到stdout，
+ * 便于长期跟踪性能回归；可读的进度信息输出到stderr。
+ *
+ * 用法：kcp_bench [--presets=normal,fast,turbo,adaptive] [--sizes=64,1024,8192]
+ *                 [--loss=0,1,5] [--delay=5] [--jitter=0] [--clients=4]
+ *                 [--window=16] [--duration=2000] [--format=json|csv]
+ */
+
+/**
+ * 获取当前时间戳（微秒，单调时钟）
+ */
+static uint64_t now_us() {
+  auto now = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             now.time_since_epoch())
+      .count();
+}
+
+/**
+ * 获取进程累计CPU时间（用户态+内核态，微秒）
+ */
+static uint64_t cpu_us() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+         usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/**
+ * 获取系统UDP接收缓冲区溢出丢包计数（Linux /proc/net/snmp的RcvbufErrors）
+ * 回环上的突发流量可能因为套接字接收缓冲区不足而被内核丢弃，
+ * 即使没有注入丢包也会产生重传，单独统计便于区分；不可用时返回0
+ */
+static uint64_t udp_rcvbuf_errors() {
+  FILE *fp = fopen("/proc/net/snmp", "r");
+  if (fp == nullptr) {
+    return 0;
+  }
+
+  // 格式：第一行"Udp:"为字段名，第二行"Udp:"为对应数值
+  char names[512], values[512];
+  uint64_t result = 0;
+  while (fgets(names, sizeof(names), fp) != nullptr) {
+    if (strncmp(names, "Udp:", 4) != 0) {
+      continue;
+    }
+    if (fgets(values, sizeof(values), fp) == nullptr) {
+      break;
+    }
+    char *name_save = nullptr, *value_save = nullptr;
+    char *name = strtok_r(names, " \n", &name_save);
+    char *value = strtok_r(values, " \n", &value_save);
+    while (name != nullptr && value != nullptr) {
+      if (strcmp(name, "RcvbufErrors") == 0) {
+        result = strtoull(value, nullptr, 10);
+        break;
+      }
+      name = strtok_r(nullptr, " \n", &name_save);
+      value = strtok_r(nullptr, " \n", &value_save);
+    }
+    break;
+  }
+  fclose(fp);
+  return result;
+}
+
+/**
+ * KCP参数预设
+ */
+struct Preset {
+  const char *name;
+  int nodelay;
+  int interval;
+  int resend;
+  int nc;
+  int sndwnd;
+  int rcvwnd;
+  bool adaptive; // 是否启用参数自适应调节（以上参数作为初始值）
+};
+
+static const Preset kPresets[] = {
+    {"normal", 0, 40, 0, 0, 32, 128, false}, // 普通模式：关闭nodelay，40ms间隔，有拥塞控制
+    {"fast", 0, 20, 2, 1, 128, 128, false},  // 快速模式：20ms间隔，快速重传，无拥塞控制
+    {"turbo", 1, 10, 2, 1, 128, 128, false}, // 极速模式：nodelay，10ms间隔
+    {"adaptive", 1, 10, 2, 1, 128, 1024, true}, // 自适应：从极速模式出发在线调整，接收窗口留出增长空间
+};
+
+/**
+ * 丢包/延迟注入代理
+ * 前端套接字面向客户端，后端套接字面向服务器，按conv记录客户端地址用于回程路由
+ * 每个方向独立按概率丢包，未丢弃的数据包在 delay ± jitter 毫秒后转发
+ * （抖动会导致乱序，与netem的行为一致）
+ */
+class ImpairmentProxy {
+public:
+  ImpairmentProxy(uv_loop_t *loop)
+      : loop_(loop), loss_(0), delay_us_(0), jitter_us_(0), seq_(0),
+        rng_(12345), forwarded_(0), dropped_(0) {
+    memset(&server_addr_, 0, sizeof(server_addr_));
+    front_.data = this;
+    back_.data = this;
+    timer_.data = this;
+  }
+
+  /**
+   * 启动代理
+   * @param server_addr - 服务器地址
+   * @return 代理前端端口，<0表示失败
+   */
+  int start(const struct sockaddr_in &server_addr) {
+    server_addr_ = server_addr;
+
+    struct sockaddr_in addr;
+    uv_ip4_addr("127.0.0.1", 0, &addr);
+    uv_udp_init(loop_, &front_);
+    uv_udp_init(loop_, &back_);
+    int ret = uv_udp_bind(&front_, (const struct sockaddr *)&addr, 0);
+    if (ret < 0) {
+      return ret;
+    }
+    ret = uv_udp_bind(&back_, (const struct sockaddr *)&addr, 0);
+    if (ret < 0) {
+      return ret;
+    }
+    // 代理汇聚所有流量，尽量增大接收缓冲区（受net.core.rmem_max限制）
+    int buffer_size = 4 * 1024 * 1024;
+    uv_recv_buffer_size((uv_handle_t *)&front_, &buffer_size);
+    buffer_size = 4 * 1024 * 1024;
+    uv_recv_buffer_size((uv_handle_t *)&back_, &buffer_size);
+
+    uv_udp_recv_start(&front_, alloc_buffer, on_front_recv);
+    uv_udp_recv_start(&back_, alloc_buffer, on_back_recv);
+
+    // 1ms精度投递延迟队列
+    uv_timer_init(loop_, &timer_);
+    uv_timer_start(&timer_, on_timer, 1, 1);
+
+    struct sockaddr_in bound;
+    int namelen = sizeof(bound);
+    uv_udp_getsockname(&front_, (struct sockaddr *)&bound, &namelen);
+    return ntohs(bound.sin_port);
+  }
+
+  /**
+   * 设置损伤参数
+   * @param loss - 每个方向的丢包概率（0-1）
+   * @param delay_ms - 单向固定延迟
+   * @param jitter_ms - 单向延迟抖动（均匀分布，±jitter_ms）
+   */
+  void set_impairment(double loss, uint32_t delay_ms, uint32_t jitter_ms) {
+    loss_ = loss;
+    delay_us_ = (uint64_t)delay_ms * 1000;
+    jitter_us_ = (uint64_t)jitter_ms * 1000;
+  }
+
+  /**
+   * 清空路由表和延迟队列（丢弃上一轮残留的数据包）
+   */
+  void reset() {
+    routes_.clear();
+    while (!queue_.empty()) {
+      queue_.pop();
+    }
+    forwarded_ = 0;
+    dropped_ = 0;
+  }
+
+  uint64_t get_forwarded() const { return forwarded_; }
+  uint64_t get_dropped() const { return dropped_; }
+
+private:
+  // 延迟队列中的数据包
+  struct Packet {
+    uint64_t due;              // 投递时间（微秒）
+    uint64_t seq;              // 入队序号（同一时刻按入队顺序投递）
+    bool to_server;            // 转发方向
+    struct sockaddr_in target; // 目标地址（回程方向使用）
+    std::string data;
+  };
+
+  struct PacketLater {
+    bool operator()(const Packet &a, const Packet &b) const {
+      return a.due != b.due ? a.due > b.due : a.seq > b.seq;
+    }
+  };
+
+  static void alloc_buffer(uv_handle_t *handle, size_t suggested_size,
+                           uv_buf_t *buf) {
+    ImpairmentProxy *proxy = static_cast<ImpairmentProxy *>(handle->data);
+    buf->base = proxy->buffer_;
+    buf->len = sizeof(proxy->buffer_);
+  }
+
+  static void on_front_recv(uv_udp_t *handle, ssize_t nread,
+                            const uv_buf_t *buf, const struct sockaddr *addr,
+                            unsigned flags) {
+    ImpairmentProxy *proxy = static_cast<ImpairmentProxy *>(handle->data);
+    if (nread < kKcpHeaderSize || addr == nullptr) {
+      return;
+    }
+    uint32_t conv = ikcp_getconv(buf->base);
+    proxy->routes_[conv] = *(const struct sockaddr_in *)addr;
+    proxy->forward(true, proxy->server_addr_, buf->base, (size_t)nread);
+  }
+
+  static void on_back_recv(uv_udp_t *handle, ssize_t nread, const uv_buf_t *buf,
+                           const struct sockaddr *addr, unsigned flags) {
+    ImpairmentProxy *proxy = static_cast<ImpairmentProxy *>(handle->data);
+    if (nread < kKcpHeaderSize) {
+      return;
+    }
+    auto it = proxy->routes_.find(ikcp_getconv(buf->base));
+    if (it == proxy->routes_.end()) {
+      proxy->dropped_++;
+      return;
+    }
+    proxy->forward(false, it->second, buf->base, (size_t)nread);
+  }
+
+  static void on_timer(uv_timer_t *handle) {
+    ImpairmentProxy *proxy = static_cast<ImpairmentProxy *>(handle->data);
+    uint64_t current = now_us();
+    while (!proxy->queue_.empty() && proxy->queue_.top().due <= current) {
+      const Packet &packet = proxy->queue_.top();
+      proxy->deliver(packet.to_server, packet.target, packet.data.data(),
+                     packet.data.size());
+      proxy->queue_.pop();
+    }
+  }
+
+  /**
+   * 对一个数据包应用丢包和延迟
+   */
+  void forward(bool to_server, const struct sockaddr_in &target,
+               const char *data, size_t len) {
+    if (loss_ > 0 && uniform_(rng_) < loss_) {
+      dropped_++;
+      return;
+    }
+
+    uint64_t delay = delay_us_;
+    if (jitter_us_ > 0) {
+      int64_t offset = (int64_t)(uniform_(rng_) * 2 * jitter_us_) -
+                       (int64_t)jitter_us_;
+      delay = (int64_t)delay + offset > 0 ? delay + offset : 0;
+    }
+    if (delay == 0) {
+      deliver(to_server, target, data, len);
+      return;
+    }
+
+    Packet packet;
+    packet.due = now_us() + delay;
+    packet.seq = seq_++;
+    packet.to_server = to_server;
+    packet.target = target;
+    packet.data.assign(data, len);
+    queue_.push(std::move(packet));
+  }
+
+  /**
+   * 发送一个数据包（套接字缓冲区满时按丢包计数）
+   */
+  void deliver(bool to_server, const struct sockaddr_in &target,
+               const char *data, size_t len) {
+    uv_buf_t buf = uv_buf_init(const_cast<char *>(data), (unsigned int)len);
+    uv_udp_t *handle = to_server ? &back_ : &front_;
+    int ret = uv_udp_try_send(handle, &buf, 1, (const struct sockaddr *)&target);
+    if (ret < 0) {
+      dropped_++;
+      return;
+    }
+    forwarded_++;
+  }
+
+  // KCP头部长度（conv之后还有cmd/frg/wnd/ts/sn/una/len）
+  static const ssize_t kKcpHeaderSize = 24;
+
+  uv_loop_t *loop_;
+  uv_udp_t front_;
+  uv_udp_t back_;
+  uv_timer_t timer_;
+  struct sockaddr_in server_addr_;
+  std::unordered_map<uint32_t, struct sockaddr_in> routes_;
+  std::priority_queue<Packet, std::vector<Packet>, PacketLater> queue_;
+  double loss_;
+  uint64_t delay_us_;
+  uint64_t jitter_us_;
+  uint64_t seq_;
+  std::mt19937 rng_;
+  std::uniform_real_distribution<double> uniform_;
+  uint64_t forwarded_;
+  uint64_t dropped_;
+  char buffer_[65536];
+};
+
+/**
+ * 命令行参数
+ */
+struct Options {
+  std::vector<std::string> presets;
+  std::vector<int> sizes;
+  std::vector<double> loss; // 百分比
+  uint32_t delay;           // 单向延迟（毫秒）
+  uint32_t jitter;          // 单向抖动（毫秒）
+  int clients;
+  int window;               // 每个客户端的在途消息数量
+  uint32_t duration;        // 每组测试时长（毫秒）
+  std::string format;
+};
+
+/**
+ * 单组测试结果
+ */
+struct Result {
+  std::string preset;
+  int size;
+  double loss;
+  uint64_t messages;     // 完成往返的消息数量
+  double msgs_per_sec;   // 往返消息速率
+  double bytes_per_sec;  // 回显负载速率（单向）
+  uint32_t rtt_p50;      // 往返延迟（微秒）
+  uint32_t rtt_p99;
+  uint32_t rtt_max;
+  double retransmit_ratio; // 超时重传+快速重传次数 / 发出的UDP数据包数量
+  double cpu_per_msg;      // 进程CPU时间 / 往返消息数量（微秒，含代理开销）
+  uint64_t proxy_dropped;  // 代理注入的丢包（含发送缓冲区满）
+  uint64_t kernel_dropped; // 内核接收缓冲区溢出丢包（系统全局计数）
+};
+
+/**
+ * 单个基准客户端
+ */
+struct BenchClient {
+  KCPConnection *conn; // 连接池中的会话
+  std::vector<char> payload;
+};
+
+/**
+ * 基准测试运行状态
+ */
+class Bench {
+public:
+  Bench(uv_loop_t *loop, const Options &options)
+      : loop_(loop), options_(options), server_(loop), proxy_(loop),
+        proxy_port_(0), next_conv_(1), running_(false), messages_(0),
+        bytes_(0) {
+    stop_timer_.data = this;
+    uv_timer_init(loop_, &stop_timer_);
+  }
+
+  /**
+   * 启动服务器和代理
+   */
+  int start() {
+    server_.set_timeout(5000);
+    server_.set_max_message_size(1024 * 1024);
+    server_.set_new_connection_callback([](KCPConnection *conn) {
+      // 原样回显
+      conn->set_data_callback([](KCPConnection *c, const char *data, int len) {
+        c->send(data, len);
+      });
+    });
+
+    int ret = server_.bind_and_listen("127.0.0.1", 0);
+    if (ret < 0) {
+      return ret;
+    }
+
+    struct sockaddr_in server_addr;
+    socklen_t namelen = sizeof(server_addr);
+    getsockname(server_.get_socket_fd(), (struct sockaddr *)&server_addr,
+                &namelen);
+    proxy_port_ = proxy_.start(server_addr);
+    return proxy_port_ < 0 ? proxy_port_ : 0;
+  }
+
+  /**
+   * 运行一组测试
+   */
+  Result run_case(const Preset &preset, int size, double loss) {
+    server_.set_kcp_config(preset.nodelay, preset.interval, preset.resend,
+                           preset.nc, preset.sndwnd, preset.rcvwnd, 1400);
+    server_.set_adaptive_tuning(preset.adaptive);
+    proxy_.reset();
+    proxy_.set_impairment(loss / 100.0, options_.delay, options_.jitter);
+    rtt_.reset();
+    messages_ = 0;
+    bytes_ = 0;
+
+    // 创建客户端连接池（上一轮的连接池已停止，保留到程序退出）
+    KCPClientPool *pool = new KCPClientPool(loop_);
+    pools_.emplace_back(pool);
+    pool->set_kcp_config(preset.nodelay, preset.interval, preset.resend,
+                         preset.nc, preset.sndwnd, preset.rcvwnd, 1400);
+    pool->set_adaptive_tuning(preset.adaptive);
+    pool->set_max_message_size(1024 * 1024);
+    clients_.clear();
+    for (int i = 0; i < options_.clients; i++) {
+      BenchClient *bench_client = new BenchClient();
+      bench_client->conn = pool->connect("127.0.0.1", proxy_port_, next_conv_++);
+      if (!bench_client->conn) {
+        fprintf(stderr, "[Bench] 客户端连接失败\n");
+        delete bench_client;
+        continue;
+      }
+      clients_.emplace_back(bench_client);
+      bench_client->payload.assign(size, 'x');
+      bench_client->conn->set_data_callback(
+          [this, bench_client](KCPConnection *conn, const char *data, int len) {
+            on_echo(bench_client, data, len);
+          });
+    }
+
+    uint64_t kernel_start = udp_rcvbuf_errors();
+    uint64_t cpu_start = cpu_us();
+    uint64_t start = now_us();
+    running_ = true;
+    for (size_t i = 0; i < clients_.size(); i++) {
+      for (int j = 0; j < options_.window; j++) {
+        send_message(clients_[i].get());
+      }
+    }
+
+    uv_timer_start(&stop_timer_, on_stop_timer, options_.duration, 0);
+    uv_run(loop_, UV_RUN_DEFAULT);
+    running_ = false;
+
+    uint64_t elapsed = now_us() - start;
+    uint64_t cpu = cpu_us() - cpu_start;
+
+    // 汇总两端的重传和发包数量
+    uint64_t retransmits = 0, packets_out = 0;
+    for (size_t i = 0; i < clients_.size(); i++) {
+      KCPConnection::Stats stats = clients_[i]->conn->get_stats();
+      retransmits += stats.xmit + stats.fast_retransmits;
+      packets_out += stats.packets_out;
+    }
+    pool->stop();
+    clients_.clear();
+    std::vector<KCPConnection *> connections;
+    server_.for_each_connection([&](KCPConnection *conn) {
+      KCPConnection::Stats stats = conn->get_stats();
+      retransmits += stats.xmit + stats.fast_retransmits;
+      packets_out += stats.packets_out;
+      connections.push_back(conn);
+    });
+    // 关闭服务器端会话，避免残留的重传影响下一组测试
+    for (KCPConnection *conn : connections) {
+      conn->abort();
+    }
+
+    Result result;
+    result.preset = preset.name;
+    result.size = size;
+    result.loss = loss;
+    result.messages = messages_;
+    result.msgs_per_sec = elapsed > 0 ? messages_ * 1e6 / elapsed : 0;
+    result.bytes_per_sec = elapsed > 0 ? bytes_ * 1e6 / elapsed : 0;
+    result.rtt_p50 = rtt_.percentile(50);
+    result.rtt_p99 = rtt_.percentile(99);
+    result.rtt_max = rtt_.max();
+    result.retransmit_ratio =
+        packets_out > 0 ? (double)retransmits / packets_out : 0;
+    result.cpu_per_msg = messages_ > 0 ? (double)cpu / messages_ : 0;
+    result.proxy_dropped = proxy_.get_dropped();
+    result.kernel_dropped = udp_rcvbuf_errors() - kernel_start;
+    return result;
+  }
+
+private:
+  static void on_stop_timer(uv_timer_t *handle) {
+    Bench *bench = static_cast<Bench *>(handle->data);
+    uv_stop(bench->loop_);
+  }
+
+  /**
+   * 发送一条带时间戳的消息
+   */
+  void send_message(BenchClient *bench_client) {
+    std::vector<char> &payload = bench_client->payload;
+    uint64_t timestamp = now_us();
+    memcpy(payload.data(), &timestamp, sizeof(timestamp));
+    bench_client->conn->send(payload.data(), (int)payload.size());
+  }
+
+  /**
+   * 收到回显：记录往返延迟并发送下一条消息
+   */
+  void on_echo(BenchClient *bench_client, const char *data, int len) {
+    if (!running_ || len < (int)sizeof(uint64_t)) {
+      return;
+    }
+    uint64_t timestamp;
+    memcpy(&timestamp, data, sizeof(timestamp));
+    rtt_.record((uint32_t)(now_us() - timestamp));
+    messages_++;
+    bytes_ += len;
+    send_message(bench_client);
+  }
+
+  uv_loop_t *loop_;
+  const Options &options_;
+  KCPServer server_;
+  ImpairmentProxy proxy_;
+  int proxy_port_;
+  uint32_t next_conv_;
+  uv_timer_t stop_timer_;
+  std::vector<std::unique_ptr<KCPClientPool>> pools_;
+  std::vector<std::unique_ptr<BenchClient>> clients_;
+  bool running_;
+  KCPHistogram rtt_; // 往返延迟（微秒）
+  uint64_t messages_;
+  uint64_t bytes_;
+};
+
+/**
+ * 按逗号拆分参数值
+ */
+static std::vector<std::string> split(const std::string &value) {
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (start <= value.size()) {
+    size_t end = value.find(',', start);
+    if (end == std::string::npos) {
+      end = value.size();
+    }
+    if (end > start) {
+      parts.push_back(value.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+  return parts;
+}
+
+/**
+ * 解析命令行参数
+ */
+static bool parse_options(int argc, char *argv[], Options &options) {
+  options.presets = {"normal", "fast", "turbo"};
+  options.sizes = {64, 1024, 8192};
+  options.loss = {0, 1, 5};
+  options.delay = 5;
+  options.jitter = 0;
+  options.clients = 4;
+  options.window = 16;
+  options.duration = 2000;
+  options.format = "json";
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+      return false;
+    }
+    std::string key = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    if (key == "presets") {
+      options.presets = split(value);
+    } else if (key == "sizes") {
+      options.sizes.clear();
+      for (const std::string &part : split(value)) {
+        options.sizes.push_back(std::atoi(part.c_str()));
+      }
+    } else if (key == "loss") {
+      options.loss.clear();
+      for (const std::string &part : split(value)) {
+        options.loss.push_back(std::atof(part.c_str()));
+      }
+    } else if (key == "delay") {
+      options.delay = (uint32_t)std::atoi(value.c_str());
+    } else if (key == "jitter") {
+      options.jitter = (uint32_t)std::atoi(value.c_str());
+    } else if (key == "clients") {
+      options.clients = std::atoi(value.c_str());
+    } else if (key == "window") {
+      options.window = std::atoi(value.c_str());
+    } else if (key == "duration") {
+      options.duration = (uint32_t)std::atoi(value.c_str());
+    } else if (key == "format") {
+      options.format = value;
+    } else {
+      return false;
+    }
+  }
+
+  for (int size : options.sizes) {
+    if (size < (int)sizeof(uint64_t)) {
+      fprintf(stderr, "消息长度不能小于%zu字节\n", sizeof(uint64_t));
+      return false;
+    }
+  }
+  return options.clients > 0 && options.window > 0 &&
+         (options.format == "json" || options.format == "csv");
+}
+
+/**
+ * 输出测试结果
+ */
+static void print_results(const Options &options,
+                          const std::vector<Result> &results) {
+  if (options.format == "csv") {
+    printf("preset,size,loss_pct,delay_ms,jitter_ms,clients,window,duration_ms,"
+           "messages,msgs_per_sec,bytes_per_sec,rtt_p50_us,rtt_p99_us,"
+           "rtt_max_us,retransmit_ratio,cpu_us_per_msg,proxy_dropped,"
+           "kernel_dropped\n");
+    for (const Result &r : results) {
+      printf("%s,%d,%g,%u,%u,%d,%d,%u,%llu,%.1f,%.1f,%u,%u,%u,%.4f,%.3f,%llu,"
+             "%llu\n",
+             r.preset.c_str(), r.size, r.loss, options.delay, options.jitter,
+             options.clients, options.window, options.duration,
+             (unsigned long long)r.messages, r.msgs_per_sec, r.bytes_per_sec,
+             r.rtt_p50, r.rtt_p99, r.rtt_max, r.retransmit_ratio,
+             r.cpu_per_msg, (unsigned long long)r.proxy_dropped,
+             (unsigned long long)r.kernel_dropped);
+    }
+    return;
+  }
+
+  printf("[\n");
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    printf("  {\"preset\": \"%s\", \"size\": %d, \"loss_pct\": %g, "
+           "\"delay_ms\": %u, \"jitter_ms\": %u, \"clients\": %d, "
+           "\"window\": %d, \"duration_ms\": %u, \"messages\": %llu, "
+           "\"msgs_per_sec\": %.1f, \"bytes_per_sec\": %.1f, "
+           "\"rtt_p50_us\": %u, \"rtt_p99_us\": %u, \"rtt_max_us\": %u, "
+           "\"retransmit_ratio\": %.4f, \"cpu_us_per_msg\": %.3f, "
+           "\"proxy_dropped\": %llu, \"kernel_dropped\": %llu}%s\n",
+           r.preset.c_str(), r.size, r.loss, options.delay, options.jitter,
+           options.clients, options.window, options.duration,
+           (unsigned long long)r.messages, r.msgs_per_sec, r.bytes_per_sec,
+           r.rtt_p50, r.rtt_p99, r.rtt_max, r.retransmit_ratio, r.cpu_per_msg,
+           (unsigned long long)r.proxy_dropped,
+           (unsigned long long)r.kernel_dropped, i + 1 < results.size() ? "," : "");
+  }
+  printf("]\n");
+}
+
+int main(int argc, char *argv[]) {
+  Options options;
+  if (!parse_options(argc, argv, options)) {
+    fprintf(stderr,
+            "用法: %s [--presets=normal,fast,turbo,adaptive] [--sizes=64,1024,8192]\n"
+            "          [--loss=0,1,5] [--delay=5] [--jitter=0] [--clients=4]\n"
+            "          [--window=16] [--duration=2000] [--format=json|csv]\n",
+            argv[0]);
+    return 1;
+  }
+
+  // 基准测试只关心结果，关闭生命周期日志
+  KCPLog::set_level(KCP_LOG_LEVEL_WARN);
+
+  uv_loop_t loop;
+  uv_loop_init(&loop);
+
+  Bench bench(&loop, options);
+  int ret = bench.start();
+  if (ret < 0) {
+    fprintf(stderr, "启动失败: %s\n", uv_strerror(ret));
+    return 1;
+  }
+
+  std::vector<Result> results;
+  for (const std::string &name : options.presets) {
+    const Preset *preset = nullptr;
+    for (const Preset &candidate : kPresets) {
+      if (name == candidate.name) {
+        preset = &candidate;
+      }
+    }
+    if (preset == nullptr) {
+      fprintf(stderr, "未知的预设: %s\n", name.c_str());
+      return 1;
+    }
+
+    for (int size : options.sizes) {
+      for (double loss : options.loss) {
+        Result result = bench.run_case(*preset, size, loss);
+        fprintf(stderr,
+                "[Bench] %-6s size=%-6d loss=%4.1f%%  %9.0f msg/s  "
+                "p50=%uus p99=%uus  retrans=%.3f  cpu=%.1fus/msg\n",
+                preset->name, size, loss, result.msgs_per_sec, result.rtt_p50,
+                result.rtt_p99, result.retransmit_ratio, result.cpu_per_msg);
+        results.push_back(result);
+      }
+    }
+  }
+
+  print_results(options, results);
+  return 0;
+}
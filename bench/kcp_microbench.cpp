@@ -0,0 +1,410 @@
+#include "ikcp.h"
+#include "kcp_allocator.h"
+#include "kcp_connection.h"
+#include "kcp_connection_table.h"
+#include "kcp_log.h"
+#include "kcp_send_pool.h"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * KCP热路径微基准测试（Google Benchmark）
+ * 单独测量协议栈各环节的开销，用于验证分配器、连接表、发送批量化等改动：
+ *
+ * - BM_IkcpInputAck：解析不同ACK密度（每个UDP包的ACK数量）、顺序/乱序的ACK
+ * - BM_IkcpFlushIdle / BM_IkcpFlushRetransmit：大snd_buf下的flush扫描/全部重传
+ * - BM_IkcpSend / BM_IkcpSendv：消息分片
+ * - BM_ConnectionTableFind：按conv查找连接（与std::unordered_map对比）
+ * - BM_ConnectionOutput：KCPConnection::output在各发送路径下的开销
+ *
+ * 附加参数 --kcp_slab 在运行前安装KCPSlabAllocator，用于对比默认malloc
+ * （BM_ConnectionOutput创建KCPConnection时总会安装，因此放在最后运行；
+ *   之前的基准测试创建的ikcpcb都在各自的函数内释放）
+ */
+
+static const uint32_t kConv = 0x11223344;
+static const uint32_t kStartTime = 1000;
+
+/**
+ * 丢弃所有输出的KCP输出回调
+ */
+static int discard_output(const char *buf, int len, ikcpcb *kcp, void *user) {
+  benchmark::DoNotOptimize(buf);
+  return 0;
+}
+
+/**
+ * 创建一个发送端，snd_buf中有segments个已发送未确认的数据段（sn从0开始）
+ */
+static ikcpcb *create_sender(int segments, int payload_size = 64) {
+  ikcpcb *kcp = ikcp_create(kConv, nullptr);
+  ikcp_setoutput(kcp, discard_output);
+  ikcp_nodelay(kcp, 1, 10, 2, 1);
+  ikcp_wndsize(kcp, segments, segments);
+  kcp->rmt_wnd = segments;
+
+  std::vector<char> payload(payload_size, 'x');
+  for (int i = 0; i < segments; i++) {
+    ikcp_send(kcp, payload.data(), payload_size);
+  }
+
+  // 第一次update会立即flush，把发送队列中的数据段全部移入snd_buf
+  ikcp_update(kcp, kStartTime);
+  return kcp;
+}
+
+/**
+ * 按KCP协议格式（小端）编码一个ACK段
+ */
+static void encode_ack(std::string &packet, uint32_t sn, uint16_t wnd) {
+  char seg[24];
+  uint32_t conv = kConv, ts = kStartTime, una = 0, len = 0;
+  memcpy(seg, &conv, 4);
+  seg[4] = 82; // IKCP_CMD_ACK
+  seg[5] = 0;
+  memcpy(seg + 6, &wnd, 2);
+  memcpy(seg + 8, &ts, 4);
+  memcpy(seg + 12, &sn, 4);
+  memcpy(seg + 16, &una, 4);
+  memcpy(seg + 20, &len, 4);
+  packet.append(seg, sizeof(seg));
+}
+
+/**
+ * 生成确认sn 0..segments-1的ACK数据包
+ * @param density - 每个UDP包中的ACK数量（MTU 1400时最多58个）
+ * @param shuffled - 是否打乱确认顺序（乱序到达/选择性确认时的情况）
+ */
+static std::vector<std::string> build_ack_packets(int segments, int density,
+                                                  bool shuffled) {
+  std::vector<uint32_t> sns(segments);
+  for (int i = 0; i < segments; i++) {
+    sns[i] = (uint32_t)i;
+  }
+  if (shuffled) {
+    std::mt19937 rng(12345);
+    std::shuffle(sns.begin(), sns.end(), rng);
+  }
+
+  std::vector<std::string> packets;
+  for (int i = 0; i < segments; i += density) {
+    std::string packet;
+    for (int j = i; j < i + density && j < segments; j++) {
+      encode_ack(packet, sns[j], (uint16_t)segments);
+    }
+    packets.push_back(packet);
+  }
+  return packets;
+}
+
+/**
+ * ikcp_input解析ACK
+ * 参数：每个包的ACK数量，是否乱序；每次迭代确认1024个在途数据段
+ */
+static void BM_IkcpInputAck(benchmark::State &state) {
+  const int segments = 1024;
+  std::vector<std::string> packets =
+      build_ack_packets(segments, (int)state.range(0), state.range(1) != 0);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    ikcpcb *kcp = create_sender(segments);
+    state.ResumeTiming();
+
+    for (const std::string &packet : packets) {
+      ikcp_input(kcp, packet.data(), (long)packet.size());
+    }
+
+    state.PauseTiming();
+    if (kcp->nsnd_buf != 0) {
+      state.SkipWithError("ACK没有清空snd_buf");
+    }
+    ikcp_release(kcp);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * segments);
+}
+BENCHMARK(BM_IkcpInputAck)
+    ->ArgsProduct({{1, 8, 32, 58}, {0, 1}})
+    ->ArgNames({"acks_per_packet", "shuffled"});
+
+/**
+ * ikcp_flush扫描大snd_buf（没有数据段需要重传）
+ * 参数：snd_buf中的数据段数量
+ */
+static void BM_IkcpFlushIdle(benchmark::State &state) {
+  ikcpcb *kcp = create_sender((int)state.range(0));
+  for (auto _ : state) {
+    ikcp_flush(kcp);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  ikcp_release(kcp);
+}
+BENCHMARK(BM_IkcpFlushIdle)->Arg(256)->Arg(1024)->Arg(4096)->ArgName("snd_buf");
+
+/**
+ * ikcp_flush超时重传整个snd_buf
+ * 参数：snd_buf中的数据段数量
+ */
+static void BM_IkcpFlushRetransmit(benchmark::State &state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    ikcpcb *kcp = create_sender((int)state.range(0));
+    // 时间前进超过RTO，所有数据段都需要重传
+    kcp->current += 10000;
+    state.ResumeTiming();
+
+    ikcp_flush(kcp);
+
+    state.PauseTiming();
+    ikcp_release(kcp);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_IkcpFlushRetransmit)
+    ->Arg(256)
+    ->Arg(1024)
+    ->Arg(4096)
+    ->ArgName("snd_buf");
+
+/**
+ * 创建一个只用于入队的发送端（大窗口，不flush）
+ */
+static ikcpcb *create_queue_only() {
+  ikcpcb *kcp = ikcp_create(kConv, nullptr);
+  ikcp_setoutput(kcp, discard_output);
+  ikcp_setmtu(kcp, 1400);
+  return kcp;
+}
+
+/**
+ * ikcp_send分片入队
+ * 参数：消息长度
+ */
+static void BM_IkcpSend(benchmark::State &state) {
+  std::vector<char> message(state.range(0), 'x');
+  ikcpcb *kcp = create_queue_only();
+  for (auto _ : state) {
+    // 发送队列过长时重建，避免测量到内存增长
+    if (kcp->nsnd_que > 8192) {
+      state.PauseTiming();
+      ikcp_release(kcp);
+      kcp = create_queue_only();
+      state.ResumeTiming();
+    }
+    ikcp_send(kcp, message.data(), (int)message.size());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  ikcp_release(kcp);
+}
+BENCHMARK(BM_IkcpSend)
+    ->Arg(64)
+    ->Arg(1400)
+    ->Arg(8192)
+    ->Arg(65536)
+    ->ArgName("size");
+
+/**
+ * ikcp_sendv分散-聚集分片入队（消息由4个等长缓冲区组成）
+ * 参数：消息总长度
+ */
+static void BM_IkcpSendv(benchmark::State &state) {
+  const int count = 4;
+  const int part = (int)state.range(0) / count;
+  std::vector<char> message(part * count, 'x');
+  const char *bufs[count];
+  int lens[count];
+  for (int i = 0; i < count; i++) {
+    bufs[i] = message.data() + i * part;
+    lens[i] = part;
+  }
+
+  ikcpcb *kcp = create_queue_only();
+  for (auto _ : state) {
+    if (kcp->nsnd_que > 8192) {
+      state.PauseTiming();
+      ikcp_release(kcp);
+      kcp = create_queue_only();
+      state.ResumeTiming();
+    }
+    ikcp_sendv(kcp, bufs, lens, count);
+  }
+  state.SetBytesProcessed(state.iterations() * part * count);
+  ikcp_release(kcp);
+}
+BENCHMARK(BM_IkcpSendv)->Arg(1400)->Arg(8192)->Arg(65536)->ArgName("size");
+
+/**
+ * 生成查找序列
+ * @param convs - 已存在的conv
+ * @param miss - true时生成不存在的conv
+ */
+static std::vector<uint32_t> build_lookups(const std::vector<uint32_t> &convs,
+                                           bool miss) {
+  std::mt19937 rng(54321);
+  std::vector<uint32_t> lookups(4096);
+  for (uint32_t &conv : lookups) {
+    // 已存在的conv都是奇数，偶数一定不存在
+    conv = miss ? (rng() & ~1u) : convs[rng() % convs.size()];
+  }
+  return lookups;
+}
+
+/**
+ * 生成随机conv（奇数，互不相同）
+ */
+static std::vector<uint32_t> build_convs(size_t count) {
+  std::mt19937 rng(12345);
+  std::vector<uint32_t> convs;
+  std::unordered_map<uint32_t, bool> seen;
+  while (convs.size() < count) {
+    uint32_t conv = rng() | 1u;
+    if (seen.emplace(conv, true).second) {
+      convs.push_back(conv);
+    }
+  }
+  return convs;
+}
+
+/**
+ * KCPConnectionTable::find（KCPServer收包时按conv查找连接）
+ * 参数：连接数量，是否查找不存在的conv
+ */
+static void BM_ConnectionTableFind(benchmark::State &state) {
+  std::vector<uint32_t> convs = build_convs((size_t)state.range(0));
+  std::vector<uint32_t> lookups = build_lookups(convs, state.range(1) != 0);
+
+  struct sockaddr_storage addr;
+  memset(&addr, 0, sizeof(addr));
+  KCPConnectionTable table;
+  for (uint32_t conv : convs) {
+    table.insert(std::unique_ptr<KCPConnection>(
+        new KCPConnection(conv, nullptr, (const struct sockaddr *)&addr)));
+  }
+
+  size_t index = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table.find(lookups[index]));
+    index = (index + 1) & (lookups.size() - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConnectionTableFind)
+    ->ArgsProduct({{16, 1024, 16384}, {0, 1}})
+    ->ArgNames({"sessions", "miss"});
+
+/**
+ * std::unordered_map查找（对比基准）
+ * 参数：连接数量，是否查找不存在的conv
+ */
+static void BM_UnorderedMapFind(benchmark::State &state) {
+  std::vector<uint32_t> convs = build_convs((size_t)state.range(0));
+  std::vector<uint32_t> lookups = build_lookups(convs, state.range(1) != 0);
+
+  std::unordered_map<uint32_t, KCPConnection *> map;
+  for (uint32_t conv : convs) {
+    map[conv] = nullptr;
+  }
+
+  size_t index = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(lookups[index]));
+    index = (index + 1) & (lookups.size() - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UnorderedMapFind)
+    ->ArgsProduct({{16, 1024, 16384}, {0, 1}})
+    ->ArgNames({"sessions", "miss"});
+
+/**
+ * KCPConnection::output（通过send_udp_direct调用）
+ * 发往本机一个不读取的UDP套接字（接收缓冲区满后由内核丢弃），包含系统调用开销
+ * 参数：发送路径（0=每包new/delete异步发送 1=发送池异步发送
+ *       2=发送池+try_send 3=发送池+sendmmsg批量），数据包长度
+ */
+static void BM_ConnectionOutput(benchmark::State &state) {
+  const int mode = (int)state.range(0);
+  std::vector<char> packet(state.range(1), 'x');
+
+  uv_loop_t loop;
+  uv_loop_init(&loop);
+  uv_udp_t sender, sink;
+  uv_udp_init(&loop, &sender);
+  uv_udp_init(&loop, &sink);
+
+  struct sockaddr_in local;
+  uv_ip4_addr("127.0.0.1", 0, &local);
+  uv_udp_bind(&sender, (const struct sockaddr *)&local, 0);
+  uv_udp_bind(&sink, (const struct sockaddr *)&local, 0);
+  struct sockaddr_storage sink_addr;
+  int namelen = sizeof(sink_addr);
+  uv_udp_getsockname(&sink, (struct sockaddr *)&sink_addr, &namelen);
+
+  {
+    // 发送池必须比连接和所有未完成的发送请求存活更久
+    KCPSendPool pool;
+    pool.init(1500, 1024);
+    pool.set_try_send(mode == 2);
+    pool.set_batching(mode == 3);
+
+    KCPConnection conn(kConv, &sender, (const struct sockaddr *)&sink_addr);
+    conn.set_state(KCPConnection::CONNECTED);
+    if (mode > 0) {
+      conn.set_send_pool(&pool);
+    }
+
+    uint64_t sent = 0;
+    for (auto _ : state) {
+      conn.send_udp_direct(packet.data(), (int)packet.size());
+      // 模拟事件循环：每32个包flush一次批量队列并处理发送完成回调
+      if ((++sent & 31) == 0) {
+        pool.flush();
+        uv_run(&loop, UV_RUN_NOWAIT);
+      }
+    }
+    pool.flush();
+    uv_run(&loop, UV_RUN_NOWAIT);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(1));
+  }
+
+  uv_close((uv_handle_t *)&sender, nullptr);
+  uv_close((uv_handle_t *)&sink, nullptr);
+  uv_run(&loop, UV_RUN_DEFAULT);
+  uv_loop_close(&loop);
+}
+BENCHMARK(BM_ConnectionOutput)
+    ->ArgsProduct({{0, 1, 2, 3}, {64, 1400}})
+    ->ArgNames({"path", "size"});
+
+int main(int argc, char *argv[]) {
+  // 逐包日志会淹没测量结果
+  KCPLog::set_level(KCP_LOG_LEVEL_WARN);
+
+  // 去掉自定义参数后再交给Google Benchmark解析
+  int out = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--kcp_slab") == 0) {
+      KCPSlabAllocator::install();
+      continue;
+    }
+    argv[out++] = argv[i];
+  }
+  argc = out;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,179 @@
+#ifndef KCP_ADDRESS_H
+#define KCP_ADDRESS_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <uv.h>
+
+/**
+ * KCP对端地址
+ * IPv4/IPv6地址的紧凑存储（sockaddr_in/sockaddr_in6的联合体，28字节），
+ * 代替每个会话128字节的sockaddr_storage，并可以直接作为sockaddr传给libuv
+ *
+ * 相等比较只比较地址族、端口、IP地址（IPv6另比较scope_id），
+ * 不受sockaddr中填充字段和flowinfo的影响，适合逐包校验对端地址
+ *
+ * 注意：双栈socket上收到的IPv4客户端地址是IPv4映射的IPv6地址（::ffff:a.b.c.d），
+ *       与同一客户端的纯IPv4地址不相等
+ */
+class KCPAddress {
+public:
+  /**
+   * 构造一个空地址（AF_UNSPEC）
+   */
+  KCPAddress() { memset(&storage_, 0, sizeof(storage_)); }
+
+  /**
+   * 从sockaddr构造
+   * @param addr - AF_INET或AF_INET6地址，其他地址族得到空地址
+   */
+  explicit KCPAddress(const struct sockaddr *addr) { assign(addr); }
+
+  /**
+   * 解析IP地址字符串
+   * 先按IPv4解析，失败后按IPv6解析（支持"fe80::1%eth0"形式的scope）
+   * @param ip - IP地址字符串，如"127.0.0.1"、"::"、"2001:db8::1"
+   * @param port - 端口号
+   * @param out - 输出地址
+   * @return 成功返回0，失败返回libuv错误码
+   */
+  static int parse(const std::string &ip, int port, KCPAddress *out);
+
+  /**
+   * 从sockaddr复制
+   * 只复制对应地址族的长度
+   */
+  void assign(const struct sockaddr *addr) {
+    memset(&storage_, 0, sizeof(storage_));
+    if (addr == nullptr) {
+      return;
+    }
+    if (addr->sa_family == AF_INET) {
+      memcpy(&storage_, addr, sizeof(struct sockaddr_in));
+    } else if (addr->sa_family == AF_INET6) {
+      memcpy(&storage_, addr, sizeof(struct sockaddr_in6));
+    }
+  }
+
+  /**
+   * 获取sockaddr指针（可直接传给uv_udp_send等函数）
+   */
+  const struct sockaddr *get() const { return &storage_.sa; }
+
+  /**
+   * 获取sockaddr长度（空地址返回0）
+   */
+  socklen_t length() const {
+    switch (storage_.sa.sa_family) {
+    case AF_INET:
+      return sizeof(storage_.v4);
+    case AF_INET6:
+      return sizeof(storage_.v6);
+    default:
+      return 0;
+    }
+  }
+
+  /**
+   * 获取地址族（AF_INET、AF_INET6或AF_UNSPEC）
+   */
+  int family() const { return storage_.sa.sa_family; }
+
+  /**
+   * 是否为空地址
+   */
+  bool empty() const { return storage_.sa.sa_family == AF_UNSPEC; }
+
+  /**
+   * 获取端口号（主机字节序）
+   */
+  uint16_t port() const {
+    return ntohs(storage_.sa.sa_family == AF_INET6 ? storage_.v6.sin6_port
+                                                   : storage_.v4.sin_port);
+  }
+
+  /**
+   * 序列化端口和IP地址（用于哈希，不含填充字段和flowinfo）
+   * @param out - 输出缓冲区，至少18字节
+   * @param with_port - 是否包含端口（按源IP限流时不包含）
+   * @return 写入的字节数（空地址返回0）
+   */
+  size_t serialize(uint8_t *out, bool with_port = true) const {
+    size_t n = 0;
+    if (storage_.sa.sa_family == AF_INET) {
+      if (with_port) {
+        memcpy(out, &storage_.v4.sin_port, 2);
+        n += 2;
+      }
+      memcpy(out + n, &storage_.v4.sin_addr, 4);
+      n += 4;
+    } else if (storage_.sa.sa_family == AF_INET6) {
+      if (with_port) {
+        memcpy(out, &storage_.v6.sin6_port, 2);
+        n += 2;
+      }
+      memcpy(out + n, &storage_.v6.sin6_addr, 16);
+      n += 16;
+    }
+    return n;
+  }
+
+  /**
+   * 转换为字符串："1.2.3.4:5678"或"[2001:db8::1]:5678"
+   */
+  std::string to_string() const;
+
+  /**
+   * 比较地址
+   * IPv4比较一次32位IP和16位端口，IPv6比较两次64位IP、端口和scope_id
+   */
+  bool operator==(const KCPAddress &other) const {
+    if (storage_.sa.sa_family != other.storage_.sa.sa_family) {
+      return false;
+    }
+    if (storage_.sa.sa_family == AF_INET) {
+      return storage_.v4.sin_port == other.storage_.v4.sin_port &&
+             storage_.v4.sin_addr.s_addr == other.storage_.v4.sin_addr.s_addr;
+    }
+    if (storage_.sa.sa_family == AF_INET6) {
+      uint64_t a[2], b[2];
+      memcpy(a, &storage_.v6.sin6_addr, sizeof(a));
+      memcpy(b, &other.storage_.v6.sin6_addr, sizeof(b));
+      return storage_.v6.sin6_port == other.storage_.v6.sin6_port &&
+             a[0] == b[0] && a[1] == b[1] &&
+             storage_.v6.sin6_scope_id == other.storage_.v6.sin6_scope_id;
+    }
+    return true;
+  }
+
+  bool operator!=(const KCPAddress &other) const { return !(*this == other); }
+
+  /**
+   * 与sockaddr比较（逐包校验时避免先构造KCPAddress）
+   */
+  bool equals(const struct sockaddr *addr) const {
+    if (addr == nullptr) {
+      return empty();
+    }
+    if (addr->sa_family == AF_INET) {
+      const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
+      return storage_.sa.sa_family == AF_INET &&
+             storage_.v4.sin_port == in->sin_port &&
+             storage_.v4.sin_addr.s_addr == in->sin_addr.s_addr;
+    }
+    if (addr->sa_family == AF_INET6) {
+      return *this == KCPAddress(addr);
+    }
+    return false;
+  }
+
+private:
+  union {
+    struct sockaddr sa;
+    struct sockaddr_in v4;
+    struct sockaddr_in6 v6;
+  } storage_;
+};
+
+#endif // KCP_ADDRESS_H
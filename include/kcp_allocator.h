@@ -0,0 +1,95 @@
+#ifndef KCP_ALLOCATOR_H
+#define KCP_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * KCP分级内存分配器
+ * 通过ikcp_allocator替换KCP内部的malloc/free，用于IKCPSEG、ikcpcb及其缓冲区
+ *
+ * 设计：
+ * - 按块大小分级（64B-8KB），超过8KB的分配直接使用malloc
+ * - 每个线程持有各级的空闲链表和分配计数，分配和释放不加锁、不写共享的缓存行，
+ *   get_stats时对各线程的计数求和
+ * - 线程本地链表为空时从全局仓库批量取块，仓库也为空时切分新的内存块
+ * - 线程退出时把空闲块归还全局仓库，供其他线程复用
+ * - 每个块前有16字节头部记录所属级别，释放时无需传入大小
+ *
+ * 注意：
+ * - 必须在进程内创建任何KCP对象之前安装，安装后不可卸载
+ *   （安装前由malloc分配的对象不能再由本分配器释放）
+ * - KCPConnection在创建KCP控制块之前自动安装；直接调用ikcp_create的代码
+ *   需要在创建第一个ikcpcb之前调用install，或在安装之前释放所有ikcpcb
+ * - 切分出的内存只会在各线程和全局仓库之间流转，不会归还给系统
+ */
+class KCPSlabAllocator {
+public:
+  // 块大小级别数量
+  static const int kClassCount = 11;
+
+  // 单个级别的统计信息
+  struct ClassStats {
+    uint32_t block_size; // 块大小（含16字节头部）
+    uint64_t capacity;   // 已切分的块总数
+    uint64_t in_use;     // 正在使用的块数量
+    uint64_t high_water; // 各次get_stats观察到的正在使用块数量的最大值
+                         // （计数按线程分开维护，分配时不更新全局最大值）
+    uint64_t allocs;     // 累计分配次数
+  };
+
+  // 分配器统计信息
+  struct Stats {
+    ClassStats classes[kClassCount]; // 各级别统计
+    uint64_t large_allocs;           // 累计超大分配次数（直接使用malloc）
+    uint64_t large_in_use;           // 正在使用的超大分配数量
+    uint64_t reserved_bytes;         // 已切分的内存总量（字节）
+  };
+
+  /**
+   * 安装到KCP（调用ikcp_allocator）
+   * 可以重复调用（包括多个线程同时调用），只有第一次生效；
+   * 任何线程从install返回时钩子都已写入，可以立即创建KCP对象
+   */
+  static void install();
+
+  /**
+   * 是否已安装
+   */
+  static bool is_installed();
+
+  /**
+   * 分配内存（ikcp_malloc钩子）
+   * @param size - 请求大小，单位字节
+   * @return 内存指针（16字节对齐），失败返回nullptr
+   */
+  static void *allocate(size_t size);
+
+  /**
+   * 释放内存（ikcp_free钩子）
+   * 可以在任意线程释放其他线程分配的内存
+   * @param ptr - 由allocate返回的指针，可以为nullptr
+   */
+  static void deallocate(void *ptr);
+
+  /**
+   * 按预期会话数量预先切分内存块，放入全局仓库
+   * 每个会话估算为：1个ikcpcb + 1个flush缓冲区 + segments_per_session个数据段
+   * @param sessions - 预期会话数量
+   * @param mtu - KCP的MTU，用于估算数据段和flush缓冲区大小
+   *              默认值：1400字节
+   * @param segments_per_session - 每个会话预留的数据段数量
+   *                               含义：发送/接收队列中同时存在的数据段
+   *                               默认值：16
+   *                               建议范围：8-(sndwnd+rcvwnd)
+   */
+  static void reserve(size_t sessions, int mtu = 1400,
+                      int segments_per_session = 16);
+
+  /**
+   * 获取统计信息
+   */
+  static Stats get_stats();
+};
+
+#endif // KCP_ALLOCATOR_H
@@ -0,0 +1,144 @@
+#ifndef KCP_CHANNEL_H
+#define KCP_CHANNEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include <uv.h>
+
+/**
+ * KCP会话内的多通道复用（带优先级）
+ * 一个KCP会话只有一个FIFO发送队列，大消息会阻塞之后的小消息（队头阻塞）。
+ * 启用多通道后，消息先进入各通道自己的队列，在进入ikcp_send之前按分片交错：
+ * 每个分片是一条只占一个KCP数据段的消息，带2字节通道头 channel(1) + flags(1)，
+ * 每次取分片时选择有数据的、编号最小的通道（通道0优先级最高）
+ *
+ * 接收端按通道分别重组，同一通道内的消息保持顺序，不同通道之间互不等待
+ * （KCP本身仍按序交付数据段，高优先级消息只需等待已进入发送窗口的分片）
+ *
+ * 每个分片只占一个KCP数据段，消息长度不受IKCP_WND_RCV分片数的限制。
+ * 流式消息（FLAG_STREAM）由生产者回调在取分片时逐段填充，接收端逐片交付，
+ * 两端都不需要完整消息的内存副本
+ */
+class KCPChannelMux {
+public:
+  // 通道头长度（字节）
+  static const int kHeaderSize = 2;
+
+  // 最大通道数
+  static const int kMaxChannels = 256;
+
+  // 分片标志
+  enum Flags {
+    FLAG_FIRST = 0x01, // 消息的第一个分片
+    FLAG_LAST = 0x02,  // 消息的最后一个分片
+    FLAG_STREAM = 0x04, // 流式消息的分片（不重组，逐片交付）
+    FLAG_ABORT = 0x08,  // 流式消息被发送方中止（与FLAG_LAST一起出现）
+  };
+
+  // 流式消息的生产者：向buf写入最多max_len字节
+  // 返回值：>0表示写入的字节数，0表示消息结束，<0表示中止
+  using Producer = std::function<int(char *buf, int max_len)>;
+
+  // on_chunk的返回值
+  enum ChunkResult {
+    CHUNK_PARTIAL = 0,  // 消息尚未完整
+    CHUNK_COMPLETE = 1, // 消息已完整
+    CHUNK_STREAM = 2,   // 流式消息的分片（按flags判断开始、结束、中止）
+    CHUNK_ERROR = -1,   // 协议错误（通道号越界、分片标志不连续、超过最大长度）
+  };
+
+  /**
+   * 构造函数
+   * @param channels - 通道数量，范围1-kMaxChannels
+   */
+  explicit KCPChannelMux(int channels);
+
+  /**
+   * 获取通道数量
+   */
+  int channels() const { return (int)send_queues_.size(); }
+
+  /**
+   * 将一条消息加入通道的发送队列（复制数据，分片延迟到next_chunk时进行）
+   * @param channel - 通道号（调用者保证小于channels()）
+   * @param bufs - 缓冲区数组（拼接为一条消息）
+   * @param count - 缓冲区数量
+   * @param enqueue_time - 入队时间（毫秒），取出分片时随分片返回，用于统计送达延迟
+   */
+  void enqueue(uint8_t channel, const uv_buf_t *bufs, int count,
+               uint32_t enqueue_time);
+
+  /**
+   * 将一条流式消息加入通道的发送队列
+   * 轮到该消息时每个分片调用一次生产者，直到生产者返回0（结束）或负数（中止）
+   * @param channel - 通道号（调用者保证小于channels()）
+   * @param producer - 生产者回调
+   * @param enqueue_time - 入队时间（毫秒），参见enqueue
+   */
+  void enqueue_stream(uint8_t channel, Producer producer,
+                      uint32_t enqueue_time);
+
+  /**
+   * 是否还有排队的数据
+   */
+  bool has_pending() const { return queued_messages_ > 0; }
+
+  /**
+   * 获取排队的消息字节数（不含通道头和尚未生产的流式数据）
+   */
+  size_t queued_bytes() const { return queued_bytes_; }
+
+  /**
+   * 估算排队数据需要的分片数
+   * @param payload - 每个分片的负载长度（mss - kHeaderSize）
+   */
+  size_t queued_chunks(int payload) const;
+
+  /**
+   * 取出下一个分片（按通道优先级）
+   * @param out - 输出缓冲区（通道头 + 负载），至少max_len字节
+   * @param max_len - 分片最大长度（通常为KCP的mss）
+   * @param payload_len - 输出本分片的负载长度
+   * @param flags - 输出本分片的标志
+   * @param enqueue_time - 输出本分片所属消息的入队时间
+   * @return 分片长度，没有数据时返回0
+   */
+  int next_chunk(char *out, int max_len, int *payload_len, uint8_t *flags,
+                 uint32_t *enqueue_time);
+
+  /**
+   * 处理接收到的分片
+   * 消息完整时通过channel、data、size输出，data在下一次处理同一通道的分片之前有效
+   * @param chunk - 分片数据（含通道头）
+   * @param len - 分片长度
+   * @param max_message_size - 重组后消息的最大长度
+   * @param passthrough - 流式分片是否逐片返回（CHUNK_STREAM），
+   *                      false时与普通消息一样重组（受max_message_size限制）
+   * @param flags - 输出分片标志
+   * @return ChunkResult
+   */
+  int on_chunk(const char *chunk, int len, int max_message_size,
+               bool passthrough, uint8_t *channel, uint8_t *flags,
+               const char **data, size_t *size);
+
+private:
+  // 排队中的消息
+  struct Message {
+    std::string data;  // 消息内容
+    size_t offset;     // 已取出的字节数
+    Producer producer; // 流式消息的生产者（普通消息为空）
+    uint32_t enqueue_time; // 入队时间（毫秒）
+  };
+
+  std::vector<std::deque<Message>> send_queues_; // 各通道的发送队列
+  std::vector<std::string> reassembly_;          // 各通道的重组缓冲区
+  std::vector<bool> in_message_;                 // 各通道是否正在重组消息
+  size_t queued_messages_;                       // 排队的消息数
+  size_t queued_bytes_;                          // 排队的字节数
+};
+
+#endif // KCP_CHANNEL_H
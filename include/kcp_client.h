@@ -1,7 +1,9 @@
 #ifndef KCP_CLIENT_H
 #define KCP_CLIENT_H
 
+#include "kcp_client_handshake.h"
 #include "kcp_connection.h"
+#include <functional>
 #include <memory>
 #include <string>
 #include <uv.h>
@@ -12,6 +14,15 @@
  */
 class KCPClient {
 public:
+  // 握手结果回调：参数(是否成功)
+  // 成功时连接进入CONNECTED状态，失败（超时）时连接已断开
+  using ConnectCallback = std::function<void(bool)>;
+
+  // HELLO重发间隔和握手超时时间（毫秒），参见KCPClientHandshake
+  static const uint32_t kHelloInterval = KCPClientHandshake::kHelloInterval;
+  static const uint32_t kHandshakeTimeout =
+      KCPClientHandshake::kHandshakeTimeout;
+
   /**
    * 构造函数
    * @param loop - libuv事件循环指针
@@ -41,9 +52,26 @@ public:
    *               使用建议：可以由客户端生成，也可以由服务器分配
    *
    * @return 成功返回0，失败返回负数
+   *         注意：启用握手时返回0只表示已开始握手，握手结果通过ConnectCallback通知，
+   *               在此期间发送的数据会在握手完成后发出
    */
   int connect(const std::string &server_ip, int server_port, uint32_t conv);
 
+  /**
+   * 设置是否启用握手（需在connect之前调用，需要服务器同时启用KCPServer::set_handshake）
+   * @param enable - true：connect后先发送HELLO，按服务器回复的cookie重发HELLO，
+   *                 收到ACCEPT后进入CONNECTED状态；kHandshakeTimeout内未完成时断开连接
+   *                 false：connect后直接进入CONNECTED状态（默认）
+   */
+  void set_handshake(bool enable) { handshake_ = enable; }
+
+  /**
+   * 设置握手结果回调函数
+   * 未启用握手时connect成功后立即以true调用
+   * @param cb - 回调函数对象
+   */
+  void set_connect_callback(ConnectCallback cb) { connect_callback_ = cb; }
+
   /**
    * 发送数据到服务器
    * @param data - 数据缓冲区指针
@@ -53,6 +81,89 @@ public:
    */
   int send(const char *data, int len);
 
+  /**
+   * 分散-聚集发送数据到服务器
+   * 多个缓冲区作为一条消息发送，参见KCPConnection::sendv
+   * @param bufs - 缓冲区数组
+   * @param count - 缓冲区数量
+   * @return 成功返回0，失败返回负数
+   */
+  int sendv(const uv_buf_t *bufs, int count);
+
+  /**
+   * 发送数据到指定通道（需先set_channels）
+   * 参见KCPConnection::send_channel
+   * @param channel - 通道号，编号越小优先级越高
+   * @param data - 数据缓冲区指针
+   * @param len - 数据长度
+   * @return 成功返回0，失败返回负数
+   */
+  int send_channel(uint8_t channel, const char *data, int len);
+
+  /**
+   * 流式发送一条大消息（需先set_channels）
+   * 参见KCPConnection::send_stream
+   * @param channel - 通道号
+   * @param producer - 生产者回调
+   * @return 成功返回0，失败返回负数
+   */
+  int send_stream(uint8_t channel, KCPConnection::StreamProducer producer);
+
+  /**
+   * 启用或关闭KCP参数自适应调节（需在connect之前调用）
+   * 启用后按连接的rx_srtt、重传率和nsnd_buf在bounds范围内调整发送窗口、
+   * update间隔、最小RTO和快速重传阈值，set_kcp_config的配置作为初始值
+   * 参见KCPAdaptiveTuner
+   * @param enable - 是否启用（默认关闭）
+   * @param bounds - 调节范围
+   */
+  void set_adaptive_tuning(bool enable, const KCPAdaptiveTuner::Bounds &bounds =
+                                            KCPAdaptiveTuner::Bounds()) {
+    tuning_ = enable;
+    tuning_bounds_ = bounds;
+  }
+
+  /**
+   * 启用或关闭路径MTU探测（需在connect之前调用）
+   * 启用后socket设置DF位，每个连接从set_kcp_config的MTU出发探测[config.min_mtu,
+   * config.max_mtu]内的最大可用值并通过ikcp_setmtu生效，当前值见连接统计的mtu字段
+   * 参见KCPPmtuProber
+   * @param enable - 是否启用（默认关闭）
+   * @param config - 探测配置
+   */
+  void set_pmtu_discovery(bool enable, const KCPPmtuProber::Config &config =
+                                           KCPPmtuProber::Config()) {
+    pmtu_ = enable;
+    pmtu_config_ = config;
+  }
+
+  /**
+   * 设置消息压缩（需在connect之前调用，两端必须一致）
+   * 参见KCPConnection::set_compression，压缩率和耗时见连接统计的compression_ratio等字段
+   * @param config - 压缩配置（默认不压缩）
+   */
+  void set_compression(const KCPCompressor::Config &config) {
+    compression_ = config;
+  }
+
+  /**
+   * 设置发送方向的FEC（需在connect之前调用）
+   * 每data_shards个KCP输出包追加parity_shards个校验包，恢复数量见连接统计的fec_recovered
+   * 参见KCPConnection::set_fec
+   * @param data_shards - 每组数据包数量（1-15），0表示关闭（默认关闭）
+   * @param parity_shards - 每组校验包数量（1-15）
+   */
+  void set_fec(int data_shards, int parity_shards) {
+    fec_data_ = data_shards;
+    fec_parity_ = parity_shards;
+  }
+
+  /**
+   * 设置通道数量（需在connect之前调用，需与服务器一致）
+   * @param count - 通道数量，0表示不启用（默认）
+   */
+  void set_channels(int count) { channels_ = count; }
+
   /**
    * 断开连接
    */
@@ -75,12 +186,47 @@ public:
    */
   void set_data_callback(KCPConnection::DataCallback cb);
 
+  /**
+   * 设置通道数据接收回调函数（需在connect之后调用）
+   * @param cb - 回调函数对象
+   */
+  void set_channel_data_callback(KCPConnection::ChannelDataCallback cb);
+
+  /**
+   * 设置流式消息接收回调函数（需在connect之后调用）
+   * @param cb - 回调函数对象
+   */
+  void set_stream_callback(KCPConnection::StreamCallback cb);
+
+  /**
+   * 设置应用层缓冲区接收方式（替代set_data_callback）
+   * 参见KCPConnection::set_buffer_receiver
+   * @param alloc - 缓冲区分配回调
+   * @param cb - 缓冲区数据回调
+   */
+  void set_buffer_receiver(KCPConnection::BufferAllocator alloc,
+                           KCPConnection::BufferDataCallback cb);
+
   /**
    * 设置连接关闭回调函数
    * @param cb - 回调函数对象
    */
   void set_close_callback(KCPConnection::CloseCallback cb);
 
+  /**
+   * 设置可写回调函数（需在connect之后调用）
+   * 参见KCPConnection::set_writable_callback
+   * @param cb - 回调函数对象
+   */
+  void set_writable_callback(KCPConnection::WritableCallback cb);
+
+  /**
+   * 设置发送队列水位（需在connect之后调用）
+   * 参见KCPConnection::set_send_watermarks
+   */
+  void set_send_watermarks(uint32_t high_packets, uint32_t low_packets,
+                           size_t high_bytes, size_t low_bytes);
+
   /**
    * 设置KCP参数
    * @param nodelay - nodelay模式，建议值：0或1
@@ -94,12 +240,30 @@ public:
   void set_kcp_config(int nodelay, int interval, int resend, int nc, int sndwnd,
                       int rcvwnd, int mtu);
 
+  /**
+   * 设置最大消息长度（应用于之后建立的连接）
+   * 发送超过该长度的消息返回错误，接收到超过该长度的消息时关闭连接
+   * @param size - 最大消息长度，单位字节
+   *               默认值：65536字节（64KB）
+   *               建议范围：1KB-16MB
+   */
+  void set_max_message_size(int size) {
+    max_message_size_ =
+        size > 0 ? size : KCPConnection::kDefaultMaxMessageSize;
+  }
+
   /**
    * 检查是否已连接
    * @return 已连接返回true，否则返回false
    */
   bool is_connected() const;
 
+  /**
+   * 获取连接统计信息
+   * @return 统计信息快照，未连接时所有字段为0
+   */
+  KCPConnection::Stats get_stats() const;
+
   /**
    * 获取当前时间戳（毫秒）
    * @return 当前时间戳（毫秒）
@@ -140,6 +304,11 @@ private:
    */
   void handle_udp_data(const char *data, int len);
 
+  /**
+   * 握手完成：进入CONNECTED状态并发出握手期间排队的数据
+   */
+  void on_handshake_done();
+
   /**
    * 更新连接状态
    */
@@ -160,6 +329,20 @@ private:
   int kcp_sndwnd_;   // 发送窗口
   int kcp_rcvwnd_;   // 接收窗口
   int kcp_mtu_;      // MTU大小
+  int max_message_size_; // 最大消息长度
+  int channels_;         // 通道数量
+  bool tuning_;          // 是否启用参数自适应调节
+  KCPAdaptiveTuner::Bounds tuning_bounds_; // 参数自适应调节范围
+  bool pmtu_;                         // 是否启用路径MTU探测
+  KCPPmtuProber::Config pmtu_config_; // 路径MTU探测配置
+  int fec_data_;                      // FEC每组数据包数量（0表示不启用）
+  int fec_parity_;                    // FEC每组校验包数量
+  KCPCompressor::Config compression_; // 消息压缩配置
+
+  // 握手
+  bool handshake_;                   // 是否启用握手
+  KCPClientHandshake handshake_state_; // 握手状态（cookie、HELLO重发时间）
+  ConnectCallback connect_callback_; // 握手结果回调
 
   char recv_buffer_[65536]; // UDP接收缓冲区（64KB）
 };
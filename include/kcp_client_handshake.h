@@ -0,0 +1,76 @@
+#ifndef KCP_CLIENT_HANDSHAKE_H
+#define KCP_CLIENT_HANDSHAKE_H
+
+#include "kcp_connection.h"
+#include <cstdint>
+
+/**
+ * 客户端握手状态机与控制包处理
+ * KCPClient和KCPClientPool共用：每个正在握手的会话一个对象，保存服务器下发的
+ * cookie和HELLO重发时间；握手完成后会话仍会收到的控制包（会话令牌、路径MTU探测、
+ * 地址验证挑战）也由handle_control处理
+ *
+ * 握手流程：start发送HELLO，收到COOKIE后携带cookie重发HELLO，
+ * 收到ACCEPT（或TOKEN、KCP数据）后由调用方调用complete进入CONNECTED状态；
+ * poll负责按kHelloInterval重发HELLO，kHandshakeTimeout内未完成时返回超时
+ */
+class KCPClientHandshake {
+public:
+  static const uint32_t kHelloInterval = 200;     // HELLO重发间隔（毫秒）
+  static const uint32_t kHandshakeTimeout = 5000; // 握手超时时间（毫秒）
+
+  KCPClientHandshake();
+
+  /**
+   * 开始握手：清除cookie并发送第一个HELLO
+   * @param conn - 处于CONNECTING状态的连接
+   * @param current - 当前时间戳，单位毫秒
+   */
+  void start(KCPConnection *conn, uint32_t current);
+
+  /**
+   * 驱动握手：到达重发间隔时重发HELLO
+   * @param conn - 处于CONNECTING状态的连接
+   * @param current - 当前时间戳，单位毫秒
+   * @return 握手超时返回false（调用方负责断开连接），否则返回true
+   */
+  bool poll(KCPConnection *conn, uint32_t current);
+
+  /**
+   * 获取下一次需要调用poll的时间（HELLO重发时间和握手超时时间中较早的一个）
+   */
+  uint32_t next_time() const;
+
+  /**
+   * 处理一个控制包
+   * @param conn - 控制包所属的连接（conv不一致时忽略）
+   * @param handshake - 连接的握手状态，握手已完成时可以为nullptr（忽略COOKIE）
+   * @param data - 控制包数据
+   * @param len - 数据长度
+   * @param current - 当前时间戳，单位毫秒
+   * @return 控制包表明服务器已接受会话且连接仍处于CONNECTING状态时返回true，
+   *         调用方应完成握手（调用complete并通知上层）
+   */
+  static bool handle_control(KCPConnection *conn, KCPClientHandshake *handshake,
+                             const char *data, int len, uint32_t current);
+
+  /**
+   * 完成握手：进入CONNECTED状态并立即发出握手期间排队的数据
+   * @param conn - 连接
+   * @param current - 当前时间戳，单位毫秒
+   */
+  static void complete(KCPConnection *conn, uint32_t current);
+
+private:
+  /**
+   * 发送HELLO（携带已收到的cookie）
+   */
+  void send_hello(KCPConnection *conn, uint32_t current);
+
+  bool has_cookie_;     // 是否已收到服务器的cookie
+  uint64_t cookie_;     // 服务器下发的cookie
+  uint32_t start_;      // 握手开始时间（毫秒）
+  uint32_t hello_time_; // 上次发送HELLO的时间（毫秒）
+};
+
+#endif // KCP_CLIENT_HANDSHAKE_H
@@ -0,0 +1,338 @@
+#ifndef KCP_CLIENT_POOL_H
+#define KCP_CLIENT_POOL_H
+
+#include "kcp_client_handshake.h"
+#include "kcp_connection.h"
+#include "kcp_connection_table.h"
+#include "kcp_send_pool.h"
+#include "kcp_timer_wheel.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <uv.h>
+#include <vector>
+
+/**
+ * KCP客户端连接池
+ * 在一个事件循环中管理大量出站会话（压测客户端、边缘中继等）：
+ * - 所有会话共享少量UDP socket（按conv分配），收到的数据按conv分发到会话，
+ *   并校验来源为该会话的服务器地址
+ * - 所有会话由一个定时器和时间轮（KCPTimerWheel）按截止时间驱动，
+ *   每个tick只处理到期的会话，与KCPServer的调度方式相同
+ * - 发送经过共享的KCPSendPool
+ *
+ * conv在连接池内必须唯一（即使连接不同的服务器）；握手参见KCPClient::set_handshake
+ */
+class KCPClientPool {
+public:
+  // 握手结果回调：参数(连接指针, 是否成功)
+  // 失败（超时）时连接已从连接池移除，回调返回后释放
+  using ConnectCallback = std::function<void(KCPConnection *, bool)>;
+
+  // 不检测超时时，空闲会话的最长调度间隔（毫秒）
+  static const uint32_t kIdleInterval = 10000;
+
+  // 连接池统计信息
+  struct Stats {
+    uint64_t packets_in;         // 接收的UDP数据报数量
+    uint64_t bytes_in;           // 接收的UDP字节数
+    uint64_t drops_short;        // 丢弃的过短数据报
+    uint64_t drops_partial;      // 丢弃的截断数据报（UV_UDP_PARTIAL）
+    uint64_t drops_no_session;   // conv不存在而被丢弃的数据报
+    uint64_t drops_bad_addr;     // 来源不是会话的服务器地址而被丢弃的数据报
+    uint64_t recv_errors;        // UDP接收错误次数
+    uint64_t sessions_created;   // 累计创建的会话数
+    uint64_t sessions_closed;    // 累计移除的会话数（含超时和握手失败）
+    uint64_t sessions_timed_out; // 累计超时的会话数
+    uint64_t handshake_failures; // 累计握手超时的会话数
+    uint32_t sessions_active;    // 当前会话数
+    uint32_t sessions_connecting; // 正在握手的会话数
+    uint32_t sockets;            // UDP socket数量
+    uint32_t scheduled;          // 时间轮中等待调度的会话数
+  };
+
+  /**
+   * 构造函数
+   * @param loop - libuv事件循环指针
+   */
+  KCPClientPool(uv_loop_t *loop);
+
+  /**
+   * 析构函数
+   * 断开所有会话并关闭socket、定时器和check句柄
+   * 句柄和发送池在关闭回调中释放，事件循环需要在析构之后继续运行
+   * （uv_run或uv_loop_close之前的uv_run(UV_RUN_DEFAULT)）以完成关闭
+   */
+  ~KCPClientPool();
+
+  /**
+   * 设置UDP socket数量（需在第一次connect之前调用）
+   * 会话按 conv % count 分配socket；socket越多，单个socket的接收队列越短，
+   * 也可以分散到对端的多个SO_REUSEPORT工作线程（按源端口哈希）
+   * @param count - socket数量，默认1，范围1-1024
+   */
+  void set_sockets(int count);
+
+  /**
+   * 设置每个UDP socket的收发缓冲区大小（需在第一次connect之前调用）
+   * 许多会话同时重传或收到突发回复时，默认缓冲区很快被填满而丢包
+   * @param bytes - 缓冲区大小，默认4MB（受net.core.rmem_max/wmem_max限制），0表示使用系统默认值
+   */
+  void set_socket_buffer(int bytes) { socket_buffer_ = bytes > 0 ? bytes : 0; }
+
+  /**
+   * 创建一个会话并连接到服务器
+   * 第一次调用时按服务器地址族绑定socket；之后的会话必须使用相同的地址族
+   * @param server_ip - 服务器IP地址
+   * @param server_port - 服务器端口号
+   * @param conv - KCP会话ID（连接池内唯一，不能为0）
+   * @return 连接指针（在会话被移除之前有效），失败返回nullptr
+   *         注意：连接的关闭回调由连接池使用，请通过set_close_callback设置
+   */
+  KCPConnection *connect(const std::string &server_ip, int server_port,
+                         uint32_t conv);
+
+  /**
+   * 断开会话（不排空发送队列）
+   * 需要排空时调用连接的close()，排空完成后自动移除
+   * @param conv - 会话ID
+   */
+  void disconnect(uint32_t conv);
+
+  /**
+   * 断开所有会话并停止接收
+   */
+  void stop();
+
+  /**
+   * 查找会话
+   * @return 连接指针，不存在时返回nullptr
+   */
+  KCPConnection *find(uint32_t conv) const { return connections_.find(conv); }
+
+  /**
+   * 获取会话数量
+   */
+  size_t size() const { return connections_.size(); }
+
+  /**
+   * 遍历所有会话
+   * 注意：回调中不能创建或移除会话
+   */
+  void for_each_connection(const std::function<void(KCPConnection *)> &fn) const;
+
+  /**
+   * 设置是否启用握手（需在connect之前调用，需要服务器同时启用KCPServer::set_handshake）
+   */
+  void set_handshake(bool enable) { handshake_ = enable; }
+
+  /**
+   * 设置握手结果回调函数（未启用握手时connect成功后立即以true调用）
+   */
+  void set_connect_callback(ConnectCallback cb) { connect_callback_ = cb; }
+
+  /**
+   * 设置会话关闭回调函数（会话随后从连接池移除）
+   */
+  void set_close_callback(KCPConnection::CloseCallback cb) {
+    close_callback_ = cb;
+  }
+
+  /**
+   * 设置会话超时时间（应用于之后创建的会话）
+   * @param timeout - 超过该时长未收到服务器数据时断开会话，单位毫秒；0表示不检测（默认）
+   */
+  void set_timeout(uint32_t timeout) { timeout_ = timeout; }
+
+  /**
+   * 设置调度定时器粒度（需在第一次connect之前调用）
+   * @param granularity - 单位毫秒，默认10ms，建议与KCP的interval一致或更小
+   */
+  void set_timer_granularity(uint32_t granularity) {
+    timer_granularity_ = granularity > 0 ? granularity : 1;
+  }
+
+  /**
+   * 设置是否启用批量发送（需在第一次connect之前调用）
+   * 启用后每次事件循环迭代末尾通过sendmmsg发送整批数据，参见KCPSendPool::set_batching
+   */
+  void set_send_batching(bool enable) { send_batching_ = enable; }
+
+  /**
+   * 设置KCP参数（应用于之后创建的会话），参见KCPClient::set_kcp_config
+   */
+  void set_kcp_config(int nodelay, int interval, int resend, int nc, int sndwnd,
+                      int rcvwnd, int mtu);
+
+  /**
+   * 设置最大消息长度（应用于之后创建的会话）
+   */
+  void set_max_message_size(int size) {
+    max_message_size_ =
+        size > 0 ? size : KCPConnection::kDefaultMaxMessageSize;
+  }
+
+  /**
+   * 设置通道数量（应用于之后创建的会话，需与服务器一致）
+   */
+  void set_channels(int count) { channels_ = count; }
+
+  /**
+   * 启用或关闭KCP参数自适应调节（应用于之后创建的会话）
+   */
+  void set_adaptive_tuning(bool enable, const KCPAdaptiveTuner::Bounds &bounds =
+                                            KCPAdaptiveTuner::Bounds()) {
+    tuning_ = enable;
+    tuning_bounds_ = bounds;
+  }
+
+  /**
+   * 启用或关闭路径MTU探测（需在第一次connect之前调用，socket设置DF位）
+   */
+  void set_pmtu_discovery(bool enable, const KCPPmtuProber::Config &config =
+                                           KCPPmtuProber::Config()) {
+    pmtu_ = enable;
+    pmtu_config_ = config;
+  }
+
+  /**
+   * 设置消息压缩（应用于之后创建的会话，需与服务器一致）
+   */
+  void set_compression(const KCPCompressor::Config &config) {
+    compression_ = config;
+  }
+
+  /**
+   * 设置发送方向的FEC（应用于之后创建的会话），参见KCPConnection::set_fec
+   */
+  void set_fec(int data_shards, int parity_shards) {
+    fec_data_ = data_shards;
+    fec_parity_ = parity_shards;
+  }
+
+  /**
+   * 获取统计信息
+   */
+  Stats get_stats() const;
+
+  /**
+   * 获取当前时间戳（毫秒）
+   */
+  static uint32_t get_current_ms();
+
+private:
+  static void on_udp_recv(uv_udp_t *handle, ssize_t nread, const uv_buf_t *buf,
+                          const struct sockaddr *addr, unsigned flags);
+  static void alloc_buffer(uv_handle_t *handle, size_t suggested_size,
+                           uv_buf_t *buf);
+  static void on_timer(uv_timer_t *handle);
+  static void on_flush_check(uv_check_t *handle);
+  static void on_socket_close(uv_handle_t *handle);
+  static void on_timer_close(uv_handle_t *handle);
+  static void on_check_close(uv_handle_t *handle);
+
+  // 析构时正在关闭的socket：libuv在关闭过程中以UV_ECANCELED回调未完成的发送请求，
+  // 发送池由最后一个socket的关闭回调释放
+  struct SocketCloser {
+    size_t remaining;                     // 尚未完成关闭的socket数量
+    std::unique_ptr<KCPSendPool> send_pool; // 析构后接管的发送池
+  };
+
+  /**
+   * 按地址族创建并绑定socket，启动定时器
+   */
+  int open_sockets(int family);
+
+  /**
+   * 关闭所有socket（创建失败时和析构时使用，之后可以重新创建）
+   * @param closer - 析构时接管发送池的关闭记录，为nullptr时连接池继续持有发送池
+   */
+  void close_sockets(SocketCloser *closer = nullptr);
+
+  /**
+   * 处理接收到的UDP数据：按conv分发到会话
+   */
+  void handle_udp_data(const char *data, int len, const struct sockaddr *addr);
+
+  /**
+   * 处理控制包（握手、令牌、挑战、PMTU）
+   */
+  void handle_control(KCPConnection *conn, const char *data, int len);
+
+  /**
+   * 握手完成：进入CONNECTED状态并发出握手期间排队的数据
+   */
+  void on_handshake_done(KCPConnection *conn);
+
+  /**
+   * 推进时间轮，处理到期的会话
+   */
+  void update_connections();
+
+  /**
+   * 处理单个到期会话
+   */
+  void service_connection(uint32_t conv, uint32_t current);
+
+  /**
+   * 根据会话的下次update时间（握手期间为HELLO重发时间）将其加入时间轮
+   */
+  void schedule_connection(KCPConnection *conn, uint32_t current);
+
+  /**
+   * 移除会话（延迟释放，回调中持有的指针在本轮事件处理结束前仍然有效）
+   */
+  void remove_connection(uint32_t conv);
+
+  /**
+   * 连接关闭回调
+   */
+  void on_connection_close(KCPConnection *conn);
+
+  uv_loop_t *loop_;
+  std::vector<std::unique_ptr<uv_udp_t>> sockets_; // 共享的UDP socket
+  int socket_count_;                               // socket数量
+  int socket_buffer_;                              // socket收发缓冲区大小（0为系统默认）
+  int family_;                                     // socket的地址族（未绑定时为0）
+  uv_timer_t *timer_;                              // 调度定时器（在关闭回调中释放）
+  uv_check_t *flush_check_;                        // 批量发送的check句柄（同上）
+  uint32_t timer_granularity_;                     // 定时器粒度（毫秒）
+  bool send_batching_;                             // 是否启用批量发送
+
+  KCPConnectionTable connections_;                  // 会话表（按conv）
+  KCPTimerWheel timer_wheel_;                       // 调度时间轮
+  std::vector<uint32_t> expired_convs_;             // 本次tick到期的会话
+  // 正在握手的会话（握手状态只在CONNECTING期间存在）
+  std::unordered_map<uint32_t, KCPClientHandshake> handshakes_;
+  std::vector<std::unique_ptr<KCPConnection>> closed_connections_; // 待释放的会话
+  std::unique_ptr<KCPSendPool> send_pool_;          // 共享的UDP发送池
+
+  // 会话配置
+  bool handshake_;
+  uint32_t timeout_;
+  int kcp_nodelay_;
+  int kcp_interval_;
+  int kcp_resend_;
+  int kcp_nc_;
+  int kcp_sndwnd_;
+  int kcp_rcvwnd_;
+  int kcp_mtu_;
+  int max_message_size_;
+  int channels_;
+  bool tuning_;
+  KCPAdaptiveTuner::Bounds tuning_bounds_;
+  bool pmtu_;
+  KCPPmtuProber::Config pmtu_config_;
+  int fec_data_;
+  int fec_parity_;
+  KCPCompressor::Config compression_;
+
+  ConnectCallback connect_callback_;
+  KCPConnection::CloseCallback close_callback_;
+  Stats stats_;
+
+  char recv_buffer_[65536]; // UDP接收缓冲区（所有socket共享，回调串行执行）
+};
+
+#endif // KCP_CLIENT_POOL_H
@@ -0,0 +1,134 @@
+#ifndef KCP_COMPRESS_H
+#define KCP_COMPRESS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * 消息压缩（在KCPConnection的send/recv消息边界上进行，两端需要相同的配置）
+ * 编译时找到liblz4/libzstd才启用对应算法（KCP_HAVE_LZ4/KCP_HAVE_ZSTD），
+ * 可用性通过available查询
+ *
+ * 消息格式：
+ *   flag(1) + 原始消息                      （低于阈值或压缩后没有变小）
+ *   flag(1) + 原始长度(4，小端) + 压缩数据  （flag为算法编号）
+ *
+ * 流式上下文模式下，压缩历史在同一个上下文的消息之间保留（LZ4为最近64KB，
+ * 超过64KB的消息单独压缩；zstd为一个不结束的帧），小而重复的消息压缩率更高；每个上下文的消息必须按发送顺序解压，
+ * 因此启用多通道时每个通道使用独立的上下文。流式模式下超过阈值的消息总是以压缩格式发送
+ */
+class KCPCompressor {
+public:
+  // 压缩算法（即消息的flag字节）
+  enum Algorithm {
+    NONE = 0, // 不压缩
+    LZ4 = 1,  // 速度优先
+    ZSTD = 2, // 压缩率优先，可使用训练好的字典
+  };
+
+  // 压缩格式的头部长度（flag + 原始长度）
+  static const int kHeaderSize = 5;
+
+  // 压缩配置
+  struct Config {
+    Algorithm algorithm;    // 压缩算法
+    int threshold;          // 小于该长度的消息不压缩（字节）
+    int level;              // zstd压缩级别；LZ4为加速因子（越大越快、压缩率越低）
+    bool streaming;         // 是否在消息之间保留压缩历史
+    int window_log;         // zstd流式模式的窗口（2^window_log字节，决定每个上下文的内存）
+    std::string dictionary; // zstd字典（如zstd --train的输出，两端必须相同；为空表示不使用）
+
+    Config()
+        : algorithm(NONE), threshold(64), level(1), streaming(false),
+          window_log(16) {}
+  };
+
+  // 压缩统计
+  struct Stats {
+    uint64_t compressed_messages;   // 以压缩格式发送的消息数量
+    uint64_t raw_bytes;             // 参与压缩的消息的原始字节数
+    uint64_t compressed_bytes;      // 压缩后的字节数（含头部）
+    uint64_t compress_time_us;      // 压缩耗时（微秒）
+    uint64_t decompressed_messages; // 解压的消息数量
+    uint64_t decompress_time_us;    // 解压耗时（微秒）
+  };
+
+  /**
+   * 构造函数
+   * @param config - 压缩配置（算法不可用时退化为NONE）
+   * @param contexts - 流式模式的上下文数量（通道数量，未启用多通道时为1）
+   */
+  KCPCompressor(const Config &config, int contexts);
+  ~KCPCompressor();
+
+  /**
+   * 编译时是否启用了该算法
+   */
+  static bool available(Algorithm algorithm);
+
+  /**
+   * 压缩一条消息
+   * @param context - 上下文（通道编号）
+   * @param data - 原始消息
+   * @param len - 消息长度
+   * @param header - 输出不压缩时需要放在消息之前的flag字节
+   * @param out - 输出压缩后的消息（在下一次compress之前有效）；不压缩时为nullptr，
+   *              调用者发送 header(1) + 原始消息
+   * @param out_len - 输出压缩后的消息长度
+   * @return 成功返回true；流式模式下压缩失败返回false，此时该上下文的历史已经
+   *         无法与接收端保持一致，消息不能以任何格式发送
+   */
+  bool compress(int context, const char *data, size_t len, char *header,
+                const char **out, size_t *out_len);
+
+  /**
+   * 解压一条消息
+   * @param context - 上下文（通道编号）
+   * @param data - 收到的消息（含flag）
+   * @param len - 消息长度
+   * @param max_size - 允许的最大原始长度
+   * @param out - 输出原始消息（在下一次decompress之前有效，可能指向data内部）
+   * @param out_len - 输出原始长度
+   * @return 成功返回true，格式错误或解压失败返回false
+   */
+  bool decompress(int context, const char *data, size_t len, size_t max_size,
+                  const char **out, size_t *out_len);
+
+  /**
+   * 压缩格式相对原始消息可能增加的最大长度（接收端的长度检查需要放宽）
+   */
+  static size_t max_overhead(size_t max_size);
+
+  Algorithm algorithm() const { return config_.algorithm; }
+  const Stats &get_stats() const { return stats_; }
+
+private:
+  struct Context;
+
+  /**
+   * 压缩到compress_buf_的头部之后，返回压缩数据长度，失败返回0
+   */
+  size_t compress_block(Context &ctx, const char *data, size_t len);
+
+  /**
+   * 解压（长度必须等于raw_len），返回原始数据，失败返回nullptr
+   */
+  const char *decompress_block(Context &ctx, const char *data, size_t len,
+                               size_t raw_len);
+
+  /**
+   * 获取上下文（非流式模式总是使用同一个），首次使用时创建
+   */
+  Context &context(int index);
+
+  Config config_;
+  std::vector<std::unique_ptr<Context>> contexts_; // 按需创建
+  std::vector<char> compress_buf_;   // 压缩输出
+  std::vector<char> decompress_buf_; // 解压输出（交付回调期间可能调用compress，因此分开）
+  Stats stats_;
+};
+
+#endif // KCP_COMPRESS_H
@@ -2,10 +2,22 @@
 #define KCP_CONNECTION_H
 
 #include "ikcp.h"
+#include "kcp_address.h"
+#include "kcp_channel.h"
+#include "kcp_compress.h"
+#include "kcp_control.h"
+#include "kcp_fec.h"
+#include "kcp_histogram.h"
+#include "kcp_pmtu.h"
+#include "kcp_tuner.h"
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <uv.h>
+#include <vector>
+
+class KCPSendPool;
 
 /**
  * KCP连接类
@@ -24,9 +36,151 @@ public:
   // 数据接收回调：参数(连接指针, 数据缓冲区, 数据长度)
   using DataCallback = std::function<void(KCPConnection *, const char *, int)>;
 
+  // 接收缓冲区分配回调：参数(连接指针, 消息长度)
+  // 返回至少能容纳该长度的应用层缓冲区，返回nullptr表示暂不接收（消息保留在KCP接收队列中；
+  // 启用多通道或压缩时消息已重组/解压，返回nullptr会丢弃该消息）
+  using BufferAllocator = std::function<char *(KCPConnection *, int)>;
+
+  // 缓冲区数据回调：参数(连接指针, 分配回调返回的缓冲区, 数据长度)
+  // 缓冲区由应用层持有，回调返回后仍然有效
+  using BufferDataCallback = std::function<void(KCPConnection *, char *, int)>;
+
   // 连接关闭回调：参数(连接指针)
   using CloseCallback = std::function<void(KCPConnection *)>;
 
+  // 通道数据接收回调：参数(连接指针, 通道号, 数据缓冲区, 数据长度)
+  using ChannelDataCallback =
+      std::function<void(KCPConnection *, uint8_t, const char *, int)>;
+
+  // 流式消息接收事件
+  enum StreamEvent {
+    STREAM_BEGIN = 0, // 消息开始（data为空）
+    STREAM_DATA = 1,  // 消息数据片段
+    STREAM_END = 2,   // 消息结束（data为空）
+    STREAM_ABORT = 3, // 发送方中止了消息（data为空）
+  };
+
+  // 流式消息接收回调：参数(连接指针, 通道号, 事件, 数据缓冲区, 数据长度)
+  // STREAM_DATA的数据只在回调期间有效
+  using StreamCallback = std::function<void(KCPConnection *, uint8_t, StreamEvent,
+                                            const char *, int)>;
+
+  // 流式消息生产者：参数(输出缓冲区, 最大长度)
+  // 返回值：>0表示写入的字节数，0表示消息结束，<0表示中止
+  using StreamProducer = KCPChannelMux::Producer;
+
+  // 可写回调：参数(连接指针)
+  // send因发送队列达到高水位返回kErrQueueFull后，队列回落到低水位以下时触发一次
+  using WritableCallback = std::function<void(KCPConnection *)>;
+
+  // 连接统计信息快照
+  // KCP内部状态在调用get_stats时读取，计数器在事件循环线程中累加（非原子）
+  struct Stats {
+    // KCP内部状态
+    int32_t srtt;      // 平滑RTT（毫秒）
+    int32_t rttvar;    // RTT偏差（毫秒）
+    int32_t rto;       // 当前重传超时（毫秒）
+    uint32_t cwnd;     // 拥塞窗口（包）
+    uint32_t snd_wnd;  // 发送窗口（包）
+    uint32_t rmt_wnd;  // 对端接收窗口（包）
+    uint32_t mtu;      // 当前MTU（字节）
+    uint32_t interval; // 当前update间隔（毫秒）
+    int32_t minrto;    // 当前最小RTO（毫秒）
+    int32_t fastresend; // 当前快速重传阈值（0表示关闭）
+    uint32_t nsnd_que; // 发送队列中的包数量（尚未进入发送窗口）
+    uint32_t nsnd_buf; // 发送缓冲区中的包数量（已发送、等待确认）
+    uint32_t nrcv_que; // 接收队列中的包数量（等待应用层读取）
+    uint32_t nrcv_buf; // 接收缓冲区中的包数量（乱序等待）
+    uint32_t xmit;     // 累计超时重传次数（RTO到期）
+    uint32_t fast_retransmits; // 累计快速重传次数（被后续ACK跨越）
+    uint32_t window_probes;    // 累计发送的窗口探测次数（对端窗口为0）
+    uint32_t dead_links;       // 是否因重传次数达到dead_link而判定链路失效（0或1）
+
+    // UDP层计数
+    uint64_t packets_in;   // 输入KCP的UDP数据包数量
+    uint64_t bytes_in;     // 输入KCP的UDP字节数
+    uint64_t packets_out;  // 输出的UDP数据包数量（含send_udp_direct）
+    uint64_t bytes_out;    // 输出的UDP字节数
+    uint64_t input_errors; // ikcp_input失败次数
+    uint64_t send_errors;  // UDP发送立即失败的次数（不计入packets_out/bytes_out）
+
+    // 消息层计数
+    uint64_t messages_sent;     // 成功提交的消息数量
+    uint64_t bytes_sent;        // 成功提交的消息字节数
+    uint64_t messages_received; // 交付给应用层的消息数量
+    uint64_t bytes_received;    // 交付给应用层的消息字节数
+
+    // 可靠送达延迟（从send入队到最后一个分片被确认，含通道队列和发送队列的排队时间，
+    // 每条消息一个样本，毫秒）
+    uint32_t pending_messages; // 已发送、尚未被完全确认的消息数量
+    uint64_t ack_latency_count; // 已确认的消息数量
+    uint32_t ack_latency_p50;   // 50百分位
+    uint32_t ack_latency_p99;   // 99百分位
+    uint32_t ack_latency_p999;  // 99.9百分位
+    uint32_t ack_latency_max;   // 最大值
+
+    // 背压
+    uint64_t pending_bytes;    // 已提交、尚未被完全确认的消息字节数
+    uint64_t queue_full;       // 因达到高水位被拒绝的send次数
+    uint64_t writable_events;  // 触发可写回调的次数
+
+    // 自适应调节（未启用时为0）
+    uint64_t tuner_adjustments; // 调整参数的次数
+    double loss_ratio;          // 最近一个采样周期的重传率
+
+    // 路径MTU探测（当前MTU见mtu字段）
+    uint64_t pmtu_probes;  // 已发送的探测包数量
+    uint64_t pmtu_updates; // MTU被探测结果修改的次数
+
+    // 前向纠错（与xmit、fast_retransmits对比可以看出FEC替代了多少重传）
+    uint64_t fec_parity_sent; // 已发送的校验包数量
+    uint64_t fec_recovered;   // 通过校验包恢复的数据包数量
+    uint64_t fec_unrecovered; // 分片不足、无法恢复的组数
+
+    // 消息压缩（未启用时为0）
+    uint64_t compressed_messages;   // 以压缩格式发送的消息数量
+    uint64_t compress_raw_bytes;    // 这些消息的原始字节数
+    uint64_t compress_bytes;        // 压缩后的字节数（含头部）
+    double compression_ratio;       // compress_bytes / compress_raw_bytes
+    uint64_t compress_time_us;      // 压缩耗时（微秒）
+    uint64_t decompress_time_us;    // 解压耗时（微秒）
+  };
+
+  // 重传事件类型（与ikcp.h中的IKCP_EVENT_*一致）
+  enum Event {
+    EVENT_RTO_RETRANS = IKCP_EVENT_RTO_RETRANS,   // 超时重传
+    EVENT_FAST_RETRANS = IKCP_EVENT_FAST_RETRANS, // 快速重传
+    EVENT_WND_PROBE = IKCP_EVENT_WND_PROBE,       // 窗口探测
+    EVENT_DEAD_LINK = IKCP_EVENT_DEAD_LINK        // 链路失效
+  };
+
+  // 重传事件回调：参数(连接指针, 事件类型, 数据段序号, 该段已发送次数, 当前RTO)
+  // 窗口探测事件的序号和发送次数为0，RTO为当前探测等待时间
+  using EventCallback =
+      std::function<void(KCPConnection *, Event, uint32_t, uint32_t, uint32_t)>;
+
+  // 默认最大消息长度（64KB）
+  static const int kDefaultMaxMessageSize = 64 * 1024;
+
+  // send返回值：消息超过最大长度
+  static const int kErrMessageTooLarge = -100;
+
+  // send返回值：发送队列达到高水位，消息未被接受（等待可写回调后重试）
+  static const int kErrQueueFull = -101;
+
+  // send返回值：流式压缩失败，两端的压缩历史无法再保持一致，连接已关闭
+  static const int kErrCompressFailed = -102;
+
+  // 默认排空超时时间（毫秒）
+  static const uint32_t kDefaultDrainTimeout = 5000;
+
+  // 排空期间的KCP更新间隔（毫秒，ikcp_interval的下限）
+  static const int kDrainInterval = 10;
+
+  // 调度回调：参数(连接指针)
+  // KCP有新的待处理数据（如调用了send）时触发，用于通知调度器尽快update
+  using ScheduleCallback = std::function<void(KCPConnection *)>;
+
   /**
    * 构造函数
    * @param conv - KCP会话ID（Conversation ID）
@@ -140,7 +294,7 @@ public:
 
   /**
    * 获取等待发送的包数量
-   * @return 发送队列中等待发送的包数量
+   * @return 发送队列中等待发送的包数量（启用多通道时含通道队列中尚未分片的估算值）
    *         用于流量控制，避免发送队列过长
    */
   int get_waitsnd() const;
@@ -151,10 +305,141 @@ public:
    * @param len - 数据长度
    *              建议范围：1字节 - 任意长度（KCP会自动分片）
    *              注意：大数据会被自动分成多个包发送
+   *              注意：不能超过set_max_message_size设置的最大消息长度
+   *              注意：CONNECTING状态下数据只进入发送队列，握手完成后发出
    * @return 成功返回0，失败返回负数
+   *         kErrMessageTooLarge：消息超过最大长度
+   *         kErrQueueFull：发送队列达到高水位（参见set_send_watermarks）
+   *         kErrCompressFailed：流式压缩失败（连接已关闭，参见set_compression）
    */
   int send(const char *data, int len);
 
+  /**
+   * 分散-聚集发送（可靠传输，通过KCP）
+   * 多个缓冲区作为一条消息发送，KCP分片时直接从各缓冲区复制到数据段，
+   * 无需先拼接（如消息头 + 消息体 + 消息尾）
+   * @param bufs - 缓冲区数组
+   * @param count - 缓冲区数量
+   *                建议范围：1-16
+   * @return 成功返回0，失败返回负数
+   *         kErrMessageTooLarge：各缓冲区总长度超过最大消息长度
+   *         kErrQueueFull：发送队列达到高水位
+   *         kErrCompressFailed：流式压缩失败（连接已关闭，参见set_compression）
+   */
+  int sendv(const uv_buf_t *bufs, int count);
+
+  /**
+   * 设置通道数量（启用多通道复用，需在收发数据之前调用，两端必须一致）
+   * 启用后每条消息按分片在各通道之间交错发送，通道0优先级最高，
+   * 大消息不会阻塞其他通道的小消息，参见KCPChannelMux
+   * @param count - 通道数量
+   *                0：不启用（默认）
+   *                范围：1-256
+   *                注意：只支持消息模式（set_stream_mode(0)），
+   *                      启用后set_buffer_receiver在重组后复制一次，send/sendv发送到通道0
+   */
+  void set_channels(int count);
+
+  /**
+   * 设置消息压缩（参见KCPCompressor，需在收发数据之前调用，两端必须一致）
+   * 在send/recv的消息边界上压缩：短于config.threshold的消息只增加1字节flag，
+   * 流式模式下每个通道保留各自的压缩历史，压缩失败时两端的历史无法再保持一致，
+   * send返回kErrCompressFailed并关闭连接（非流式模式下回退为原始消息）。
+   * 流式发送（send_stream）的消息不压缩，启用后set_buffer_receiver在解压后复制一次
+   * @param config - 压缩配置，algorithm为NONE时关闭
+   */
+  void set_compression(const KCPCompressor::Config &config);
+
+  /**
+   * 启用或关闭KCP参数自适应调节（参见KCPAdaptiveTuner）
+   * 启用后在建立连接的状态下按bounds.sample_interval周期在线调整发送窗口、
+   * update间隔、最小RTO和快速重传阈值；初始值仍来自ikcp_nodelay/ikcp_wndsize的配置
+   * @param enable - 是否启用
+   * @param bounds - 调节范围
+   */
+  void set_adaptive_tuning(bool enable, const KCPAdaptiveTuner::Bounds &bounds =
+                                            KCPAdaptiveTuner::Bounds());
+
+  /**
+   * 启用或关闭路径MTU探测（参见KCPPmtuProber，需在init_kcp之后调用）
+   * 启用后在建立连接的状态下发送PMTU_PROBE控制包，确认的MTU通过ikcp_setmtu立即生效；
+   * socket需要设置DF位（KCPPmtuProber::set_dont_fragment），否则探测包会被IP分片而总能通过
+   * @param enable - 是否启用
+   * @param config - 探测配置
+   */
+  void set_pmtu_discovery(bool enable, const KCPPmtuProber::Config &config =
+                                           KCPPmtuProber::Config());
+
+  /**
+   * 处理PMTU_PROBE/PMTU_ACK控制包（调用者已确认来源为会话地址）
+   * 收到探测时回复确认（未启用探测也会回复），收到确认时推进本端的探测
+   * @return 是否为PMTU控制包
+   */
+  bool on_pmtu_control(const char *data, int len);
+
+  /**
+   * 启用或关闭本端发送方向的FEC（参见KCPFecEncoder，需在init_kcp之后调用）
+   * 每data_shards个KCP输出包追加parity_shards个校验包，单个丢包无需等待RTO即可恢复；
+   * KCP的MTU相应减小KCPFecEncoder::kOverhead字节，UDP包长不变。
+   * 接收端总能解码FEC包，不需要预先配置
+   * @param data_shards - 每组数据包数量（1-15），0表示关闭
+   * @param parity_shards - 每组校验包数量（1-15）
+   */
+  void set_fec(int data_shards, int parity_shards);
+
+  /**
+   * 是否跟随对端启用FEC：收到FEC包时以相同的参数启用本端发送方向的FEC
+   * （本端已启用时不修改）
+   */
+  void set_fec_auto(bool enable) { fec_auto_ = enable; }
+
+  /**
+   * 本端发送方向是否启用了FEC
+   */
+  bool fec_enabled() const { return fec_encoder_ != nullptr; }
+
+  /**
+   * 获取通道数量（未启用时返回0）
+   */
+  int get_channels() const { return mux_ ? mux_->channels() : 0; }
+
+  /**
+   * 发送数据到指定通道（可靠传输）
+   * @param channel - 通道号，编号越小优先级越高
+   * @param data - 数据缓冲区指针
+   * @param len - 数据长度
+   * @return 成功返回0，失败返回负数
+   *         -1：未启用多通道或通道号越界
+   *         kErrMessageTooLarge：消息超过最大长度
+   *         kErrQueueFull：发送队列达到高水位
+   *         kErrCompressFailed：流式压缩失败（连接已关闭，参见set_compression）
+   */
+  int send_channel(uint8_t channel, const char *data, int len);
+
+  /**
+   * 分散-聚集发送到指定通道
+   * @param channel - 通道号
+   * @param bufs - 缓冲区数组
+   * @param count - 缓冲区数量
+   * @return 同send_channel
+   */
+  int sendv_channel(uint8_t channel, const uv_buf_t *bufs, int count);
+
+  /**
+   * 流式发送一条大消息（需启用多通道）
+   * 不预先复制或分片整条消息：轮到该消息且发送窗口有空间时才调用producer
+   * 填充下一个分片（每次最多mss - 2字节），因此消息长度不受max_message_size
+   * 和IKCP_WND_RCV的限制，发送端内存占用与窗口大小相当
+   * 对端通过set_stream_callback逐片接收（未设置时按普通消息重组）
+   * producer在事件循环线程中被调用，可以在其中调用send等接口
+   * @param channel - 通道号
+   * @param producer - 生产者回调，返回0结束消息，返回负数中止消息
+   * @return 成功返回0，失败返回负数
+   *         -1：未启用多通道、通道号越界或producer为空
+   *         kErrQueueFull：发送队列达到高水位
+   */
+  int send_stream(uint8_t channel, StreamProducer producer);
+
   /**
    * 直接发送UDP数据（不可靠传输，不经过KCP）
    * @param data - 数据缓冲区指针
@@ -202,6 +487,14 @@ public:
    */
   void update(uint32_t current);
 
+  /**
+   * 立即发出发送队列中的数据（不等待下一个interval）
+   * 一次调用中多条消息的数据段合并到MTU大小的UDP包中；
+   * 适合在一批send之后调用一次，而不是每条消息调用一次
+   * 注意：第一次update之前调用无效
+   */
+  void flush();
+
   /**
    * 检查下次需要update的时间
    * @param current - 当前时间戳，单位毫秒
@@ -209,25 +502,156 @@ public:
    */
   uint32_t check(uint32_t current);
 
+  /**
+   * 检查KCP是否空闲
+   * 空闲指发送队列、发送缓冲区、待发送ACK和窗口探测均为空
+   * 空闲连接在收到数据或调用send之前无需update
+   * @return 空闲返回true，否则返回false
+   */
+  bool is_idle() const;
+
+  /**
+   * 计算下次需要update的时间
+   * 空闲时返回idle_deadline，否则返回check(current)与idle_deadline中较早者
+   * @param current - 当前时间戳，单位毫秒
+   * @param idle_deadline - 空闲时的截止时间（通常为空闲超时时间）
+   * @return 下次需要调用update的时间戳（毫秒）
+   */
+  uint32_t next_update_time(uint32_t current, uint32_t idle_deadline);
+
   /**
    * 接收数据
    * 从KCP接收缓冲区读取数据
+   * 使用线程内共享的接收缓冲区（按ikcp_peeksize扩容），连接本身不持有接收缓冲区；
+   * 设置了set_buffer_receiver时直接接收到应用层缓冲区
+   * 注意：对端发送的消息超过最大消息长度时关闭连接，不会截断
    * @return 如果有数据返回true，否则返回false
    */
   bool recv();
 
+  /**
+   * 设置最大消息长度
+   * 发送时超过该长度返回kErrMessageTooLarge，接收时超过该长度视为协议错误并关闭连接
+   * @param size - 最大消息长度，单位字节
+   *               默认值：65536字节（64KB）
+   *               建议范围：1KB-16MB
+   *               注意：消息模式下单条消息的分片数不能超过接收窗口，
+   *                     实际上限约为 min(rcvwnd, 127) * (mtu - 24)
+   */
+  void set_max_message_size(int size) {
+    max_message_size_ = size > 0 ? size : kDefaultMaxMessageSize;
+  }
+
+  /**
+   * 获取最大消息长度
+   */
+  int get_max_message_size() const { return max_message_size_; }
+
   /**
    * 设置数据接收回调函数
    * @param cb - 回调函数对象
    */
   void set_data_callback(DataCallback cb) { data_callback_ = cb; }
 
+  /**
+   * 设置通道数据接收回调函数（启用多通道时）
+   * 未设置时重组后的消息交给set_data_callback设置的回调
+   * @param cb - 回调函数对象
+   */
+  void set_channel_data_callback(ChannelDataCallback cb) {
+    channel_data_callback_ = cb;
+  }
+
+  /**
+   * 设置流式消息接收回调函数（启用多通道时）
+   * 设置后send_stream发送的消息按BEGIN、DATA…、END（或ABORT）逐片交付，不做重组；
+   * 未设置时按普通消息重组后交给数据回调（超过最大消息长度时关闭连接）
+   * @param cb - 回调函数对象
+   */
+  void set_stream_callback(StreamCallback cb) { stream_callback_ = cb; }
+
+  /**
+   * 设置应用层缓冲区接收方式（替代set_data_callback）
+   * 每条消息先通过alloc获取应用层缓冲区，KCP直接把各分片从数据段复制到该缓冲区，
+   * 不经过中间的接收缓冲区，应用层可以直接持有该缓冲区（如作为消息对象的存储）
+   * 启用多通道或压缩时消息先重组/解压，再复制一次到alloc返回的缓冲区；
+   * 此时消息已离开KCP接收队列，alloc返回nullptr会丢弃该消息（记录警告日志）。
+   * 设置了set_channel_data_callback时按通道回调优先
+   * @param alloc - 缓冲区分配回调，传入空函数对象时恢复使用set_data_callback
+   * @param cb - 缓冲区数据回调
+   */
+  void set_buffer_receiver(BufferAllocator alloc, BufferDataCallback cb) {
+    buffer_allocator_ = alloc;
+    buffer_data_callback_ = cb;
+  }
+
   /**
    * 设置连接关闭回调函数
    * @param cb - 回调函数对象
    */
   void set_close_callback(CloseCallback cb) { close_callback_ = cb; }
 
+  /**
+   * 设置发送队列水位（背压）
+   * 未确认的包数（ikcp_waitsnd）或字节数达到任一高水位时send返回kErrQueueFull，
+   * 两者都回落到低水位以下后在update中触发可写回调
+   * @param high_packets - 包数高水位，0表示不限制
+   *                       建议值：2-4倍发送窗口
+   * @param low_packets - 包数低水位（不大于高水位）
+   *                      建议值：发送窗口大小
+   * @param high_bytes - 字节数高水位，0表示不限制
+   * @param low_bytes - 字节数低水位（不大于高水位）
+   */
+  void set_send_watermarks(uint32_t high_packets, uint32_t low_packets,
+                           size_t high_bytes, size_t low_bytes);
+
+  /**
+   * 设置可写回调函数
+   * @param cb - 回调函数对象
+   */
+  void set_writable_callback(WritableCallback cb) { writable_callback_ = cb; }
+
+  /**
+   * 发送队列是否低于高水位（send不会返回kErrQueueFull）
+   */
+  bool is_writable() const;
+
+  /**
+   * 设置重传事件回调函数
+   * 在ikcp_flush中同步触发，用于统计逐连接的重传分布（无需开启KCP文本日志）
+   * 未设置时只累加计数器（见Stats），没有额外开销
+   * @param cb - 回调函数对象，传入空函数对象时关闭回调
+   */
+  void set_event_callback(EventCallback cb);
+
+  /**
+   * 设置调度回调函数
+   * 由服务器设置，应用层一般无需调用
+   * @param cb - 回调函数对象
+   */
+  void set_schedule_callback(ScheduleCallback cb) { schedule_callback_ = cb; }
+
+  /**
+   * 设置UDP发送池
+   * 设置后output通过发送池复用发送请求和缓冲区，未设置时每个包单独堆分配
+   * @param pool - 发送池指针（由服务器持有，必须比连接存活更久）
+   */
+  void set_send_pool(KCPSendPool *pool) { send_pool_ = pool; }
+
+  /**
+   * 获取统计信息快照
+   * 只能在连接所属的事件循环线程中调用
+   * @return 统计信息（RTT、RTO、窗口、队列深度、收发计数等）
+   */
+  Stats get_stats() const;
+
+  /**
+   * 获取可靠送达延迟直方图
+   * 每条消息从send入队到最后一个分片被确认（snd_una越过）的时间，单位毫秒
+   * 可以与其他连接的直方图合并（KCPHistogram::merge）
+   */
+  const KCPHistogram &get_latency_histogram() const { return ack_latency_; }
+
   /**
    * 获取会话ID
    */
@@ -250,6 +674,12 @@ public:
    */
   void update_active_time(uint32_t current) { last_active_time_ = current; }
 
+  /**
+   * 获取最后活跃时间
+   * @return 最后活跃时间戳，单位毫秒
+   */
+  uint32_t get_active_time() const { return last_active_time_; }
+
   /**
    * 检查连接是否超时
    * @param current - 当前时间戳，单位毫秒
@@ -261,17 +691,76 @@ public:
   bool is_timeout(uint32_t current, uint32_t timeout) const;
 
   /**
-   * 关闭连接
+   * 关闭连接（优雅关闭）
+   * 发送队列为空时立即关闭；否则进入DISCONNECTING状态，不再接受新数据，
+   * 以kDrainInterval的间隔继续update，直到已发送数据全部被确认或排空超时，
+   * 然后转为DISCONNECTED并调用关闭回调
    */
   void close();
 
+  /**
+   * 立即关闭连接（丢弃未确认的数据）
+   * 用于超时、协议错误等无法继续传输的情况
+   */
+  void abort();
+
+  /**
+   * 设置排空超时时间（调用close之前设置有效）
+   * @param timeout - 排空超时时长，单位毫秒
+   *                  默认值：kDefaultDrainTimeout（5000ms）
+   *                  0：不排空，close时立即关闭
+   */
+  void set_drain_timeout(uint32_t timeout) { drain_timeout_ = timeout; }
+
   /**
    * 获取对端地址
    */
-  const struct sockaddr *get_addr() const {
-    return (const struct sockaddr *)&addr_;
+  const struct sockaddr *get_addr() const { return addr_.get(); }
+
+  /**
+   * 获取对端地址（紧凑形式，用于比较和打印）
+   */
+  const KCPAddress &get_address() const { return addr_; }
+
+  /**
+   * 切换对端地址（连接迁移）
+   * 只替换输出地址，KCP控制块（窗口、RTT、未确认数据）保持不变，
+   * 之后的输出（包括重传）都发往新地址
+   * @param addr - 新的对端地址（调用者负责验证）
+   */
+  void set_address(const struct sockaddr *addr) { addr_.assign(addr); }
+
+  /**
+   * 设置会话令牌（服务器生成后下发；客户端收到TOKEN包后保存）
+   */
+  void set_session_token(const KCPSessionToken &token) {
+    token_ = token;
+    has_token_ = true;
+  }
+
+  /**
+   * 获取会话令牌，没有令牌时返回nullptr
+   */
+  const KCPSessionToken *get_session_token() const {
+    return has_token_ ? &token_ : nullptr;
   }
 
+  /**
+   * 设置对端是否已确认收到令牌（服务器端使用）
+   */
+  void set_token_confirmed(bool confirmed) { token_confirmed_ = confirmed; }
+
+  /**
+   * 对端是否已确认收到令牌
+   */
+  bool is_token_confirmed() const { return token_confirmed_; }
+
+  /**
+   * 最近一次发送控制包（TOKEN/CHALLENGE）的时间，用于限制重发频率
+   */
+  uint32_t get_control_time() const { return control_time_; }
+  void set_control_time(uint32_t current) { control_time_ = current; }
+
 private:
   /**
    * KCP输出回调函数（静态）
@@ -284,6 +773,13 @@ private:
    */
   static int udp_output(const char *buf, int len, ikcpcb *kcp, void *user);
 
+  /**
+   * KCP事件回调函数（静态）
+   * ikcp_flush发生重传、窗口探测或链路失效时调用
+   */
+  static void kcp_event(int event, uint32_t sn, uint32_t xmit, uint32_t rto,
+                        ikcpcb *kcp, void *user);
+
   /**
    * 实际的UDP数据发送函数
    * @param buf - 数据缓冲区
@@ -292,18 +788,195 @@ private:
    */
   int output(const char *buf, int len);
 
+  /**
+   * 记录一条已提交到KCP的消息（启用多通道时为一个分片）
+   * 在ikcp_send/ikcp_sendv成功后调用，消息最后一个分片的序号在此时确定
+   * @param len - 消息长度（分片的负载长度）
+   * @param enqueue_time - 消息入队时间（send调用时间，毫秒）
+   * @param last - 是否为消息的最后一个分片，只有最后一个分片被确认时记录送达延迟
+   */
+  void track_pending(int len, uint32_t enqueue_time, bool last);
+
+  /**
+   * 弹出已被完全确认的消息并记录送达延迟
+   * 在ikcp_input之后调用（snd_una只会在输入ACK/UNA时前进）
+   */
+  void ack_pending();
+
+  /**
+   * 获取当前时间戳（毫秒，单调时钟，与KCPServer/KCPClient的时间基准一致）
+   */
+  static uint32_t now_ms();
+
 private:
+  /**
+   * 转为DISCONNECTED状态并调用关闭回调
+   */
+  void finish_close();
+
+  /**
+   * 发送队列是否已回落到低水位以下
+   */
+  bool below_low_watermark() const;
+
+  /**
+   * 未确认及排队中的消息字节数（含通道队列）
+   */
+  uint64_t queued_bytes() const;
+
+  /**
+   * 发送前的公共检查（send、sendv、sendv_channel、send_stream共用）
+   * 依次检查连接状态、消息长度和发送队列水位；队列达到高水位时计入queue_full
+   * 并在回落到低水位以下后触发可写回调
+   * @param total - 消息长度（流式发送时长度未知，传0）
+   * @return 可以发送返回0，否则返回send的错误码
+   */
+  int check_sendable(size_t total);
+
+  /**
+   * 将消息加入通道队列并尝试分片
+   */
+  int enqueue_channel(uint8_t channel, const uv_buf_t *bufs, int count,
+                      size_t total);
+
+  /**
+   * 压缩消息后发送（启用多通道时进入通道队列）
+   */
+  int send_compressed(uint8_t channel, const uv_buf_t *bufs, int count,
+                      size_t total);
+
+  /**
+   * 解压收到的消息，失败时记录日志（协议错误）
+   */
+  bool decompress_message(uint8_t channel, const char *data, size_t len,
+                          const char **message, size_t *size);
+
+  /**
+   * 发送窗口还能容纳的分片数（按snd_wnd、rmt_wnd、cwnd中的最小值）
+   */
+  uint32_t channel_room() const;
+
+  /**
+   * 按通道优先级取出分片，填充到即将进入发送窗口的数量为止
+   * 保持KCP发送队列几乎为空，新到的高优先级消息只需等待已在途的分片；
+   * 分片交给KCP失败时关闭连接
+   */
+  void pump_channels();
+
+  /**
+   * 处理接收到的通道分片，消息完整时交付给应用层
+   * @return 协议错误返回false
+   */
+  bool deliver_chunk(const char *data, int len);
+
+  /**
+   * 把重组或解压后的完整消息交付给应用层
+   * 设置了缓冲区接收方式时分配应用层缓冲区并复制一次
+   */
+  void deliver_message(uint8_t channel, const char *message, size_t size);
+
+  /**
+   * 推进路径MTU探测，发送探测包
+   */
+  void poll_pmtu(uint32_t current);
+
+  /**
+   * 修改KCP的MTU（探测结果）
+   * @param mtu - 路径MTU（启用FEC时KCP的MTU再减去FEC包头）
+   */
+  void apply_mtu(uint32_t mtu);
+
+  /**
+   * FEC使UDP包增加的长度（未启用时为0）
+   */
+  int fec_overhead() const {
+    return fec_encoder_ ? KCPFecEncoder::kOverhead : 0;
+  }
+
+  /**
+   * 将KCP输出包编码为FEC数据包发送，组满时发送校验包
+   */
+  int output_fec(const char *buf, int len);
+
+  /**
+   * 发送编码器中已生成的校验包
+   */
+  void send_fec_parity();
+
+  /**
+   * 处理FEC包：交付数据包和恢复出的数据包
+   */
+  int input_fec(const char *data, int len);
+
+  /**
+   * 将一个KCP包输入协议栈
+   */
+  int input_kcp(const char *data, int len);
+
+  /**
+   * 将流式分片交付给流式消息接收回调
+   */
+  void deliver_stream_chunk(uint8_t channel, uint8_t flags, const char *data,
+                            int len);
+
+  // 等待确认的消息
+  struct PendingMessage {
+    uint32_t last_sn;      // 最后一个分片的序号
+    uint32_t enqueue_time; // 入队时间（毫秒）
+    int len;               // 消息长度（分片的负载长度）
+    bool last;             // 是否为消息的最后一个分片（确认时记录送达延迟）
+  };
+
   ikcpcb *kcp_;                  // KCP控制块指针
   uint32_t conv_;                // 会话ID
   uv_udp_t *udp_handle_;         // UDP句柄
-  struct sockaddr_storage addr_; // 对端地址
+  KCPSendPool *send_pool_;       // UDP发送池（可为空）
+  KCPAddress addr_;              // 对端地址（IPv4/IPv6）
   State state_;                  // 连接状态
   uint32_t last_active_time_;    // 最后活跃时间（毫秒）
+  int max_message_size_;         // 最大消息长度（字节）
+  uint32_t drain_timeout_;       // 排空超时时长（毫秒）
+  uint32_t drain_deadline_;      // 排空截止时间（DISCONNECTING状态下有效）
+  Stats counters_;               // 统计计数器（KCP内部状态字段在get_stats时填充）
+
+  // 等待确认的消息列表（按序号递增），pending_head_之前的元素已被确认
+  std::vector<PendingMessage> pending_;
+  size_t pending_head_;
+  uint64_t pending_bytes_;    // 未确认消息的总字节数
+  uint32_t pending_messages_; // 未确认的消息数（多通道时不计未结束消息的分片）
+
+  // 发送队列水位（0表示不限制）
+  uint32_t high_packets_;
+  uint32_t low_packets_;
+  size_t high_bytes_;
+  size_t low_bytes_;
+  bool write_blocked_; // send返回过kErrQueueFull、尚未触发可写回调
+
+  std::unique_ptr<KCPChannelMux> mux_; // 多通道复用（未启用时为空）
+  std::unique_ptr<KCPAdaptiveTuner> tuner_; // 参数自适应调节（未启用时为空）
+  std::unique_ptr<KCPPmtuProber> prober_;   // 路径MTU探测（未启用时为空）
+  std::unique_ptr<KCPFecEncoder> fec_encoder_; // FEC编码（本端未启用时为空）
+  std::unique_ptr<KCPFecDecoder> fec_decoder_; // FEC解码（收到第一个FEC包时创建）
+  bool fec_auto_; // 收到FEC包时跟随对端启用FEC
+  std::unique_ptr<KCPCompressor> compressor_; // 消息压缩（未启用时为空）
+  bool pumping_; // 正在分片（流式生产者中调用send时不重入）
+  KCPHistogram ack_latency_; // 可靠送达延迟直方图
+
+  // 会话令牌（连接迁移时验证新地址）
+  KCPSessionToken token_;
+  bool has_token_;
+  bool token_confirmed_;
+  uint32_t control_time_;
 
   DataCallback data_callback_;   // 数据接收回调
+  BufferAllocator buffer_allocator_;         // 应用层缓冲区分配回调
+  BufferDataCallback buffer_data_callback_;  // 应用层缓冲区数据回调
   CloseCallback close_callback_; // 连接关闭回调
-
-  char recv_buffer_[1024 * 64]; // 接收缓冲区（64KB，建议范围：4KB-128KB）
+  ScheduleCallback schedule_callback_; // 调度回调
+  EventCallback event_callback_;       // 重传事件回调
+  WritableCallback writable_callback_; // 可写回调
+  ChannelDataCallback channel_data_callback_; // 通道数据接收回调
+  StreamCallback stream_callback_;            // 流式消息接收回调
 };
 
 #endif // KCP_CONNECTION_H
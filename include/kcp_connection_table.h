@@ -0,0 +1,95 @@
+#ifndef KCP_CONNECTION_TABLE_H
+#define KCP_CONNECTION_TABLE_H
+
+#include "kcp_connection.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * KCP连接表
+ * 以conv为key的开放寻址（线性探测）哈希表，替代std::map
+ *
+ * 内存布局：
+ * - 索引数组：每个槽位只有conv和稠密数组下标（8字节），查找时不会访问连接对象
+ * - 稠密数组：连续存放所有连接指针，遍历时没有树节点跳转
+ *
+ * 连接对象独立分配，插入/删除/扩容都不会移动连接对象，
+ * 回调中持有的KCPConnection*在连接被移除之前始终有效
+ */
+class KCPConnectionTable {
+public:
+  KCPConnectionTable();
+
+  /**
+   * 查找连接
+   * @param conv - 会话ID
+   * @return 找到返回连接指针，否则返回nullptr
+   */
+  KCPConnection *find(uint32_t conv) const;
+
+  /**
+   * 插入连接
+   * 调用者需保证该conv尚不存在
+   * @param conn - 连接对象（所有权转移给连接表）
+   * @return 连接指针
+   */
+  KCPConnection *insert(std::unique_ptr<KCPConnection> conn);
+
+  /**
+   * 移除连接
+   * @param conv - 会话ID
+   * @return 被移除的连接对象（所有权转移给调用者），不存在时返回空
+   */
+  std::unique_ptr<KCPConnection> remove(uint32_t conv);
+
+  /**
+   * 清空所有连接
+   */
+  void clear();
+
+  /**
+   * 获取连接数量
+   */
+  size_t size() const { return dense_.size(); }
+
+  /**
+   * 按稠密数组下标访问连接（用于遍历）
+   * 注意：移除连接会把最后一个连接移动到被移除的位置
+   * @param index - 下标，范围[0, size())
+   */
+  KCPConnection *at(size_t index) const { return dense_[index].get(); }
+
+private:
+  // 索引槽位
+  struct Slot {
+    uint32_t conv;  // 会话ID
+    int32_t index;  // 稠密数组下标，-1表示空槽位
+  };
+
+  /**
+   * conv哈希函数（整数混洗，避免连续conv聚集在相邻槽位）
+   */
+  static uint32_t hash(uint32_t conv);
+
+  /**
+   * 查找conv所在的槽位
+   * @return 找到返回槽位下标，否则返回-1
+   */
+  ptrdiff_t find_slot(uint32_t conv) const;
+
+  /**
+   * 扩容索引数组并重建索引
+   * @param capacity - 新的槽位数量（2的幂）
+   */
+  void rehash(size_t capacity);
+
+private:
+  std::vector<Slot> slots_;                          // 索引数组（大小为2的幂）
+  std::vector<std::unique_ptr<KCPConnection>> dense_; // 稠密连接数组
+  std::vector<uint32_t> dense_convs_; // 稠密数组中每个连接的conv（删除时更新索引）
+  size_t mask_;                       // 槽位掩码（slots_.size() - 1）
+};
+
+#endif // KCP_CONNECTION_TABLE_H
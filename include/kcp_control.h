@@ -0,0 +1,184 @@
+#ifndef KCP_CONTROL_H
+#define KCP_CONTROL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * 控制包命令字
+ * 控制包与KCP数据包共用端口，格式为 conv(4字节) + cmd(1字节) + 负载，
+ * cmd取值0xC0-0xEF，不会与KCP的命令字（81-84）冲突，在进入ikcp_input之前分流
+ * （0xF0以上为FEC包，参见kcp_fec.h）
+ */
+enum KCPControlCmd {
+  KCP_CTRL_TOKEN = 0xC0,     // 服务器->客户端：下发会话令牌 token(16)
+  KCP_CTRL_TOKEN_ACK = 0xC1, // 客户端->服务器：确认收到令牌
+  KCP_CTRL_CHALLENGE = 0xC2, // 服务器->新地址：地址验证挑战 nonce(8)
+  KCP_CTRL_RESPONSE = 0xC3,  // 客户端->服务器：挑战应答 nonce(8) + mac(8)
+  KCP_CTRL_HELLO = 0xC4,     // 客户端->服务器：请求建立会话 flags(1) + cookie(8) + 填充
+  KCP_CTRL_COOKIE = 0xC5,    // 服务器->客户端：无状态cookie(8)
+  KCP_CTRL_ACCEPT = 0xC6,    // 服务器->客户端：会话已建立
+  KCP_CTRL_PMTU_PROBE = 0xC7, // 双向：路径MTU探测 id(4) + 填充（包长即探测的MTU）
+  KCP_CTRL_PMTU_ACK = 0xC8,   // 双向：探测确认 id(4) + size(2)
+};
+
+/**
+ * 会话令牌（128位）
+ * 服务器在会话建立时下发，客户端地址变化（NAT重绑定、网络切换）时
+ * 用于证明新地址上的对端持有该会话
+ */
+struct KCPSessionToken {
+  uint8_t bytes[16];
+};
+
+/**
+ * 控制包编解码
+ * 所有多字节字段与KCP协议头一致，使用小端字节序
+ */
+class KCPControl {
+public:
+  // 控制包的最大长度（PMTU_PROBE除外，其长度由探测的MTU决定）
+  static const int kMaxPacketSize = 64;
+
+  // PMTU_PROBE包的最小长度
+  static const int kProbeMinSize = 9;
+
+  // PMTU_ACK包的固定长度
+  static const int kProbeAckSize = 11;
+
+  // HELLO包的固定长度（填充）
+  // 服务器对HELLO的所有回复都比它短，伪造源地址无法放大流量
+  static const int kHelloSize = 64;
+
+  /**
+   * 是否为控制包
+   * @param data - UDP数据
+   * @param len - 数据长度
+   */
+  static bool is_control(const char *data, int len) {
+    return len >= 5 && (uint8_t)data[4] >= 0xC0 && (uint8_t)data[4] < 0xF0;
+  }
+
+  /**
+   * 获取控制包命令字（调用前需确认is_control）
+   */
+  static uint8_t get_cmd(const char *data) { return (uint8_t)data[4]; }
+
+  /**
+   * 编码TOKEN包
+   * @return 包长度
+   */
+  static int encode_token(char *out, uint32_t conv, const KCPSessionToken &token);
+
+  /**
+   * 解码TOKEN包
+   * @return 成功返回true
+   */
+  static bool decode_token(const char *data, int len, KCPSessionToken *token);
+
+  /**
+   * 编码只有命令字的控制包（TOKEN_ACK）
+   * @return 包长度
+   */
+  static int encode_simple(char *out, uint32_t conv, uint8_t cmd);
+
+  /**
+   * 编码HELLO包（填充到kHelloSize）
+   * @param cookie - 服务器下发的cookie，为空时表示第一次请求
+   * @return 包长度
+   */
+  static int encode_hello(char *out, uint32_t conv, const uint64_t *cookie);
+
+  /**
+   * 解码HELLO包（长度不足kHelloSize时失败）
+   * @param has_cookie - 输出是否携带cookie
+   * @param cookie - 输出cookie
+   * @return 成功返回true
+   */
+  static bool decode_hello(const char *data, int len, bool *has_cookie,
+                           uint64_t *cookie);
+
+  /**
+   * 编码携带一个64位值的控制包（CHALLENGE的nonce、COOKIE的cookie）
+   * @return 包长度
+   */
+  static int encode_value(char *out, uint32_t conv, uint8_t cmd,
+                          uint64_t value);
+
+  /**
+   * 解码携带一个64位值的控制包
+   * @return 成功返回true
+   */
+  static bool decode_value(const char *data, int len, uint64_t *value);
+
+  /**
+   * 编码CHALLENGE包
+   * @return 包长度
+   */
+  static int encode_challenge(char *out, uint32_t conv, uint64_t nonce);
+
+  /**
+   * 解码CHALLENGE包
+   * @return 成功返回true
+   */
+  static bool decode_challenge(const char *data, int len, uint64_t *nonce);
+
+  /**
+   * 编码RESPONSE包（mac由令牌、conv和nonce计算）
+   * @return 包长度
+   */
+  static int encode_response(char *out, uint32_t conv, uint64_t nonce,
+                             const KCPSessionToken &token);
+
+  /**
+   * 解码并校验RESPONSE包
+   * @param nonce - 输出应答中的nonce（由调用者校验是否为自己签发）
+   * @return mac校验通过返回true
+   */
+  static bool verify_response(const char *data, int len,
+                              const KCPSessionToken &token, uint64_t *nonce);
+
+  /**
+   * 编码PMTU_PROBE包（id之后用0填充到size字节）
+   * @param out - 输出缓冲区，至少size字节
+   * @param size - 探测包长度（不小于kProbeMinSize）
+   * @return 包长度
+   */
+  static int encode_probe(char *out, uint32_t conv, uint32_t id, int size);
+
+  /**
+   * 解码PMTU_PROBE包
+   * @return 成功返回true
+   */
+  static bool decode_probe(const char *data, int len, uint32_t *id);
+
+  /**
+   * 编码PMTU_ACK包
+   * @param size - 收到的探测包长度
+   * @return 包长度
+   */
+  static int encode_probe_ack(char *out, uint32_t conv, uint32_t id, int size);
+
+  /**
+   * 解码PMTU_ACK包
+   * @return 成功返回true
+   */
+  static bool decode_probe_ack(const char *data, int len, uint32_t *id,
+                               int *size);
+
+  /**
+   * SipHash-2-4
+   * @param key - 128位密钥
+   * @param data - 输入数据
+   * @param len - 输入长度
+   * @return 64位哈希值
+   */
+  static uint64_t siphash(const uint8_t key[16], const void *data, size_t len);
+
+  /**
+   * 生成128位随机密钥（std::random_device）
+   */
+  static void random_key(uint8_t key[16]);
+};
+
+#endif // KCP_CONTROL_H
@@ -0,0 +1,207 @@
+#ifndef KCP_FEC_H
+#define KCP_FEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * 前向纠错（Reed-Solomon，GF(2^8)上的系统Cauchy码）
+ * 发送端把连续的data_shards个KCP输出包编为一组，组满时追加parity_shards个校验包，
+ * 接收端收到同一组中任意data_shards个包即可恢复丢失的数据包，无需等待RTO重传；
+ * 一段时间内凑不满的组可以提前结束（flush），按实际的数据包数量生成校验包
+ *
+ * 包格式（与KCP包、控制包共用端口，conv位置不变，按第5字节分流）：
+ *   conv(4) + type(1) + shards(1) + group(3) + index(1) + 负载
+ *   type：KCP_FEC_DATA（负载为 size(2) + KCP包）或 KCP_FEC_PARITY（负载为校验数据）
+ *   shards：data_shards << 4 | parity_shards（各1-15）；提前结束的组，校验包中的
+ *           data_shards为组内实际的数据包数量（数据包中仍为配置值）
+ *   group：组号（24位，循环递增），index：组内序号（数据包在前，校验包在后）
+ * 校验数据按组内最长的 size(2) + KCP包 计算，较短的数据包视为以0填充
+ *
+ * 编码参数写在每个包中，接收端不需要预先配置；每个方向是否启用FEC由发送端决定
+ */
+enum KCPFecType {
+  KCP_FEC_DATA = 0xF0,   // 数据包
+  KCP_FEC_PARITY = 0xF1, // 校验包
+};
+
+/**
+ * FEC编码器
+ */
+class KCPFecEncoder {
+public:
+  // FEC包头长度
+  static const int kHeaderSize = 10;
+
+  // 数据包相对原始KCP包增加的长度（包头 + size字段），KCP的MTU需要相应减小
+  static const int kOverhead = kHeaderSize + 2;
+
+  // 每组最大数据包/校验包数量
+  static const int kMaxShards = 15;
+
+  /**
+   * 构造函数
+   * @param data_shards - 每组数据包数量，范围1-15
+   * @param parity_shards - 每组校验包数量，范围1-15
+   */
+  KCPFecEncoder(int data_shards, int parity_shards);
+
+  int data_shards() const { return data_shards_; }
+  int parity_shards() const { return parity_shards_; }
+
+  /**
+   * 编码一个KCP输出包
+   * @param conv - 会话ID
+   * @param packet - KCP包
+   * @param len - KCP包长度
+   * @param out - 输出缓冲区，至少len + kOverhead字节
+   * @return 数据包长度；组满时随后可以通过parity取出校验包
+   */
+  int encode(uint32_t conv, const char *packet, int len, char *out);
+
+  /**
+   * 提前结束当前未满的组，按已编码的数据包数量生成校验包
+   * @param conv - 会话ID
+   * @return 生成了校验包返回true（随后通过parity取出）；当前组为空时返回false
+   */
+  bool flush(uint32_t conv);
+
+  /**
+   * 当前组号
+   */
+  uint32_t group() const { return group_; }
+
+  /**
+   * 当前组内已编码、尚未生成校验包的数据包数量
+   */
+  int pending() const { return index_; }
+
+  /**
+   * 当前可发送的校验包数量（组满之后为parity_shards，取出前一直有效）
+   */
+  int parity_ready() const { return parity_ready_ ? parity_shards_ : 0; }
+
+  /**
+   * 获取第i个校验包
+   * @param len - 输出包长度
+   */
+  const char *parity(int i, int *len) const;
+
+  /**
+   * 校验包已发送，开始下一组
+   */
+  void clear_parity();
+
+private:
+  /**
+   * 结束当前组：写入校验包头（data_shards为组内实际的数据包数量），开始下一组
+   */
+  void finish_group(uint32_t conv);
+
+  int data_shards_;
+  int parity_shards_;
+  uint32_t group_;      // 当前组号
+  int index_;           // 当前组内已编码的数据包数量
+  size_t shard_len_;    // 当前组内最长的分片（size + KCP包）
+  bool parity_ready_;   // 校验包是否已生成
+  std::vector<std::vector<uint8_t>> parity_; // 校验包（含包头）
+};
+
+/**
+ * FEC解码器
+ * 保留最近kGroupWindow组的分片，组内收到足够的分片后恢复丢失的数据包
+ */
+class KCPFecDecoder {
+public:
+  // 同时跟踪的组数（更早的组被覆盖）
+  static const int kGroupWindow = 8;
+
+  // input的返回值
+  enum Result {
+    FEC_INVALID = -1, // 格式错误
+    FEC_OK = 0,       // 已处理
+  };
+
+  KCPFecDecoder();
+
+  /**
+   * 判断是否为FEC包
+   */
+  static bool is_fec(const char *data, int len) {
+    return len >= KCPFecEncoder::kHeaderSize &&
+           ((uint8_t)data[4] == KCP_FEC_DATA ||
+            (uint8_t)data[4] == KCP_FEC_PARITY);
+  }
+
+  /**
+   * 获取FEC包的编码参数
+   */
+  static void get_shards(const char *data, int *data_shards, int *parity_shards) {
+    *data_shards = (uint8_t)data[5] >> 4;
+    *parity_shards = (uint8_t)data[5] & 0x0F;
+  }
+
+  /**
+   * 处理一个FEC包
+   * @param packet - FEC包
+   * @param len - 包长度
+   * @param data - 输出数据包中的KCP包（校验包为nullptr）
+   * @param data_len - 输出KCP包长度
+   * @return Result；恢复出的KCP包随后通过recovered取出
+   */
+  int input(const char *packet, int len, const char **data, int *data_len);
+
+  /**
+   * 最近一次input恢复出的KCP包数量
+   */
+  int recovered_count() const { return (int)recovered_.size(); }
+
+  /**
+   * 获取恢复出的第i个KCP包（在下一次input之前有效）
+   */
+  const char *recovered(int i, int *len) const;
+
+  /**
+   * 累计恢复的数据包数量
+   */
+  uint64_t total_recovered() const { return total_recovered_; }
+
+  /**
+   * 累计因分片不足而无法恢复的组数
+   */
+  uint64_t total_unrecovered() const { return total_unrecovered_; }
+
+private:
+  // 一组分片
+  struct Group {
+    bool used;
+    bool done;           // 数据包已齐全（收到或恢复）
+    uint32_t group;      // 组号
+    int data_shards;
+    int parity_shards;
+    uint32_t present;    // 已收到的分片位图
+    int received;        // 已收到的分片数量
+    size_t max_len;      // 最长分片
+    std::vector<std::vector<uint8_t>> shards; // 分片内容（数据包为size + KCP包）
+  };
+
+  /**
+   * 重置组（记录被覆盖的未完成组）
+   */
+  void reset_group(Group &g, uint32_t group, int data_shards,
+                   int parity_shards);
+
+  /**
+   * 用收到的分片恢复丢失的数据包
+   */
+  void recover(Group &g);
+
+  Group groups_[kGroupWindow];
+  std::vector<std::pair<const uint8_t *, int>> recovered_;
+  uint64_t total_recovered_;
+  uint64_t total_unrecovered_;
+};
+
+#endif // KCP_FEC_H
@@ -0,0 +1,88 @@
+#ifndef KCP_HISTOGRAM_H
+#define KCP_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * 对数-线性直方图（HDR风格）
+ * 每个2的幂区间再均分为16个子桶，相对误差不超过1/16（约6%）
+ * 记录为O(1)的位运算，不保存样本，适合逐消息记录延迟
+ *
+ * 取值范围：0 - 2^24-1（超出按最大值记录），单位由调用者决定（通常为毫秒）
+ * 桶数组在第一次记录时分配（约1.3KB），未使用的直方图不占用额外内存
+ */
+class KCPHistogram {
+public:
+  KCPHistogram();
+
+  /**
+   * 记录一个值
+   * @param value - 样本值
+   */
+  void record(uint32_t value);
+
+  /**
+   * 计算百分位数
+   * @param percentile - 百分位，范围0-100（如50、99、99.9）
+   * @return 对应桶的上界（HDR语义：不小于该百分位的真实值），无样本时返回0
+   */
+  uint32_t percentile(double percentile) const;
+
+  /**
+   * 合并另一个直方图
+   * @param other - 另一个直方图
+   */
+  void merge(const KCPHistogram &other);
+
+  /**
+   * 清空所有样本
+   */
+  void reset();
+
+  /**
+   * 获取样本数量
+   */
+  uint64_t count() const { return count_; }
+
+  /**
+   * 获取样本总和
+   */
+  uint64_t sum() const { return sum_; }
+
+  /**
+   * 获取最小值（无样本时返回0）
+   */
+  uint32_t min() const { return count_ > 0 ? min_ : 0; }
+
+  /**
+   * 获取最大值
+   */
+  uint32_t max() const { return max_; }
+
+  /**
+   * 获取平均值
+   */
+  double mean() const { return count_ > 0 ? (double)sum_ / count_ : 0; }
+
+private:
+  /**
+   * 计算值所在的桶下标
+   */
+  static size_t bucket_of(uint32_t value);
+
+  /**
+   * 计算桶的上界
+   */
+  static uint32_t bucket_upper(size_t index);
+
+private:
+  std::vector<uint32_t> buckets_; // 各桶计数（首次记录时分配）
+  uint64_t count_;                // 样本数量
+  uint64_t sum_;                  // 样本总和
+  uint32_t min_;                  // 最小值
+  uint32_t max_;                  // 最大值
+};
+
+#endif // KCP_HISTOGRAM_H
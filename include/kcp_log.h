@@ -0,0 +1,121 @@
+#ifndef KCP_LOG_H
+#define KCP_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+
+/**
+ * 日志级别
+ * 数值越大越重要
+ */
+#define KCP_LOG_LEVEL_TRACE 0 // 每个数据包/每条消息的日志（含数据内容）
+#define KCP_LOG_LEVEL_DEBUG 1 // 每条消息的收发日志、参数设置日志
+#define KCP_LOG_LEVEL_INFO 2  // 连接创建/关闭、服务器启停等生命周期日志
+#define KCP_LOG_LEVEL_WARN 3  // 可恢复的异常（数据被截断、回退路径等）
+#define KCP_LOG_LEVEL_ERROR 4 // 错误
+#define KCP_LOG_LEVEL_OFF 5   // 关闭所有日志
+
+/**
+ * 编译期最低日志级别
+ * 低于该级别的日志语句在编译期被完全移除（不求值参数，不产生任何代码）
+ * 可以通过 -DKCP_LOG_LEVEL=<级别> 指定（CMake缓存变量KCP_LOG_LEVEL）
+ * 未指定时：定义了NDEBUG（Release构建）为INFO，否则为TRACE
+ */
+#ifndef KCP_LOG_LEVEL
+#ifdef NDEBUG
+#define KCP_LOG_LEVEL KCP_LOG_LEVEL_INFO
+#else
+#define KCP_LOG_LEVEL KCP_LOG_LEVEL_TRACE
+#endif
+#endif
+
+/**
+ * KCP日志
+ * 提供运行期级别过滤、可替换的输出目标以及可选的异步环形缓冲区输出
+ *
+ * 默认输出：WARN及以上写入stderr，其余写入stdout
+ * 异步模式：日志行写入有界环形缓冲区，由后台线程负责输出，
+ *           事件循环线程不会因为终端/文件IO而阻塞；缓冲区满时丢弃并计数
+ */
+class KCPLog {
+public:
+  // 输出目标：参数(日志级别, 日志行（不含换行符）, 长度)
+  using Sink = std::function<void(int, const char *, size_t)>;
+
+  /**
+   * 设置运行期最低日志级别
+   * 只能在编译期级别之上进一步过滤
+   * @param level - 日志级别（KCP_LOG_LEVEL_*）
+   *                默认值：KCP_LOG_LEVEL_TRACE（不额外过滤）
+   */
+  static void set_level(int level);
+
+  /**
+   * 获取运行期最低日志级别
+   */
+  static int get_level();
+
+  /**
+   * 检查运行期是否输出该级别
+   */
+  static bool enabled(int level) { return level >= get_level(); }
+
+  /**
+   * 设置输出目标
+   * @param sink - 输出函数，传入空函数对象时恢复默认输出（stdout/stderr）
+   *               注意：异步模式下由后台线程调用
+   */
+  static void set_sink(Sink sink);
+
+  /**
+   * 启动异步输出
+   * @param capacity - 环形缓冲区容量（日志行数）
+   *                   默认值：8192
+   *                   建议范围：1024-65536
+   */
+  static void start_async(size_t capacity = 8192);
+
+  /**
+   * 停止异步输出
+   * 输出缓冲区中剩余的日志后停止后台线程，之后恢复同步输出
+   */
+  static void stop_async();
+
+  /**
+   * 获取异步模式下因缓冲区满而丢弃的日志行数
+   */
+  static uint64_t get_dropped();
+
+  /**
+   * 写入一行日志
+   * 一般通过KCP_LOG_*宏调用
+   * @param level - 日志级别
+   * @param line - 日志行（不含换行符）
+   */
+  static void write(int level, const std::string &line);
+};
+
+/**
+ * 日志宏
+ * 用法：KCP_LOG_DEBUG("[KCPConnection] 发送数据，conv=" << conv << ", len=" << len);
+ * 级别低于KCP_LOG_LEVEL时条件为编译期常量false，整条语句被编译器移除
+ */
+#define KCP_LOG(level, expr)                                                   \
+  do {                                                                         \
+    if ((level) >= KCP_LOG_LEVEL && KCPLog::enabled(level)) {                  \
+      std::ostringstream kcp_log_stream_;                                      \
+      kcp_log_stream_ << expr;                                                 \
+      KCPLog::write((level), kcp_log_stream_.str());                           \
+    }                                                                          \
+  } while (0)
+
+#define KCP_LOG_TRACE(expr) KCP_LOG(KCP_LOG_LEVEL_TRACE, expr)
+#define KCP_LOG_DEBUG(expr) KCP_LOG(KCP_LOG_LEVEL_DEBUG, expr)
+#define KCP_LOG_INFO(expr) KCP_LOG(KCP_LOG_LEVEL_INFO, expr)
+#define KCP_LOG_WARN(expr) KCP_LOG(KCP_LOG_LEVEL_WARN, expr)
+#define KCP_LOG_ERROR(expr) KCP_LOG(KCP_LOG_LEVEL_ERROR, expr)
+
+#endif // KCP_LOG_H
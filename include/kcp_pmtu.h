@@ -0,0 +1,118 @@
+#ifndef KCP_PMTU_H
+#define KCP_PMTU_H
+
+#include <cstdint>
+#include <uv.h>
+
+/**
+ * 路径MTU探测（DPLPMTUD风格，RFC 8899）
+ * 本端定期发送设置了DF位的PMTU_PROBE控制包（包长即候选MTU），对端回复PMTU_ACK。
+ * 确认之前使用min_mtu（黑洞路径上按过大的MTU切分的数据段永远无法送达），
+ * 第一轮先探测配置的MTU，再在[已确认的MTU, max_mtu]之间二分查找：
+ * 探测被确认则提高下界并立即生效，
+ * 同一长度连续retries次超时则降低上界；区间小于granularity时结束本轮，
+ * 每隔reprobe_interval重新探测：先验证当前MTU，失败时立即回退到min_mtu
+ * （路由变化后MTU可能变大或变小）
+ *
+ * 本类只维护状态机，探测包的收发由KCPConnection完成
+ */
+class KCPPmtuProber {
+public:
+  // 探测配置
+  struct Config {
+    uint32_t min_mtu;          // 最小MTU（确认之前和验证失败时使用，视为总能通过）
+    uint32_t max_mtu;          // 最大MTU（IPv4以太网为1472，即1500 - IP头 - UDP头）
+    uint32_t probe_timeout;    // 单次探测超时（毫秒）
+    int retries;               // 同一长度的探测次数（全部超时才判定失败）
+    uint32_t granularity;      // 二分查找的结束精度（字节）
+    uint32_t reprobe_interval; // 重新探测的周期（毫秒）
+
+    Config()
+        : min_mtu(1200), max_mtu(1472), probe_timeout(500), retries(3),
+          granularity(8), reprobe_interval(600000) {}
+  };
+
+  /**
+   * 构造函数
+   * @param config - 探测配置
+   * @param mtu - 配置的MTU（第一个探测的长度，确认之前使用min(mtu, min_mtu)）
+   */
+  KCPPmtuProber(const Config &config, uint32_t mtu);
+
+  /**
+   * 推进状态机（在update中调用）
+   * @param current - 当前时间（毫秒）
+   * @param probe_id - 输出需要发送的探测包id
+   * @param new_mtu - 输出需要立即生效的MTU（验证失败回退时），不变时为0
+   * @return 需要发送的探测包长度，不需要发送时返回0
+   */
+  int poll(uint32_t current, uint32_t *probe_id, uint32_t *new_mtu);
+
+  /**
+   * 处理探测确认
+   * @param probe_id - 确认中的id
+   * @param size - 确认中的探测包长度
+   * @return 新确认、需要生效的MTU，不变时返回0
+   */
+  uint32_t on_ack(uint32_t probe_id, int size);
+
+  /**
+   * 获取当前生效的MTU
+   */
+  uint32_t mtu() const { return mtu_; }
+
+  /**
+   * 是否正在探测
+   */
+  bool searching() const { return searching_; }
+
+  /**
+   * 获取已发送的探测包数量
+   */
+  uint64_t probes_sent() const { return probes_sent_; }
+
+  /**
+   * 设置socket的DF位（Linux为IP_PMTUDISC_PROBE：发送时设置DF，且不受内核
+   * 缓存的路径MTU限制，便于探测；其他平台使用IP_DONTFRAG）
+   * @param handle - 已绑定的UDP句柄
+   * @return 成功返回0，不支持时返回UV_ENOTSUP
+   */
+  static int set_dont_fragment(uv_udp_t *handle);
+
+  /**
+   * 按路径MTU探测配置准备socket（服务器、客户端和连接池共用）
+   * 启用时设置DF位，否则大的探测包会被IP分片而总能通过；设置失败只记录警告
+   * @param handle - 已绑定的UDP句柄
+   * @param mtu - 配置的MTU
+   * @param enable - 是否启用路径MTU探测
+   * @param config - 探测配置
+   * @return 单个输出包的最大长度（MTU，启用探测时不小于config.max_mtu），
+   *         用作发送池的槽位大小
+   */
+  static int prepare_socket(uv_udp_t *handle, int mtu, bool enable,
+                            const Config &config);
+
+private:
+  /**
+   * 推进二分查找：区间足够小时结束，否则返回下一个探测长度
+   */
+  int next_probe(uint32_t current);
+
+  Config config_;
+  uint32_t mtu_;          // 当前生效的MTU
+  uint32_t initial_mtu_;  // 配置的MTU
+  uint32_t first_probe_;  // 第一轮优先探测的长度（0表示没有）
+  bool started_;          // 是否已开始过探测
+  bool searching_;        // 是否正在探测
+  bool verifying_;        // 正在验证当前MTU（重新探测的第一步）
+  uint32_t lo_;           // 已确认可用的最大长度
+  uint32_t hi_;           // 尚未排除的最大长度
+  uint32_t probe_size_;   // 在途探测的长度（0表示没有在途探测）
+  uint32_t probe_id_;     // 在途探测的id
+  uint32_t probe_time_;   // 在途探测的发送时间
+  int attempts_;          // 当前长度已探测的次数
+  uint32_t next_search_;  // 下一次开始探测的时间
+  uint64_t probes_sent_;  // 已发送的探测包数量
+};
+
+#endif // KCP_PMTU_H
@@ -0,0 +1,60 @@
+#ifndef KCP_POST_QUEUE_H
+#define KCP_POST_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * 跨线程投递的一条消息
+ * 由生产者线程分配，所有权随节点转移给事件循环线程，在那里发送后释放
+ */
+struct KCPPostedMessage {
+  std::atomic<KCPPostedMessage *> next; // 队列链接（由队列维护）
+  uint32_t conv;                        // 目标会话
+  int channel;                          // 通道编号（-1表示send）
+  std::vector<char> data;               // 消息内容
+
+  KCPPostedMessage() : next(nullptr), conv(0), channel(-1) {}
+};
+
+/**
+ * 多生产者、单消费者的无锁队列（Vyukov侵入式MPSC队列）
+ * push可以在任意线程并发调用，每次只有一次原子交换，生产者之间不需要加锁或重试；
+ * pop只能在消费者线程（事件循环线程）调用
+ *
+ * 生产者在交换队尾之后、链接next之前被挂起时，pop暂时看不到之后入队的节点并返回nullptr，
+ * 该生产者完成链接后数据即可见（调用者应在push之后唤醒消费者）
+ */
+class KCPPostQueue {
+public:
+  KCPPostQueue();
+
+  /**
+   * 析构函数
+   * 释放队列中尚未取出的节点（此时不能再有生产者）
+   */
+  ~KCPPostQueue();
+
+  KCPPostQueue(const KCPPostQueue &) = delete;
+  KCPPostQueue &operator=(const KCPPostQueue &) = delete;
+
+  /**
+   * 入队（线程安全）
+   * @param node - 节点，所有权转移给队列
+   */
+  void push(KCPPostedMessage *node);
+
+  /**
+   * 出队（只能在消费者线程调用）
+   * @return 节点，所有权转移给调用者；队列为空（或暂时不可见）时返回nullptr
+   */
+  KCPPostedMessage *pop();
+
+private:
+  std::atomic<KCPPostedMessage *> head_; // 最后入队的节点（生产者交换）
+  KCPPostedMessage *tail_;               // 下一个出队的节点（只有消费者访问）
+  KCPPostedMessage stub_;                // 哨兵节点，队列为空时位于队尾
+};
+
+#endif // KCP_POST_QUEUE_H
@@ -0,0 +1,177 @@
+#ifndef KCP_SEND_POOL_H
+#define KCP_SEND_POOL_H
+
+#include "kcp_address.h"
+#include <cstdint>
+#include <vector>
+#include <uv.h>
+
+/**
+ * UDP发送请求池
+ * 预先分配固定数量的uv_udp_send_t和MTU大小的缓冲区槽位，
+ * 在发送完成回调中回收，避免每个UDP包两次new/delete
+ *
+ * 启用try_send时先尝试uv_udp_try_send同步发送（无需复制和分配），
+ * 仅在返回UV_EAGAIN时才走异步发送路径
+ *
+ * 启用批量发送时，数据先复制到池中缓冲区排队，在flush时通过一次sendmmsg
+ * 发送整批数据（仅Linux，其他平台逐个异步发送）
+ *
+ * 池耗尽或数据超过槽位大小时回退到堆分配（计入heap_fallbacks统计）
+ * 注意：发送池必须比所有未完成的发送请求存活更久（即事件循环结束之后再销毁）
+ */
+class KCPSendPool {
+public:
+  // 发送池统计信息
+  struct Stats {
+    uint32_t slot_size;      // 槽位大小（字节）
+    uint32_t capacity;       // 槽位总数
+    uint32_t in_use;         // 当前使用中的槽位数
+    uint32_t high_water;     // 使用中槽位的历史最大值（高水位）
+    uint32_t low_water;      // 空闲槽位的历史最小值（低水位）
+    uint64_t acquired;       // 累计从池中分配的次数
+    uint64_t heap_fallbacks; // 累计回退到堆分配的次数
+    uint64_t try_send_hits;      // uv_udp_try_send直接发送成功的次数
+    uint64_t try_send_fallbacks; // uv_udp_try_send返回EAGAIN后回退异步发送的次数
+    uint64_t batch_flushes;      // 批量发送flush次数（非空批次）
+    uint64_t batch_packets;      // 通过sendmmsg发送成功的数据包数
+    uint64_t sendmmsg_calls;     // sendmmsg系统调用次数
+  };
+
+  KCPSendPool();
+  ~KCPSendPool();
+
+  /**
+   * 初始化发送池
+   * 只能在没有未完成发送请求时调用
+   * @param slot_size - 每个槽位的缓冲区大小，单位字节
+   *                    建议值：与KCP的MTU保持一致
+   * @param capacity - 槽位数量
+   *                   含义：同时在途的UDP发送请求上限（超出后回退到堆分配）
+   *                   建议范围：256-16384
+   */
+  void init(int slot_size, int capacity);
+
+  /**
+   * 初始化发送池并设置批量发送（服务器和连接池共用）
+   * 启用批量发送时启动flush_check，调用方在其回调中调用flush
+   * @param slot_size - 每个槽位的缓冲区大小，参见init
+   * @param capacity - 槽位数量，参见init
+   * @param batching - 是否启用批量发送，参见set_batching
+   * @param flush_check - 已初始化的check句柄
+   * @param on_flush - check回调
+   */
+  void setup(int slot_size, int capacity, bool batching,
+             uv_check_t *flush_check, uv_check_cb on_flush);
+
+  /**
+   * 设置是否启用同步发送快速路径
+   * @param enable - true：先尝试uv_udp_try_send，EAGAIN时回退到异步发送
+   *                 false：总是复制数据并异步发送
+   *                 默认值：true
+   */
+  void set_try_send(bool enable) { try_send_ = enable; }
+
+  /**
+   * 设置是否启用批量发送
+   * @param enable - true：数据排队，flush时通过sendmmsg批量发送（优先于try_send）
+   *                 false：每个数据包立即发送
+   *                 默认值：false
+   *                 注意：启用后必须定期调用flush（服务器在每次事件循环迭代末尾调用）
+   */
+  void set_batching(bool enable) { batching_ = enable; }
+
+  /**
+   * 是否启用了批量发送
+   */
+  bool is_batching() const { return batching_; }
+
+  /**
+   * 发送UDP数据
+   * 同步发送成功时不复制数据；异步发送或批量发送时数据会被复制到池中的缓冲区
+   * 调用返回后原始缓冲区即可释放
+   * @param handle - UDP句柄
+   * @param buf - 数据缓冲区
+   * @param len - 数据长度
+   * @param addr - 目标地址
+   * @return 成功返回0，失败返回负数（libuv错误码）
+   */
+  int send(uv_udp_t *handle, const char *buf, int len,
+           const struct sockaddr *addr);
+
+  /**
+   * 发送所有排队的数据
+   * 使用sendmmsg一次系统调用发送整批数据，剩余部分（EAGAIN等）回退到异步发送
+   */
+  void flush();
+
+  /**
+   * 获取统计信息
+   */
+  Stats get_stats() const;
+
+  /**
+   * 重置高/低水位统计
+   * 以当前使用量作为新的起点
+   */
+  void reset_watermarks();
+
+private:
+  // 发送请求，req必须是第一个成员，以便从uv_udp_send_t*转换
+  struct Request {
+    uv_udp_send_t req;  // libuv发送请求
+    KCPSendPool *pool;  // 所属发送池
+    char *data;         // 数据缓冲区
+    bool pooled;        // 是否来自池（否则为堆分配）
+    int len;            // 排队数据长度（批量发送使用）
+    KCPAddress addr;    // 目标地址（批量发送使用）
+  };
+
+  /**
+   * 分配发送请求
+   * @param len - 需要的缓冲区大小
+   * @return 发送请求指针
+   */
+  Request *acquire(int len);
+
+  /**
+   * 释放发送请求
+   * 池中的请求放回空闲列表，堆分配的请求直接释放
+   */
+  void release(Request *request);
+
+  /**
+   * 异步发送一个已填充数据的请求
+   * @return 成功返回0，失败返回负数（请求已被释放）
+   */
+  int send_async(uv_udp_t *handle, Request *request,
+                 const struct sockaddr *addr);
+
+  /**
+   * 发送完成回调函数（静态）
+   */
+  static void on_send(uv_udp_send_t *req, int status);
+
+private:
+  int slot_size_;                    // 槽位大小（字节）
+  std::vector<Request> requests_;    // 请求数组（init后不再改变大小）
+  std::vector<char> slab_;           // 缓冲区slab（capacity * slot_size）
+  std::vector<Request *> free_list_; // 空闲请求列表
+  bool try_send_;                    // 是否启用同步发送快速路径
+  bool batching_;                    // 是否启用批量发送
+  uv_udp_t *batch_handle_;           // 批量发送使用的UDP句柄
+  std::vector<Request *> batch_;     // 排队等待批量发送的请求
+
+  uint32_t in_use_;          // 使用中的槽位数
+  uint32_t high_water_;      // 高水位
+  uint32_t low_water_;       // 低水位
+  uint64_t acquired_;        // 累计池分配次数
+  uint64_t heap_fallbacks_;  // 累计堆分配次数
+  uint64_t try_send_hits_;      // 同步发送成功次数
+  uint64_t try_send_fallbacks_; // 同步发送回退次数
+  uint64_t batch_flushes_;      // 批量发送flush次数
+  uint64_t batch_packets_;      // sendmmsg发送成功的数据包数
+  uint64_t sendmmsg_calls_;     // sendmmsg调用次数
+};
+
+#endif // KCP_SEND_POOL_H
@@ -1,8 +1,13 @@
 #ifndef KCP_SERVER_H
 #define KCP_SERVER_H
 
+#include "kcp_allocator.h"
 #include "kcp_connection.h"
-#include <map>
+#include "kcp_connection_table.h"
+#include "kcp_post_queue.h"
+#include "kcp_send_pool.h"
+#include "kcp_timer_wheel.h"
+#include <functional>
 #include <memory>
 #include <string>
 #include <uv.h>
@@ -16,6 +21,55 @@ public:
   // 新连接回调：参数(连接指针)
   using NewConnectionCallback = std::function<void(KCPConnection *)>;
 
+  // 关闭完成回调：所有会话排空（或超时）并移除后触发
+  using ShutdownCallback = std::function<void()>;
+
+  // 调度统计信息
+  // 用于观察每个tick实际处理的连接数量（应与活跃连接数成正比，而非总连接数）
+  struct TickStats {
+    uint64_t ticks;             // 累计tick次数
+    uint64_t serviced_total;    // 累计处理的连接数
+    uint32_t serviced_last;     // 最近一次tick处理的连接数
+    uint32_t serviced_max;      // 单次tick处理的最大连接数
+    uint32_t scheduled;         // 当前在时间轮中等待调度的连接数
+  };
+
+  // 服务器统计信息
+  // 计数器在事件循环线程中累加（非原子），只能在该线程中读取
+  struct Stats {
+    uint64_t packets_in;         // 接收的UDP数据报数量
+    uint64_t bytes_in;           // 接收的UDP字节数
+    uint64_t drops_short;        // 丢弃的过短数据报（不足KCP协议头24字节）
+    uint64_t drops_partial;      // 丢弃的截断数据报（UV_UDP_PARTIAL）
+    uint64_t recv_errors;        // UDP接收错误次数
+    uint64_t sessions_created;   // 累计创建的会话数
+    uint64_t sessions_closed;    // 累计移除的会话数（含超时）
+    uint64_t sessions_timed_out; // 累计超时的会话数
+    uint32_t sessions_active;    // 当前会话数
+
+    // 连接迁移（set_migration启用时）
+    uint64_t migrations;           // 成功切换对端地址的次数
+    uint64_t migration_challenges; // 向新地址发送的挑战数
+    uint64_t migration_failures;   // 校验失败的挑战应答数
+    uint64_t drops_unverified;     // 来自未验证地址、被丢弃的数据包
+
+    // 握手与会话准入
+    uint64_t cookies_sent;      // 回复的cookie数（set_handshake启用时）
+    uint64_t bad_cookies;       // cookie校验失败的HELLO数
+    uint64_t drops_no_session;  // 未经握手、conv不存在而被丢弃的数据包
+    uint64_t sessions_rejected; // 因会话上限或源地址限速而拒绝创建的会话数
+
+    // 跨线程投递（post_send）
+    uint64_t posted_messages;       // 从投递队列取出的消息数
+    uint64_t post_drops_no_session; // 目标会话不存在而被丢弃的投递消息
+    uint64_t post_send_errors;      // 发送失败（队列已满、超长等）而被丢弃的投递消息
+    uint64_t post_wakeups;          // 处理投递队列的唤醒次数
+  };
+
+  // 统计导出回调：参数(服务器指针)
+  // 在事件循环线程中周期性触发，可以调用get_stats/format_prometheus等接口
+  using StatsExportCallback = std::function<void(KCPServer *)>;
+
   /**
    * 构造函数
    * @param loop - libuv事件循环指针
@@ -60,6 +114,25 @@ public:
    */
   void stop();
 
+  /**
+   * 优雅关闭所有会话
+   * 不再创建新会话，所有会话并行排空发送队列（参见KCPConnection::close），
+   * 全部移除后调用回调。事件循环需要继续运行，回调中通常调用stop
+   * @param deadline - 排空截止时长，单位毫秒
+   *                   含义：超过该时长仍未被确认的数据被丢弃
+   *                   建议范围：1000-30000ms
+   * @param cb - 关闭完成回调函数对象
+   */
+  void shutdown(uint32_t deadline, ShutdownCallback cb);
+
+  /**
+   * 设置会话关闭时的排空超时时间（应用于所有新连接）
+   * @param timeout - 排空超时时长，单位毫秒
+   *                  默认值：KCPConnection::kDefaultDrainTimeout（5000ms）
+   *                  0：close时立即关闭
+   */
+  void set_drain_timeout(uint32_t timeout) { drain_timeout_ = timeout; }
+
   /**
    * 设置新连接回调函数
    * @param cb - 回调函数对象
@@ -81,6 +154,92 @@ public:
   void set_kcp_config(int nodelay, int interval, int resend, int nc, int sndwnd,
                       int rcvwnd, int mtu);
 
+  /**
+   * 设置最大消息长度（应用于所有新连接）
+   * 发送超过该长度的消息返回错误，接收到超过该长度的消息时关闭连接
+   * @param size - 最大消息长度，单位字节
+   *               默认值：65536字节（64KB）
+   *               建议范围：1KB-16MB
+   */
+  void set_max_message_size(int size) {
+    max_message_size_ =
+        size > 0 ? size : KCPConnection::kDefaultMaxMessageSize;
+  }
+
+  /**
+   * 设置发送队列水位（应用于所有新连接）
+   * 参见KCPConnection::set_send_watermarks，默认不限制
+   */
+  void set_send_watermarks(uint32_t high_packets, uint32_t low_packets,
+                           size_t high_bytes, size_t low_bytes) {
+    high_packets_ = high_packets;
+    low_packets_ = low_packets;
+    high_bytes_ = high_bytes;
+    low_bytes_ = low_bytes;
+  }
+
+  /**
+   * 启用或关闭KCP参数自适应调节（应用于所有新连接）
+   * 启用后按连接的rx_srtt、重传率和nsnd_buf在bounds范围内调整发送窗口、
+   * update间隔、最小RTO和快速重传阈值，set_kcp_config的配置作为初始值
+   * 参见KCPAdaptiveTuner
+   * @param enable - 是否启用（默认关闭）
+   * @param bounds - 调节范围
+   */
+  void set_adaptive_tuning(bool enable, const KCPAdaptiveTuner::Bounds &bounds =
+                                            KCPAdaptiveTuner::Bounds()) {
+    tuning_ = enable;
+    tuning_bounds_ = bounds;
+  }
+
+  /**
+   * 启用或关闭路径MTU探测（需在bind_and_listen之前调用）
+   * 启用后socket设置DF位，每个连接从set_kcp_config的MTU出发探测[config.min_mtu,
+   * config.max_mtu]内的最大可用值并通过ikcp_setmtu生效，当前值见连接统计的mtu字段
+   * 参见KCPPmtuProber
+   * @param enable - 是否启用（默认关闭）
+   * @param config - 探测配置
+   */
+  void set_pmtu_discovery(bool enable, const KCPPmtuProber::Config &config =
+                                           KCPPmtuProber::Config()) {
+    pmtu_ = enable;
+    pmtu_config_ = config;
+  }
+
+  /**
+   * 是否跟随客户端启用FEC：收到FEC包的连接以客户端的参数启用发送方向的FEC
+   * （由客户端协商，set_fec已启用的连接不受影响）
+   */
+  void set_fec_auto(bool enable) { fec_auto_ = enable; }
+
+  /**
+   * 设置消息压缩（需在bind_and_listen之前调用，两端必须一致）
+   * 参见KCPConnection::set_compression，压缩率和耗时见连接统计的compression_ratio等字段
+   * @param config - 压缩配置（默认不压缩）
+   */
+  void set_compression(const KCPCompressor::Config &config) {
+    compression_ = config;
+  }
+
+  /**
+   * 设置发送方向的FEC（需在bind_and_listen之前调用）
+   * 每data_shards个KCP输出包追加parity_shards个校验包，恢复数量见连接统计的fec_recovered
+   * 参见KCPConnection::set_fec
+   * @param data_shards - 每组数据包数量（1-15），0表示关闭（默认关闭）
+   * @param parity_shards - 每组校验包数量（1-15）
+   */
+  void set_fec(int data_shards, int parity_shards) {
+    fec_data_ = data_shards;
+    fec_parity_ = parity_shards;
+  }
+
+  /**
+   * 设置通道数量（应用于所有新连接，需与客户端一致）
+   * 参见KCPConnection::set_channels
+   * @param count - 通道数量，0表示不启用（默认）
+   */
+  void set_channels(int count) { channels_ = count; }
+
   /**
    * 设置连接超时时间
    * @param timeout - 超时时长，单位毫秒
@@ -89,6 +248,202 @@ public:
    */
   void set_timeout(uint32_t timeout) { timeout_ = timeout; }
 
+  /**
+   * 设置调度时间轮粒度（需在bind_and_listen之前调用）
+   * @param granularity - 时间轮粒度，单位毫秒
+   *                      含义：定时器tick间隔，也是update的调度精度
+   *                      默认值：10ms
+   *                      建议范围：1-10ms
+   *                      注意：不应大于KCP的interval参数
+   */
+  void set_timer_granularity(uint32_t granularity) {
+    timer_granularity_ = granularity > 0 ? granularity : 1;
+  }
+
+  /**
+   * 获取调度统计信息
+   * @return 调度统计信息
+   */
+  TickStats get_tick_stats() const;
+
+  /**
+   * 设置批量接收模式（需在bind_and_listen之前调用，仅Linux/FreeBSD有效）
+   * 启用后使用recvmmsg一次系统调用接收多个数据报，整批输入KCP后
+   * 再对每个涉及的连接执行一次recv和调度
+   * @param slots - 每次recvmmsg接收的最大数据报数量
+   *                0：关闭（默认，每个数据报一次系统调用）
+   *                建议范围：8-20（libuv上限为20）
+   *                注意：libuv要求每个槽位为64KB，占用内存为 slots * 64KB
+   */
+  void set_recv_mmsg(int slots) { recv_mmsg_slots_ = slots; }
+
+  /**
+   * 设置是否使用SO_REUSEPORT绑定（需在bind_and_listen之前调用）
+   * 启用后多个KCPServer（通常位于不同线程）可以绑定同一地址和端口，
+   * 由内核在这些socket之间分发数据报，参见KCPServerCluster
+   * @param enable - true：启用SO_REUSEPORT
+   *                 false：普通绑定（默认）
+   */
+  void set_reuseport(bool enable) { reuseport_ = enable; }
+
+  /**
+   * 获取底层socket描述符
+   * @return 已绑定返回socket描述符，否则返回-1
+   */
+  int get_socket_fd() const;
+
+  /**
+   * 设置预期会话数量（需在bind_and_listen之前调用）
+   * bind_and_listen时按该数量为KCP分级内存分配器预先切分内存，
+   * 避免连接建立高峰期频繁向系统申请内存
+   * @param sessions - 预期会话数量
+   *                   默认值：0（不预留，按需切分）
+   *                   注意：每个会话约预留 16 * mtu + 5KB 内存
+   */
+  void set_expected_sessions(size_t sessions) { expected_sessions_ = sessions; }
+
+  /**
+   * 设置UDP发送池容量（需在bind_and_listen之前调用）
+   * 槽位大小在bind_and_listen时根据kcp_mtu_确定
+   * @param capacity - 槽位数量
+   *                   含义：同时在途的UDP发送请求数，超出后回退到堆分配
+   *                   默认值：1024
+   *                   建议范围：256-16384
+   */
+  void set_send_pool_capacity(int capacity) { send_pool_capacity_ = capacity; }
+
+  /**
+   * 设置是否启用uv_udp_try_send同步发送快速路径
+   * @param enable - true：先尝试同步发送，EAGAIN时回退到池化的异步发送
+   *                 false：总是异步发送
+   *                 默认值：true
+   *                 建议：通过try_send_hits/try_send_fallbacks统计调整socket发送缓冲区
+   */
+  void set_try_send(bool enable) { send_pool_.set_try_send(enable); }
+
+  /**
+   * 设置是否启用批量发送（需在bind_and_listen之前调用）
+   * 启用后一次事件循环迭代中所有连接产生的KCP输出先排队，
+   * 在迭代末尾（uv_check阶段）通过sendmmsg一次性发送（仅Linux）
+   * @param enable - true：启用批量发送（优先于try_send）
+   *                 false：每个数据包立即发送（默认）
+   *                 建议：重传风暴或大消息突发较多的场景启用
+   */
+  void set_send_batching(bool enable) { send_batching_ = enable; }
+
+  /**
+   * 设置是否启用连接迁移（NAT重绑定、网络切换）
+   * @param enable - true：新会话建立时下发会话令牌；已有会话收到来自其他地址的数据时，
+   *                 丢弃该数据并向新地址发送挑战，对端用令牌应答后切换输出地址，
+   *                 KCP状态（窗口、RTT、未确认数据）保持不变
+   *                 false：按conv接收任意地址的数据，始终回复到会话建立时的地址
+   *                 默认值：false
+   *                 注意：需要客户端支持控制包（KCPClient已支持）
+   */
+  void set_migration(bool enable) { migration_ = enable; }
+
+  /**
+   * 设置是否启用握手（无状态cookie）
+   * @param enable - true：未知conv的KCP数据包直接丢弃，不分配任何状态；
+   *                 客户端先发送HELLO，服务器回复由密钥、conv、源地址和时间片计算的cookie，
+   *                 客户端回显cookie后才创建会话并回复ACCEPT。
+   *                 伪造源地址的数据包收不到cookie，无法让服务器创建会话
+   *                 false：收到未知conv的KCP数据包时直接创建会话（默认）
+   *                 默认值：false
+   *                 注意：需要客户端同时启用（KCPClient::set_handshake）
+   */
+  void set_handshake(bool enable) { handshake_ = enable; }
+
+  /**
+   * 设置最大会话数
+   * 达到上限后不再创建新会话（已有会话不受影响），计入sessions_rejected
+   * @param max_sessions - 最大会话数
+   *                       默认值：0（不限制）
+   */
+  void set_max_sessions(size_t max_sessions) { max_sessions_ = max_sessions; }
+
+  /**
+   * 设置按源IP限制新会话的创建速率（令牌桶）
+   * 源IP（不含端口）哈希到固定数量的令牌桶，不随攻击流量增长内存
+   * 启用握手时在cookie校验通过后才消耗令牌，伪造源地址无法耗尽他人的配额
+   * @param rate - 每个源IP每秒允许创建的会话数
+   *               0：不限制（默认）
+   *               建议范围：1-100
+   * @param burst - 令牌桶容量（允许的突发创建数），最小为1
+   *                建议范围：rate - 10 * rate
+   */
+  void set_accept_rate(double rate, uint32_t burst) {
+    accept_rate_ = rate > 0 ? rate : 0;
+    accept_burst_ = burst > 0 ? burst : 1;
+    accept_buckets_.clear();
+  }
+
+  /**
+   * 获取UDP发送池统计信息
+   * @return 发送池统计信息（高/低水位、堆分配回退次数、try_send命中次数等）
+   */
+  KCPSendPool::Stats get_send_pool_stats() const {
+    return send_pool_.get_stats();
+  }
+
+  /**
+   * 获取服务器统计信息
+   * @return 收发计数、丢弃计数、会话计数
+   */
+  Stats get_stats() const;
+
+  /**
+   * 遍历所有连接
+   * 用于导出逐连接统计（KCPConnection::get_stats），回调中不能关闭连接
+   * @param fn - 回调函数对象
+   */
+  void for_each_connection(const std::function<void(KCPConnection *)> &fn) const;
+
+  /**
+   * 设置周期性统计导出
+   * @param interval - 导出间隔，单位毫秒
+   *                   建议范围：1000-60000ms
+   *                   0：关闭导出
+   * @param cb - 导出回调函数对象
+   */
+  void set_stats_export(uint32_t interval, StatsExportCallback cb);
+
+  /**
+   * 生成Prometheus文本格式的统计信息
+   * 包括服务器计数、调度统计、发送池统计以及所有连接的汇总（队列深度、重传、RTT）
+   * 会话的累计计数器（_total、确认延迟summary）包含已移除的会话，队列深度和RTT只统计当前会话
+   * @param labels - 附加到每个指标的标签，如 "shard=\"0\""（为空时不附加）
+   * @return Prometheus文本格式（exposition format）
+   */
+  std::string format_prometheus(const std::string &labels = "") const;
+
+  /**
+   * 从其他线程投递一条消息（线程安全）
+   * 消息进入无锁队列（MPSC），由事件循环线程在下次唤醒时按顺序取出并发送：
+   * 每次唤醒处理所有已投递的消息，每个收到消息的会话只flush一次，
+   * 多条小消息合并到同一批UDP包中
+   *
+   * 同一线程投递到同一会话的消息保持顺序；不同线程之间没有顺序保证
+   * 没有跨线程的背压：会话不存在或发送失败（如kErrQueueFull）的消息被丢弃并计入统计，
+   * 需要可靠投递时由应用层在事件循环线程中确认
+   * 注意：服务器析构之后不能再调用
+   *
+   * @param conv - 目标会话ID
+   * @param data - 消息内容，所有权转移给服务器（不复制）
+   * @return 成功入队返回0，data为空返回-1
+   */
+  int post_send(uint32_t conv, std::vector<char> &&data);
+
+  /**
+   * 从其他线程投递一条消息到指定通道（线程安全），参见post_send和KCPConnection::send_channel
+   * @param conv - 目标会话ID
+   * @param channel - 通道编号
+   * @param data - 消息内容，所有权转移给服务器（不复制）
+   * @return 成功入队返回0，data为空返回-1
+   */
+  int post_send_channel(uint32_t conv, uint8_t channel,
+                        std::vector<char> &&data);
+
   /**
    * 获取当前时间戳（毫秒）
    * 使用单调时钟，不受系统时间调整影响
@@ -97,6 +452,30 @@ public:
   static uint32_t get_current_ms();
 
 private:
+  // 会话的累计计数器汇总（Prometheus counter）
+  // 会话移除时累加到服务器级的合计中，导出值不会因会话关闭而回落
+  struct SessionTotals {
+    uint64_t packets_out;      // 输出的UDP数据包数量
+    uint64_t send_errors;      // UDP发送失败次数
+    uint64_t xmit;             // 超时重传次数
+    uint64_t fast_retransmits; // 快速重传次数
+    uint64_t window_probes;    // 窗口探测次数
+    uint64_t fec_recovered;    // FEC恢复的包数量
+    uint64_t fec_parity_sent;  // 发送的FEC校验包数量
+    uint64_t compress_raw;     // 压缩前的消息字节数
+    uint64_t compress_bytes;   // 压缩后的字节数
+    uint64_t queue_full;       // 因达到高水位被拒绝的发送次数
+  };
+
+  /**
+   * 把一个会话的累计计数器加到合计中
+   */
+  static void add_session_totals(SessionTotals &totals,
+                                 const KCPConnection::Stats &conn);
+
+  // 每次唤醒最多处理的投递消息数，超过时在下一次循环迭代继续，避免长时间阻塞IO
+  static const size_t kMaxPostBatch = 65536;
+
   /**
    * UDP接收回调函数（静态）
    * libuv接收到UDP数据时会调用此函数
@@ -123,6 +502,21 @@ private:
   static void alloc_buffer(uv_handle_t *handle, size_t suggested_size,
                            uv_buf_t *buf);
 
+  /**
+   * 批量发送回调函数（静态）
+   * 每次事件循环迭代末尾调用，发送本次迭代中排队的所有数据
+   *
+   * @param handle - check句柄
+   */
+  static void on_flush_check(uv_check_t *handle);
+
+  /**
+   * 统计导出定时器回调函数（静态）
+   *
+   * @param handle - 定时器句柄
+   */
+  static void on_stats_timer(uv_timer_t *handle);
+
   /**
    * 定时器回调函数（静态）
    * 定期更新所有KCP连接的状态
@@ -131,6 +525,24 @@ private:
    */
   static void on_timer(uv_timer_t *handle);
 
+  /**
+   * 投递队列唤醒回调函数（静态）
+   *
+   * @param handle - async句柄
+   */
+  static void on_post_async(uv_async_t *handle);
+
+  /**
+   * 入队投递消息并唤醒事件循环
+   */
+  int post_message(uint32_t conv, int channel, std::vector<char> &&data);
+
+  /**
+   * 处理投递队列
+   * 取出已投递的消息调用send/send_channel，之后每个会话flush一次并重新调度
+   */
+  void drain_posted();
+
   /**
    * 处理接收到的UDP数据
    * 根据conv查找或创建连接，将数据输入到KCP
@@ -141,6 +553,19 @@ private:
    */
   void handle_udp_data(const char *data, int len, const struct sockaddr *addr);
 
+  /**
+   * 创建启用SO_REUSEPORT的socket并绑定，然后交给libuv管理
+   * @param addr - 绑定地址
+   * @return 成功返回0，失败返回负数（libuv错误码）
+   */
+  int bind_reuseport(const struct sockaddr *addr);
+
+  /**
+   * 处理一批接收完成的数据
+   * 对本批次中收到数据的每个连接执行一次recv，并重新调度
+   */
+  void flush_recv_batch();
+
   /**
    * 查找或创建连接
    * 根据conv查找现有连接，如果不存在则创建新连接
@@ -152,18 +577,97 @@ private:
   KCPConnection *find_or_create_connection(uint32_t conv,
                                            const struct sockaddr *addr);
 
+  /**
+   * 是否允许创建新会话（会话上限、源IP令牌桶）
+   * @param addr - 对端地址
+   * @param current - 当前时间戳，单位毫秒
+   * @return 允许时返回true（并消耗一个令牌）
+   */
+  bool admit_session(const struct sockaddr *addr, uint32_t current);
+
+  /**
+   * 处理HELLO包（握手启用时）
+   * 不带cookie时回复cookie，cookie有效时创建会话并回复ACCEPT
+   */
+  void handle_hello(const char *data, int len, const struct sockaddr *addr);
+
+  /**
+   * 处理控制包（HELLO、TOKEN_ACK、RESPONSE）
+   * @param data - 控制包数据
+   * @param len - 数据长度
+   * @param addr - 发送方地址
+   */
+  void handle_control(const char *data, int len, const struct sockaddr *addr);
+
+  /**
+   * 校验数据包的来源地址（连接迁移启用时）
+   * 来源为会话当前地址时放行（令牌未确认时顺带重发令牌），
+   * 否则向新地址发送挑战（限速）并丢弃该数据包
+   * @return 数据包可以输入KCP时返回true
+   */
+  bool check_peer(KCPConnection *conn, const struct sockaddr *addr,
+                  uint32_t current);
+
+  /**
+   * 为新会话生成并下发会话令牌
+   */
+  void issue_token(KCPConnection *conn, uint32_t current);
+
+  /**
+   * 计算地址绑定的无状态校验值（挑战nonce、握手cookie）
+   * 由密钥、用途、conv、对端地址和时间片决定，服务器不需要保存任何状态
+   * @param domain - 用途（KCP_CTRL_CHALLENGE或KCP_CTRL_COOKIE），不同用途的值互不通用
+   * @param epoch - 时间片编号（当前时间 / kChallengeEpoch）
+   */
+  uint64_t address_mac(uint8_t domain, uint32_t conv,
+                       const struct sockaddr *addr, uint32_t epoch) const;
+
+  /**
+   * 发送控制包
+   */
+  void send_control(const char *data, int len, const struct sockaddr *addr);
+
   /**
    * 移除连接
+   * 连接对象不会立即释放，而是移入待释放列表，
+   * 保证正在执行回调的连接指针在回调返回前仍然有效
    * @param conv - 会话ID
    */
   void remove_connection(uint32_t conv);
 
   /**
-   * 更新所有连接
-   * 定期调用所有连接的update函数，处理超时检测
+   * 关闭中且所有会话已移除时调用关闭完成回调
+   */
+  void check_shutdown();
+
+  /**
+   * 释放已移除的连接
+   * 只能在没有连接回调正在执行时调用（tick末尾、接收批次末尾）
+   */
+  void reap_connections();
+
+  /**
+   * 更新到期的连接
+   * 推进调度时间轮，只处理ikcp_check截止时间或空闲超时时间已到的连接
    */
   void update_connections();
 
+  /**
+   * 处理单个到期连接
+   * 检查超时、调用update和recv，然后重新调度
+   * @param conv - 会话ID
+   * @param current - 当前时间戳，单位毫秒
+   * @return 连接仍然存在返回true，已移除返回false
+   */
+  bool service_connection(uint32_t conv, uint32_t current);
+
+  /**
+   * 根据连接的下次update时间将其加入时间轮
+   * @param conn - 连接指针
+   * @param current - 当前时间戳，单位毫秒
+   */
+  void schedule_connection(KCPConnection *conn, uint32_t current);
+
   /**
    * 连接数据接收回调
    * @param conn - 连接指针
@@ -182,9 +686,35 @@ private:
   uv_loop_t *loop_;     // libuv事件循环
   uv_udp_t udp_handle_; // UDP句柄
   uv_timer_t timer_;    // 定时器（用于KCP update）
+  uv_check_t flush_check_; // 批量发送的check句柄（每次循环迭代末尾触发）
+  uv_timer_t stats_timer_; // 统计导出定时器
+  uv_async_t post_async_;  // 投递队列唤醒句柄（不阻止事件循环退出）
   bool running_;        // 服务器运行状态
   uint32_t next_conv_; // 下一个可用的会话ID（服务器端可以生成conv）
   uint32_t timeout_; // 连接超时时间（毫秒）
+  uint32_t drain_timeout_; // 会话关闭时的排空超时时间（毫秒）
+  bool shutting_down_;     // 是否正在优雅关闭（不再创建新会话）
+  ShutdownCallback shutdown_callback_; // 关闭完成回调
+  uint32_t timer_granularity_; // 调度时间轮粒度（毫秒）
+  int send_pool_capacity_;     // UDP发送池容量
+  size_t expected_sessions_;   // 预期会话数量（用于预留KCP内存）
+  int recv_mmsg_slots_;        // recvmmsg批量接收槽位数（0表示关闭）
+  bool send_batching_;         // 是否启用批量发送
+  bool reuseport_;             // 是否使用SO_REUSEPORT绑定
+  bool migration_;             // 是否启用连接迁移
+  bool handshake_;             // 是否启用握手（无状态cookie）
+  uint8_t secret_[16];         // 控制包密钥（令牌、挑战nonce、cookie），启动时随机生成
+
+  // 会话准入
+  // 源IP令牌桶（accept_rate_ > 0时按需分配，固定数量，按源IP哈希）
+  struct AcceptBucket {
+    double tokens; // 剩余令牌
+    uint32_t time; // 上次补充令牌的时间（毫秒）
+  };
+  size_t max_sessions_;                     // 最大会话数（0表示不限制）
+  double accept_rate_;                      // 每个源IP每秒允许创建的会话数
+  uint32_t accept_burst_;                   // 令牌桶容量
+  std::vector<AcceptBucket> accept_buckets_; // 源IP令牌桶
 
   // KCP配置参数
   int kcp_nodelay_;  // nodelay模式
@@ -194,14 +724,55 @@ private:
   int kcp_sndwnd_;   // 发送窗口
   int kcp_rcvwnd_;   // 接收窗口
   int kcp_mtu_;      // MTU大小
+  int max_message_size_; // 最大消息长度
+
+  int channels_;          // 通道数量（0表示不启用多通道）
+  bool tuning_;           // 是否启用参数自适应调节
+  KCPAdaptiveTuner::Bounds tuning_bounds_; // 参数自适应调节范围
+  bool pmtu_;                         // 是否启用路径MTU探测
+  KCPPmtuProber::Config pmtu_config_; // 路径MTU探测配置
+  int fec_data_;                      // FEC每组数据包数量（0表示不启用）
+  int fec_parity_;                    // FEC每组校验包数量
+  KCPCompressor::Config compression_; // 消息压缩配置
+  bool fec_auto_;                     // 是否跟随客户端启用FEC
+
+  // 发送队列水位（应用于新连接）
+  uint32_t high_packets_;
+  uint32_t low_packets_;
+  size_t high_bytes_;
+  size_t low_bytes_;
+
+  // UDP发送池，所有连接共享（必须在connections_之前声明，保证更晚析构）
+  KCPSendPool send_pool_;
 
   // 连接管理
-  // 使用map存储所有连接，key是conv，value是连接的智能指针
-  std::map<uint32_t, std::shared_ptr<KCPConnection>> connections_;
+  // 使用开放寻址哈希表存储所有连接，key是conv
+  KCPConnectionTable connections_;
+  // 已移除、等待释放的连接
+  std::vector<std::unique_ptr<KCPConnection>> closed_connections_;
+
+  // 调度时间轮，key是conv，按下次需要update的时间调度
+  KCPTimerWheel timer_wheel_;
+  std::vector<uint32_t> expired_convs_; // 每个tick到期的conv（复用内存）
+  TickStats tick_stats_;                // 调度统计信息
+  Stats stats_;                         // 服务器统计信息
+  SessionTotals closed_totals_;         // 已移除会话的累计计数器
+  KCPHistogram closed_latency_;         // 已移除会话的确认延迟直方图
+
+  uint32_t stats_interval_;                   // 统计导出间隔（毫秒，0表示关闭）
+  StatsExportCallback stats_export_callback_; // 统计导出回调
 
   NewConnectionCallback new_connection_callback_; // 新连接回调
 
-  char recv_buffer_[65536]; // UDP接收缓冲区（64KB）
+  // 当前接收批次中收到数据的连接（每个conv只出现一次）
+  std::vector<uint32_t> recv_batch_;
+
+  // 跨线程投递队列，以及本次唤醒中收到消息的会话（复用内存）
+  KCPPostQueue post_queue_;
+  std::vector<uint32_t> post_batch_;
+
+  // UDP接收缓冲区（普通模式64KB，批量接收模式 slots * 64KB）
+  std::vector<char> recv_buffer_;
 };
 
 #endif // KCP_SERVER_H
@@ -0,0 +1,161 @@
+#ifndef KCP_SERVER_CLUSTER_H
+#define KCP_SERVER_CLUSTER_H
+
+#include "kcp_server.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <uv.h>
+
+/**
+ * 多线程KCP服务器集群
+ * 启动N个工作线程，每个线程拥有独立的事件循环、SO_REUSEPORT绑定的UDP socket、
+ * 定时器和连接表，由内核在这些socket之间分发数据报
+ *
+ * 可选地挂载CBPF程序（SO_ATTACH_REUSEPORT_CBPF，仅Linux），
+ * 按数据报前4字节的conv选择分片，保证同一会话总是落在同一个工作线程，
+ * 即使客户端源端口发生变化
+ *
+ * 新连接回调和数据回调都在连接所属的工作线程中触发
+ */
+class KCPServerCluster {
+public:
+  // 分片初始化回调：参数(分片服务器指针, 分片编号)
+  // 在bind_and_listen之前调用，用于设置每个分片的服务器参数
+  using ShardInitCallback = std::function<void(KCPServer *, int)>;
+
+  /**
+   * 构造函数
+   * @param threads - 工作线程数量
+   *                  建议值：CPU核心数
+   *                  建议范围：1-64
+   */
+  KCPServerCluster(int threads);
+
+  /**
+   * 析构函数
+   * 停止所有工作线程并释放资源
+   */
+  ~KCPServerCluster();
+
+  /**
+   * 设置是否按conv路由数据报（需在start之前调用）
+   * @param enable - true：挂载CBPF程序，按conv将数据报固定分发到同一分片（默认）
+   *                 false：由内核按四元组哈希分发
+   *                 注意：仅Linux 4.5+支持，不支持时自动退化为四元组哈希
+   */
+  void set_conv_routing(bool enable) { conv_routing_ = enable; }
+
+  /**
+   * 设置分片初始化回调（需在start之前调用）
+   * @param cb - 回调函数对象
+   */
+  void set_shard_init_callback(ShardInitCallback cb) { shard_init_callback_ = cb; }
+
+  /**
+   * 设置新连接回调函数（需在start之前调用）
+   * 回调在连接所属的工作线程中触发
+   * @param cb - 回调函数对象
+   */
+  void set_new_connection_callback(KCPServer::NewConnectionCallback cb) {
+    new_connection_callback_ = cb;
+  }
+
+  /**
+   * 绑定并启动所有工作线程
+   * 所有分片的socket在调用线程中依次绑定（保证分片编号与reuseport组内顺序一致），
+   * 然后每个工作线程运行自己的事件循环
+   * @param ip - 绑定的IP地址
+   * @param port - 绑定的端口号
+   * @return 成功返回0，失败返回负数
+   */
+  int start(const std::string &ip, int port);
+
+  /**
+   * 停止所有工作线程
+   * 可以在任意线程调用（工作线程除外），会等待所有线程退出
+   */
+  void stop();
+
+  /**
+   * 获取工作线程数量
+   */
+  int get_thread_count() const { return thread_count_; }
+
+  /**
+   * 获取分片服务器
+   * 注意：返回的服务器只能在其工作线程中访问
+   * @param shard - 分片编号
+   */
+  KCPServer *get_server(int shard) const;
+
+  /**
+   * 计算conv所属的分片编号
+   * 与CBPF程序的路由规则一致：按网络字节序读取前4字节后取模
+   * @param conv - 会话ID
+   * @param shards - 分片数量
+   * @return 分片编号
+   */
+  static int shard_for_conv(uint32_t conv, int shards);
+
+  /**
+   * 从任意线程投递一条消息到会话所属的分片（线程安全），参见KCPServer::post_send
+   * 按shard_for_conv选择分片，要求数据报也按conv路由（CBPF挂载成功或只有一个线程）
+   * 注意：不能与start/stop并发调用
+   * @param conv - 目标会话ID
+   * @param data - 消息内容，所有权转移给分片服务器（不复制）
+   * @return 成功入队返回0，失败返回负数
+   *         -1：集群未启动或data为空
+   *         UV_ENOTSUP：会话不是按conv分片的，无法确定所属分片
+   */
+  int post_send(uint32_t conv, std::vector<char> &&data);
+
+  /**
+   * 从任意线程投递一条消息到会话所属分片的指定通道（线程安全），参见post_send
+   */
+  int post_send_channel(uint32_t conv, uint8_t channel,
+                        std::vector<char> &&data);
+
+private:
+  // 工作线程
+  struct Worker {
+    int index;                        // 分片编号
+    uv_loop_t loop;                   // 事件循环
+    uv_async_t stop_async;            // 跨线程停止通知
+    std::unique_ptr<KCPServer> server; // 分片服务器
+    std::thread thread;               // 工作线程
+  };
+
+  /**
+   * 挂载按conv路由的CBPF程序
+   * @param fd - reuseport组中任意一个socket
+   * @return 成功返回0，失败返回负数
+   */
+  int attach_conv_router(int fd);
+
+  /**
+   * 停止通知回调函数（静态）
+   * 在工作线程中执行，停止分片服务器
+   */
+  static void on_stop_async(uv_async_t *handle);
+
+  /**
+   * 关闭工作线程的所有句柄并释放事件循环
+   */
+  static void close_worker_loop(Worker *worker);
+
+private:
+  int thread_count_;  // 工作线程数量
+  bool conv_routing_; // 是否按conv路由
+  bool running_;      // 运行状态
+  bool conv_routed_;  // 数据报是否按conv分片（决定post_send能否定位分片）
+
+  ShardInitCallback shard_init_callback_;                    // 分片初始化回调
+  KCPServer::NewConnectionCallback new_connection_callback_; // 新连接回调
+
+  std::vector<std::unique_ptr<Worker>> workers_; // 工作线程列表
+};
+
+#endif // KCP_SERVER_CLUSTER_H
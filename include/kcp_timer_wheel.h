@@ -0,0 +1,103 @@
+#ifndef KCP_TIMER_WHEEL_H
+#define KCP_TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * KCP调度时间轮
+ * 按截止时间（ikcp_check返回值或空闲超时时间）调度连接，
+ * 每个tick只返回截止时间已到的连接，避免每次遍历全部连接
+ *
+ * 实现方式：哈希时间轮（hashed timing wheel）
+ * - 每个槽位对应一个粒度（granularity）的时间片
+ * - 超出一圈的截止时间放在对应槽位，到期前会被跳过（轮数检查）
+ * - 每个conv只保留最早的截止时间，重复调度较晚的时间会被忽略
+ */
+class KCPTimerWheel {
+public:
+  /**
+   * 构造函数
+   * @param granularity - 时间轮粒度，单位毫秒
+   *                      含义：每个槽位代表的时间长度，也是调度精度
+   *                      建议范围：1-10ms
+   *                      推荐值：与KCP的interval保持一致或更小
+   *
+   * @param slots - 槽位数量
+   *                建议范围：256-4096
+   *                注意：一圈的时长 = granularity * slots
+   */
+  KCPTimerWheel(uint32_t granularity = 10, uint32_t slots = 512);
+
+  /**
+   * 重置时间轮
+   * 清空所有调度项，并以current作为起始时间
+   * @param current - 当前时间戳，单位毫秒
+   * @param granularity - 新的时间轮粒度，单位毫秒
+   */
+  void reset(uint32_t current, uint32_t granularity);
+
+  /**
+   * 调度连接
+   * 如果该conv已经有更早（或相同）的截止时间，则忽略本次调度
+   * @param conv - 会话ID
+   * @param deadline - 截止时间戳，单位毫秒
+   */
+  void schedule(uint32_t conv, uint32_t deadline);
+
+  /**
+   * 取消连接的调度
+   * @param conv - 会话ID
+   */
+  void cancel(uint32_t conv);
+
+  /**
+   * 推进时间轮
+   * 处理从上次推进到current之间的所有槽位，收集到期的连接
+   * @param current - 当前时间戳，单位毫秒
+   * @param expired - 输出参数，到期的conv列表（追加写入）
+   */
+  void advance(uint32_t current, std::vector<uint32_t> &expired);
+
+  /**
+   * 获取时间轮粒度
+   */
+  uint32_t get_granularity() const { return granularity_; }
+
+  /**
+   * 获取当前调度中的连接数量
+   */
+  size_t size() const { return pending_.size(); }
+
+private:
+  // 槽位中的调度项
+  struct Entry {
+    uint32_t conv;     // 会话ID
+    uint32_t deadline; // 截止时间戳（毫秒）
+  };
+
+  /**
+   * 计算截止时间所在的槽位（不早于下一个待处理的槽位）
+   */
+  uint32_t slot_of(uint32_t deadline) const;
+
+  /**
+   * 重建时间轮
+   * 事件循环阻塞超过一圈时使用，收集到期连接并重新放置其余调度项
+   */
+  void rebuild(uint32_t current, std::vector<uint32_t> &expired);
+
+private:
+  uint32_t granularity_;                  // 时间轮粒度（毫秒）
+  uint32_t next_tick_;                    // 下一个待处理的槽位下标
+  uint32_t next_tick_time_;               // 下一个待处理槽位的起始时间（毫秒）
+  std::vector<std::vector<Entry>> slots_; // 槽位数组
+
+  // 每个conv当前有效的截止时间
+  // 槽位中与之不一致的调度项视为已失效（延迟删除）
+  std::unordered_map<uint32_t, uint32_t> pending_;
+};
+
+#endif // KCP_TIMER_WHEEL_H
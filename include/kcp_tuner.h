@@ -0,0 +1,75 @@
+#ifndef KCP_TUNER_H
+#define KCP_TUNER_H
+
+#include <cstdint>
+#include "ikcp.h"
+
+/**
+ * KCP参数自适应调节器
+ * 按固定周期采样一个会话的rx_srtt、重传率和nsnd_buf，在配置的范围内在线调整：
+ *   - 发送窗口：窗口被占满且重传率低时放大（适应高带宽时延积），
+ *               重传率高且srtt明显高于最小RTT（排队导致的拥塞丢包）时缩小，
+ *               RTT未上升的随机丢包不缩小窗口
+ *   - update间隔：跟随srtt（局域网用小间隔降低延迟，高延迟链路用大间隔减少开销）
+ *   - 最小RTO：重传率高时降到下限以加快丢包恢复，链路干净时回到srtt附近，避免伪重传
+ *   - 快速重传阈值：重传率高时降低（更早重传），链路干净时提高（容忍乱序）
+ *
+ * 重传率 = 周期内的重传次数（超时 + 快速）/ 周期内发送的数据段数（新段 + 重传）
+ * 只调整本端的发送参数，接收窗口保持set_kcp_config的配置
+ */
+class KCPAdaptiveTuner {
+public:
+  // 调节范围（各参数的上下界和判定阈值）
+  struct Bounds {
+    uint32_t sample_interval; // 采样周期（毫秒）
+    uint32_t min_wnd;         // 发送窗口下限（包）
+    uint32_t max_wnd;         // 发送窗口上限（包）
+    uint32_t min_interval;    // update间隔下限（毫秒，KCP要求不小于10）
+    uint32_t max_interval;    // update间隔上限（毫秒）
+    uint32_t min_minrto;      // 最小RTO的下限（毫秒）
+    uint32_t max_minrto;      // 最小RTO的上限（毫秒）
+    int min_fastresend;       // 快速重传阈值下限（不小于1）
+    int max_fastresend;       // 快速重传阈值上限
+    double low_loss;          // 重传率低于该值视为链路干净
+    double high_loss;         // 重传率高于该值视为链路有损
+    double congestion_rtt;    // srtt超过最小RTT的该倍数时视为拥塞
+
+    Bounds()
+        : sample_interval(1000), min_wnd(32), max_wnd(1024), min_interval(10),
+          max_interval(50), min_minrto(20), max_minrto(100), min_fastresend(1),
+          max_fastresend(4), low_loss(0.01), high_loss(0.05),
+          congestion_rtt(1.5) {}
+  };
+
+  explicit KCPAdaptiveTuner(const Bounds &bounds);
+
+  /**
+   * 采样并调整参数（在ikcp_update之后调用，未到采样周期时直接返回）
+   * @param kcp - KCP控制块
+   * @param current - 当前时间（毫秒）
+   * @return 本次是否修改了参数
+   */
+  bool sample(ikcpcb *kcp, uint32_t current);
+
+  /**
+   * 获取调整次数
+   */
+  uint64_t adjustments() const { return adjustments_; }
+
+  /**
+   * 获取最近一个周期的重传率
+   */
+  double loss_ratio() const { return loss_ratio_; }
+
+private:
+  Bounds bounds_;
+  bool started_;          // 是否已记录基准值
+  uint32_t next_sample_;  // 下一次采样时间
+  uint32_t last_snd_nxt_; // 上次采样时的snd_nxt
+  uint32_t last_retrans_; // 上次采样时的累计重传次数
+  uint32_t min_rtt_;      // 观察到的最小srtt（近似传播时延）
+  double loss_ratio_;     // 最近一个周期的重传率
+  uint64_t adjustments_;  // 调整次数
+};
+
+#endif // KCP_TUNER_H
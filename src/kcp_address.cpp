@@ -0,0 +1,41 @@
+#include "kcp_address.h"
+
+/**
+ * 解析IP地址字符串
+ */
+int KCPAddress::parse(const std::string &ip, int port, KCPAddress *out) {
+  struct sockaddr_in v4;
+  int ret = uv_ip4_addr(ip.c_str(), port, &v4);
+  if (ret == 0) {
+    *out = KCPAddress();
+    out->storage_.v4 = v4;
+    return 0;
+  }
+
+  // uv_ip6_addr支持"%接口名"形式的scope
+  struct sockaddr_in6 v6;
+  ret = uv_ip6_addr(ip.c_str(), port, &v6);
+  if (ret == 0) {
+    *out = KCPAddress();
+    out->storage_.v6 = v6;
+    return 0;
+  }
+  return ret;
+}
+
+/**
+ * 转换为字符串
+ */
+std::string KCPAddress::to_string() const {
+  char ip[INET6_ADDRSTRLEN] = {0};
+  switch (storage_.sa.sa_family) {
+  case AF_INET:
+    uv_ip4_name(&storage_.v4, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(port());
+  case AF_INET6:
+    uv_ip6_name(&storage_.v6, ip, sizeof(ip));
+    return "[" + std::string(ip) + "]:" + std::to_string(port());
+  default:
+    return "(unspecified)";
+  }
+}
@@ -0,0 +1,395 @@
+#include "kcp_allocator.h"
+#include "ikcp.h"
+#include "kcp_log.h"
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+// 各级块大小（含头部），覆盖ikcpcb、IKCPSEG（mtu 512-1472）和flush缓冲区
+static const uint32_t kClassSizes[KCPSlabAllocator::kClassCount] = {
+    64, 128, 256, 512, 1024, 1536, 2048, 3072, 4096, 6144, 8192};
+
+// KCP协议头大小（与ikcp.c中的IKCP_OVERHEAD一致）
+static const int kKcpOverhead = 24;
+
+// 块头部大小，保证返回的指针16字节对齐
+static const size_t kHeaderSize = 16;
+
+// 超大分配的级别标记
+static const uint32_t kLargeClass = 0xffffffff;
+
+// 每次切分的内存块大小
+static const size_t kChunkBytes = 64 * 1024;
+
+// 线程本地链表与全局仓库之间每次转移的块数量
+static const size_t kTransferBatch = 64;
+
+// 线程本地每级最多缓存的空闲块数量，超出后归还一部分到全局仓库
+static const size_t kMaxThreadCached = 1024;
+
+// 块头部
+struct BlockHeader {
+  uint32_t size_class; // 所属级别（kLargeClass表示malloc分配）
+  uint32_t reserved[3];
+};
+
+// 空闲块（复用块的数据区）
+struct FreeNode {
+  FreeNode *next;
+};
+
+// 空闲链表
+struct FreeList {
+  FreeNode *head;
+  size_t count;
+};
+
+// 单个线程的分配计数
+// 只由所属线程写入（load + store，不使用加锁的读-改-写指令），get_stats读取时求和，
+// 各线程的计数位于各自的缓存行，分配和释放时不会争用共享的缓存行
+// 跨线程释放时释放计数记在释放线程上，因此正在使用的数量只在求和后有意义
+struct ThreadCounters {
+  std::atomic<uint64_t> allocs[KCPSlabAllocator::kClassCount];
+  std::atomic<uint64_t> frees[KCPSlabAllocator::kClassCount];
+  std::atomic<uint64_t> large_allocs;
+  std::atomic<uint64_t> large_frees;
+};
+
+// 已退出线程的累计计数（持有仓库锁时访问）
+struct RetiredCounters {
+  uint64_t allocs[KCPSlabAllocator::kClassCount];
+  uint64_t frees[KCPSlabAllocator::kClassCount];
+  uint64_t large_allocs;
+  uint64_t large_frees;
+};
+
+// 全局仓库
+// 故意不释放：线程退出和进程退出时仍可能有KCP对象被释放
+struct Depot {
+  std::mutex mutex;
+  FreeList lists[KCPSlabAllocator::kClassCount];
+  std::vector<ThreadCounters *> threads; // 已注册线程的计数
+  RetiredCounters retired;               // 已退出线程的计数
+  uint64_t high_water[KCPSlabAllocator::kClassCount]; // get_stats观察到的最大值
+};
+
+static Depot *g_depot = new Depot();
+static std::atomic<uint64_t> g_capacity[KCPSlabAllocator::kClassCount];
+static std::atomic<uint64_t> g_reserved_bytes(0);
+static std::atomic<bool> g_installed(false);
+static std::once_flag g_install_once;
+
+// 线程本地缓存（平凡类型，线程退出过程中仍可安全访问）
+struct ThreadCache {
+  FreeList lists[KCPSlabAllocator::kClassCount];
+  ThreadCounters counters;
+  bool registered; // 计数已注册到全局仓库
+  bool exited;     // 线程已经退出，后续释放直接归还全局仓库
+};
+
+static thread_local ThreadCache t_cache;
+
+/**
+ * 把链表的前count个块移到另一个链表
+ */
+static void move_blocks(FreeList &from, FreeList &to, size_t count) {
+  while (count > 0 && from.head) {
+    FreeNode *node = from.head;
+    from.head = node->next;
+    from.count--;
+    node->next = to.head;
+    to.head = node;
+    to.count++;
+    count--;
+  }
+}
+
+/**
+ * 所属线程递增本线程的计数
+ */
+static inline void bump(std::atomic<uint64_t> &counter) {
+  counter.store(counter.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+}
+
+// 线程退出守卫：线程结束时把线程本地空闲块归还全局仓库，计数并入已退出线程的累计值
+struct ThreadCacheGuard {
+  ~ThreadCacheGuard() {
+    std::lock_guard<std::mutex> lock(g_depot->mutex);
+    for (int i = 0; i < KCPSlabAllocator::kClassCount; i++) {
+      move_blocks(t_cache.lists[i], g_depot->lists[i], t_cache.lists[i].count);
+    }
+
+    ThreadCounters &counters = t_cache.counters;
+    RetiredCounters &retired = g_depot->retired;
+    for (int i = 0; i < KCPSlabAllocator::kClassCount; i++) {
+      retired.allocs[i] += counters.allocs[i].load(std::memory_order_relaxed);
+      retired.frees[i] += counters.frees[i].load(std::memory_order_relaxed);
+    }
+    retired.large_allocs += counters.large_allocs.load(std::memory_order_relaxed);
+    retired.large_frees += counters.large_frees.load(std::memory_order_relaxed);
+    std::vector<ThreadCounters *> &threads = g_depot->threads;
+    for (size_t i = 0; i < threads.size(); i++) {
+      if (threads[i] == &counters) {
+        threads[i] = threads.back();
+        threads.pop_back();
+        break;
+      }
+    }
+    t_cache.exited = true;
+  }
+};
+
+static thread_local ThreadCacheGuard t_cache_guard;
+
+/**
+ * 首次分配或释放时注册线程计数和线程退出守卫
+ */
+static void register_thread() {
+  (void)&t_cache_guard;
+  std::lock_guard<std::mutex> lock(g_depot->mutex);
+  g_depot->threads.push_back(&t_cache.counters);
+  t_cache.registered = true;
+}
+
+/**
+ * 查找请求大小对应的级别
+ * @return 级别下标，超过最大级别返回-1
+ */
+static int class_of(size_t size) {
+  size_t total = size + kHeaderSize;
+  for (int i = 0; i < KCPSlabAllocator::kClassCount; i++) {
+    if (total <= kClassSizes[i]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * 切分一个新的内存块放入链表
+ */
+static bool carve_chunk(int cls, FreeList &list) {
+  size_t block = kClassSizes[cls];
+  size_t count = kChunkBytes / block;
+  char *chunk = (char *)malloc(count * block);
+  if (!chunk) {
+    return false;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    FreeNode *node = (FreeNode *)(chunk + i * block);
+    node->next = list.head;
+    list.head = node;
+  }
+  list.count += count;
+
+  g_capacity[cls].fetch_add(count, std::memory_order_relaxed);
+  g_reserved_bytes.fetch_add(count * block, std::memory_order_relaxed);
+  return true;
+}
+
+/**
+ * 线程本地链表为空时补充空闲块
+ * 优先从全局仓库取，仓库为空时切分新的内存块
+ */
+static bool refill(int cls) {
+  FreeList &local = t_cache.lists[cls];
+  {
+    std::lock_guard<std::mutex> lock(g_depot->mutex);
+    move_blocks(g_depot->lists[cls], local, kTransferBatch);
+  }
+  if (local.head) {
+    return true;
+  }
+  return carve_chunk(cls, local);
+}
+
+/**
+ * 安装到KCP
+ */
+void KCPSlabAllocator::install() {
+  // ikcp.c中的钩子是普通静态变量：call_once保证所有从install返回的线程
+  // 都能看到写入后的钩子（集群的各工作线程同时创建第一个连接），
+  // 之后的ikcp_create/ikcp_release不会再与写入并发
+  std::call_once(g_install_once, []() {
+    ikcp_allocator(allocate, deallocate);
+    g_installed.store(true, std::memory_order_release);
+    KCP_LOG_INFO("[KCPSlabAllocator] 已安装KCP分级内存分配器");
+  });
+}
+
+/**
+ * 是否已安装
+ */
+bool KCPSlabAllocator::is_installed() {
+  return g_installed.load(std::memory_order_acquire);
+}
+
+/**
+ * 分配内存
+ */
+void *KCPSlabAllocator::allocate(size_t size) {
+  if (!t_cache.registered && !t_cache.exited) {
+    register_thread();
+  }
+
+  int cls = class_of(size);
+  if (cls < 0) {
+    // 超大分配直接使用malloc，同样带头部以便释放时识别
+    BlockHeader *header = (BlockHeader *)malloc(size + kHeaderSize);
+    if (!header) {
+      return nullptr;
+    }
+    header->size_class = kLargeClass;
+    bump(t_cache.counters.large_allocs);
+    return (char *)header + kHeaderSize;
+  }
+
+  FreeList &local = t_cache.lists[cls];
+  if (!local.head && !refill(cls)) {
+    return nullptr;
+  }
+
+  FreeNode *node = local.head;
+  local.head = node->next;
+  local.count--;
+
+  bump(t_cache.counters.allocs[cls]);
+
+  BlockHeader *header = (BlockHeader *)node;
+  header->size_class = (uint32_t)cls;
+  return (char *)header + kHeaderSize;
+}
+
+/**
+ * 释放内存
+ */
+void KCPSlabAllocator::deallocate(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  BlockHeader *header = (BlockHeader *)((char *)ptr - kHeaderSize);
+  uint32_t cls = header->size_class;
+  if (t_cache.exited) {
+    // 线程已经退出（线程本地对象析构过程中释放），直接归还全局仓库
+    std::lock_guard<std::mutex> lock(g_depot->mutex);
+    if (cls == kLargeClass) {
+      g_depot->retired.large_frees++;
+      free(header);
+      return;
+    }
+    g_depot->retired.frees[cls]++;
+    FreeNode *node = (FreeNode *)header;
+    node->next = g_depot->lists[cls].head;
+    g_depot->lists[cls].head = node;
+    g_depot->lists[cls].count++;
+    return;
+  }
+
+  if (!t_cache.registered) {
+    register_thread();
+  }
+  if (cls == kLargeClass) {
+    bump(t_cache.counters.large_frees);
+    free(header);
+    return;
+  }
+  bump(t_cache.counters.frees[cls]);
+
+  FreeNode *node = (FreeNode *)header;
+
+  FreeList &local = t_cache.lists[cls];
+  node->next = local.head;
+  local.head = node;
+  local.count++;
+
+  // 线程本地缓存过多（如连接集中在本线程释放），归还一部分供其他线程使用
+  if (local.count > kMaxThreadCached) {
+    std::lock_guard<std::mutex> lock(g_depot->mutex);
+    move_blocks(local, g_depot->lists[cls], kMaxThreadCached / 2);
+  }
+}
+
+/**
+ * 按预期会话数量预先切分内存块
+ */
+void KCPSlabAllocator::reserve(size_t sessions, int mtu,
+                               int segments_per_session) {
+  if (mtu < 50) {
+    mtu = 50;
+  }
+  if (segments_per_session < 0) {
+    segments_per_session = 0;
+  }
+
+  // 每个会话的分配：ikcpcb、flush缓冲区（ikcp_create和ikcp_setmtu中分配）、数据段
+  struct Need {
+    int cls;
+    size_t count;
+  } needs[3] = {
+      {class_of(sizeof(ikcpcb)), sessions},
+      {class_of((size_t)(mtu + kKcpOverhead) * 3), sessions},
+      {class_of(sizeof(IKCPSEG) + (size_t)(mtu - kKcpOverhead)),
+       sessions * (size_t)segments_per_session},
+  };
+
+  std::lock_guard<std::mutex> lock(g_depot->mutex);
+  for (int i = 0; i < 3; i++) {
+    if (needs[i].cls < 0) {
+      continue;
+    }
+    FreeList &list = g_depot->lists[needs[i].cls];
+    while (list.count < needs[i].count) {
+      if (!carve_chunk(needs[i].cls, list)) {
+        KCP_LOG_ERROR("[KCPSlabAllocator] 预留内存失败");
+        return;
+      }
+    }
+  }
+
+  KCP_LOG_INFO("[KCPSlabAllocator] 已预留内存，sessions=" << sessions << ", mtu="
+               << mtu << ", segments_per_session=" << segments_per_session
+               << ", reserved_bytes=" << g_reserved_bytes.load());
+}
+
+/**
+ * 获取统计信息
+ */
+KCPSlabAllocator::Stats KCPSlabAllocator::get_stats() {
+  std::lock_guard<std::mutex> lock(g_depot->mutex);
+  RetiredCounters total = g_depot->retired;
+  const std::vector<ThreadCounters *> &threads = g_depot->threads;
+  for (size_t t = 0; t < threads.size(); t++) {
+    for (int i = 0; i < kClassCount; i++) {
+      total.allocs[i] += threads[t]->allocs[i].load(std::memory_order_relaxed);
+      total.frees[i] += threads[t]->frees[i].load(std::memory_order_relaxed);
+    }
+    total.large_allocs +=
+        threads[t]->large_allocs.load(std::memory_order_relaxed);
+    total.large_frees += threads[t]->large_frees.load(std::memory_order_relaxed);
+  }
+
+  // 各线程的计数不是同一时刻的快照，释放可能先于对应的分配被读到
+  Stats stats;
+  for (int i = 0; i < kClassCount; i++) {
+    uint64_t in_use =
+        total.allocs[i] > total.frees[i] ? total.allocs[i] - total.frees[i] : 0;
+    if (in_use > g_depot->high_water[i]) {
+      g_depot->high_water[i] = in_use;
+    }
+    stats.classes[i].block_size = kClassSizes[i];
+    stats.classes[i].capacity = g_capacity[i].load(std::memory_order_relaxed);
+    stats.classes[i].in_use = in_use;
+    stats.classes[i].high_water = g_depot->high_water[i];
+    stats.classes[i].allocs = total.allocs[i];
+  }
+  stats.large_allocs = total.large_allocs;
+  stats.large_in_use = total.large_allocs > total.large_frees
+                           ? total.large_allocs - total.large_frees
+                           : 0;
+  stats.reserved_bytes = g_reserved_bytes.load(std::memory_order_relaxed);
+  return stats;
+}
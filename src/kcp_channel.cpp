@@ -0,0 +1,190 @@
+#include "kcp_channel.h"
+#include <cstring>
+
+/**
+ * 构造函数实现
+ */
+KCPChannelMux::KCPChannelMux(int channels)
+    : send_queues_(channels), reassembly_(channels), in_message_(channels),
+      queued_messages_(0), queued_bytes_(0) {}
+
+/**
+ * 将一条消息加入通道的发送队列
+ */
+void KCPChannelMux::enqueue(uint8_t channel, const uv_buf_t *bufs, int count,
+                            uint32_t enqueue_time) {
+  Message message;
+  message.offset = 0;
+  message.enqueue_time = enqueue_time;
+  size_t total = 0;
+  for (int i = 0; i < count; i++) {
+    total += bufs[i].len;
+  }
+  message.data.reserve(total);
+  for (int i = 0; i < count; i++) {
+    message.data.append(bufs[i].base, bufs[i].len);
+  }
+
+  send_queues_[channel].push_back(std::move(message));
+  queued_messages_++;
+  queued_bytes_ += total;
+}
+
+/**
+ * 将一条流式消息加入通道的发送队列
+ */
+void KCPChannelMux::enqueue_stream(uint8_t channel, Producer producer,
+                                   uint32_t enqueue_time) {
+  Message message;
+  message.offset = 0;
+  message.enqueue_time = enqueue_time;
+  message.producer = producer;
+  send_queues_[channel].push_back(std::move(message));
+  queued_messages_++;
+}
+
+/**
+ * 估算排队数据需要的分片数
+ */
+size_t KCPChannelMux::queued_chunks(int payload) const {
+  if (payload <= 0) {
+    return queued_messages_;
+  }
+  // 空消息也占用一个分片
+  size_t chunks = (queued_bytes_ + payload - 1) / payload;
+  return chunks > queued_messages_ ? chunks : queued_messages_;
+}
+
+/**
+ * 取出下一个分片
+ */
+int KCPChannelMux::next_chunk(char *out, int max_len, int *payload_len,
+                              uint8_t *flags, uint32_t *enqueue_time) {
+  int payload = max_len - kHeaderSize;
+  if (queued_messages_ == 0 || payload <= 0) {
+    return 0;
+  }
+
+  // 选择有数据的、编号最小的通道
+  for (size_t channel = 0; channel < send_queues_.size(); channel++) {
+    std::deque<Message> &queue = send_queues_[channel];
+    if (queue.empty()) {
+      continue;
+    }
+
+    // 生产者可能向队列追加消息，deque的push_back不会使已有元素的引用失效
+    Message &message = queue.front();
+    uint8_t chunk_flags = message.offset == 0 ? FLAG_FIRST : 0;
+    size_t n = 0;
+    if (message.producer) {
+      // 流式消息：直接生产到分片中，结束或中止时发送一个空的LAST分片
+      chunk_flags |= FLAG_STREAM;
+      int produced = message.producer(out + kHeaderSize, payload);
+      if (produced > 0) {
+        n = produced < payload ? (size_t)produced : (size_t)payload;
+        message.offset += n;
+      } else {
+        chunk_flags |= FLAG_LAST;
+        if (produced < 0) {
+          chunk_flags |= FLAG_ABORT;
+        }
+      }
+    } else {
+      size_t remaining = message.data.size() - message.offset;
+      n = remaining < (size_t)payload ? remaining : (size_t)payload;
+      if (n == remaining) {
+        chunk_flags |= FLAG_LAST;
+      }
+      memcpy(out + kHeaderSize, message.data.data() + message.offset, n);
+      message.offset += n;
+      queued_bytes_ -= n;
+    }
+    out[0] = (char)channel;
+    out[1] = (char)chunk_flags;
+    *enqueue_time = message.enqueue_time;
+
+    if (chunk_flags & FLAG_LAST) {
+      queue.pop_front();
+      queued_messages_--;
+    }
+    *payload_len = (int)n;
+    *flags = chunk_flags;
+    return kHeaderSize + (int)n;
+  }
+  return 0;
+}
+
+/**
+ * 处理接收到的分片
+ */
+int KCPChannelMux::on_chunk(const char *chunk, int len, int max_message_size,
+                            bool passthrough, uint8_t *channel, uint8_t *flags,
+                            const char **data, size_t *size) {
+  if (len < kHeaderSize) {
+    return CHUNK_ERROR;
+  }
+  uint8_t ch = (uint8_t)chunk[0];
+  uint8_t chunk_flags = (uint8_t)chunk[1];
+  if (ch >= reassembly_.size()) {
+    return CHUNK_ERROR;
+  }
+
+  const char *payload = chunk + kHeaderSize;
+  size_t n = (size_t)(len - kHeaderSize);
+
+  // 消息边界必须连续：FIRST只能出现在消息之间，非FIRST只能出现在消息之中
+  if ((chunk_flags & FLAG_FIRST) != 0 ? in_message_[ch] : !in_message_[ch]) {
+    return CHUNK_ERROR;
+  }
+  *flags = chunk_flags;
+
+  // 流式分片逐片返回，只维护消息边界
+  if ((chunk_flags & FLAG_STREAM) && passthrough) {
+    in_message_[ch] = (chunk_flags & FLAG_LAST) == 0;
+    *channel = ch;
+    *data = payload;
+    *size = n;
+    return CHUNK_STREAM;
+  }
+
+  // 被中止的流式消息丢弃已重组的部分
+  if ((chunk_flags & FLAG_ABORT) != 0) {
+    in_message_[ch] = false;
+    reassembly_[ch].clear();
+    return CHUNK_PARTIAL;
+  }
+
+  // 单分片消息直接返回分片中的数据，无需复制
+  if ((chunk_flags & (FLAG_FIRST | FLAG_LAST)) == (FLAG_FIRST | FLAG_LAST)) {
+    if (n > (size_t)max_message_size) {
+      return CHUNK_ERROR;
+    }
+    *channel = ch;
+    *data = payload;
+    *size = n;
+    return CHUNK_COMPLETE;
+  }
+
+  std::string &buffer = reassembly_[ch];
+  if (chunk_flags & FLAG_FIRST) {
+    // 重组过大消息之后释放多余的内存
+    if (buffer.capacity() > 65536) {
+      std::string().swap(buffer);
+    }
+    buffer.clear();
+    in_message_[ch] = true;
+  }
+  if (buffer.size() + n > (size_t)max_message_size) {
+    return CHUNK_ERROR;
+  }
+  buffer.append(payload, n);
+
+  if (!(chunk_flags & FLAG_LAST)) {
+    return CHUNK_PARTIAL;
+  }
+  in_message_[ch] = false;
+  *channel = ch;
+  *data = buffer.data();
+  *size = buffer.size();
+  return CHUNK_COMPLETE;
+}
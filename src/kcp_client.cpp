@@ -1,7 +1,7 @@
 #include "kcp_client.h"
+#include "kcp_log.h"
 #include <chrono>
 #include <cstring>
-#include <iostream>
 
 /**
  * 构造函数实现
@@ -9,7 +9,9 @@
 KCPClient::KCPClient(uv_loop_t *loop)
     : loop_(loop), running_(false), kcp_nodelay_(1), kcp_interval_(10),
       kcp_resend_(2), kcp_nc_(1), kcp_sndwnd_(128), kcp_rcvwnd_(128),
-      kcp_mtu_(1400) {
+      kcp_mtu_(1400), max_message_size_(KCPConnection::kDefaultMaxMessageSize),
+      channels_(0), tuning_(false), pmtu_(false), fec_data_(0), fec_parity_(0),
+      handshake_(false) {
   // 初始化UDP句柄
   uv_udp_init(loop_, &udp_handle_);
   udp_handle_.data = this;
@@ -18,7 +20,7 @@ KCPClient::KCPClient(uv_loop_t *loop)
   uv_timer_init(loop_, &timer_);
   timer_.data = this;
 
-  std::cout << "[KCPClient] 客户端已创建" << std::endl;
+  KCP_LOG_INFO("[KCPClient] 客户端已创建");
 }
 
 /**
@@ -26,7 +28,7 @@ KCPClient::KCPClient(uv_loop_t *loop)
  */
 KCPClient::~KCPClient() {
   disconnect();
-  std::cout << "[KCPClient] 客户端已销毁" << std::endl;
+  KCP_LOG_INFO("[KCPClient] 客户端已销毁");
 }
 
 /**
@@ -35,62 +37,82 @@ KCPClient::~KCPClient() {
 int KCPClient::connect(const std::string &server_ip, int server_port,
                        uint32_t conv) {
   if (connection_) {
-    std::cerr << "[KCPClient] 已经存在连接" << std::endl;
+    KCP_LOG_ERROR("[KCPClient] 已经存在连接");
     return -1;
   }
 
-  struct sockaddr_in server_addr;
-
-  // 创建服务器地址结构
-  int ret = uv_ip4_addr(server_ip.c_str(), server_port, &server_addr);
+  // 创建服务器地址结构（IPv4或IPv6）
+  KCPAddress server_addr;
+  int ret = KCPAddress::parse(server_ip, server_port, &server_addr);
   if (ret < 0) {
-    std::cerr << "[KCPClient] 无效的服务器地址: " << uv_strerror(ret)
-              << std::endl;
+    KCP_LOG_ERROR("[KCPClient] 无效的服务器地址: " << uv_strerror(ret));
     return ret;
   }
 
-  // 绑定本地地址（使用0.0.0.0:0表示自动分配）
-  struct sockaddr_in local_addr;
-  uv_ip4_addr("0.0.0.0", 0, &local_addr);
-  ret = uv_udp_bind(&udp_handle_, (const struct sockaddr *)&local_addr, 0);
+  // 绑定与服务器地址族相同的本地地址（0.0.0.0:0或[::]:0表示自动分配）
+  KCPAddress local_addr;
+  KCPAddress::parse(server_addr.family() == AF_INET6 ? "::" : "0.0.0.0", 0,
+                    &local_addr);
+  ret = uv_udp_bind(&udp_handle_, local_addr.get(), 0);
   if (ret < 0) {
-    std::cerr << "[KCPClient] 绑定本地地址失败: " << uv_strerror(ret)
-              << std::endl;
+    KCP_LOG_ERROR("[KCPClient] 绑定本地地址失败: " << uv_strerror(ret));
     return ret;
   }
 
+  // 路径MTU探测需要DF位
+  KCPPmtuProber::prepare_socket(&udp_handle_, kcp_mtu_, pmtu_, pmtu_config_);
+
   // 开始接收UDP数据
   ret = uv_udp_recv_start(&udp_handle_, alloc_buffer, on_udp_recv);
   if (ret < 0) {
-    std::cerr << "[KCPClient] 启动接收失败: " << uv_strerror(ret) << std::endl;
+    KCP_LOG_ERROR("[KCPClient] 启动接收失败: " << uv_strerror(ret));
     return ret;
   }
 
   // 创建KCP连接
   connection_ = std::make_shared<KCPConnection>(
-      conv, &udp_handle_, (const struct sockaddr *)&server_addr);
+      conv, &udp_handle_, server_addr.get());
 
   // 初始化KCP参数
   connection_->init_kcp(kcp_nodelay_, kcp_interval_, kcp_resend_, kcp_nc_,
                         kcp_sndwnd_, kcp_rcvwnd_, kcp_mtu_);
-
-  // 设置连接状态为已连接
-  connection_->set_state(KCPConnection::CONNECTED);
+  connection_->set_max_message_size(max_message_size_);
+  connection_->set_channels(channels_);
+  connection_->set_adaptive_tuning(tuning_, tuning_bounds_);
+  connection_->set_compression(compression_);
+  connection_->set_fec(fec_data_, fec_parity_);
+  connection_->set_pmtu_discovery(pmtu_, pmtu_config_);
+
+  // 未启用握手时直接进入已连接状态，否则保持CONNECTING直到收到ACCEPT
+  uint32_t current = get_current_ms();
+  if (!handshake_) {
+    connection_->set_state(KCPConnection::CONNECTED);
+  } else {
+    handshake_state_.start(connection_.get(), current);
+  }
 
   // 更新活跃时间
-  connection_->update_active_time(get_current_ms());
+  connection_->update_active_time(current);
 
   // 启动定时器
   ret = uv_timer_start(&timer_, on_timer, 0, 10);
   if (ret < 0) {
-    std::cerr << "[KCPClient] 启动定时器失败: " << uv_strerror(ret)
-              << std::endl;
+    KCP_LOG_ERROR("[KCPClient] 启动定时器失败: " << uv_strerror(ret));
     return ret;
   }
 
   running_ = true;
-  std::cout << "[KCPClient] 已连接到服务器 " << server_ip << ":" << server_port
-            << ", conv=" << conv << std::endl;
+  if (handshake_) {
+    KCP_LOG_INFO("[KCPClient] 开始握手 " << server_ip << ":" << server_port
+                 << ", conv=" << conv);
+    return 0;
+  }
+
+  KCP_LOG_INFO("[KCPClient] 已连接到服务器 " << server_ip << ":" << server_port
+               << ", conv=" << conv);
+  if (connect_callback_) {
+    connect_callback_(true);
+  }
   return 0;
 }
 
@@ -99,13 +121,50 @@ int KCPClient::connect(const std::string &server_ip, int server_port,
  */
 int KCPClient::send(const char *data, int len) {
   if (!connection_) {
-    std::cerr << "[KCPClient] 未连接到服务器" << std::endl;
+    KCP_LOG_ERROR("[KCPClient] 未连接到服务器");
     return -1;
   }
 
   return connection_->send(data, len);
 }
 
+/**
+ * 分散-聚集发送数据
+ */
+int KCPClient::sendv(const uv_buf_t *bufs, int count) {
+  if (!connection_) {
+    KCP_LOG_ERROR("[KCPClient] 未连接到服务器");
+    return -1;
+  }
+
+  return connection_->sendv(bufs, count);
+}
+
+/**
+ * 发送数据到指定通道
+ */
+int KCPClient::send_channel(uint8_t channel, const char *data, int len) {
+  if (!connection_) {
+    KCP_LOG_ERROR("[KCPClient] 未连接到服务器");
+    return -1;
+  }
+
+  return connection_->send_channel(channel, data, len);
+}
+
+/**
+ * 流式发送一条大消息
+ */
+int KCPClient::send_stream(uint8_t channel,
+                           KCPConnection::StreamProducer producer) {
+  if (!connection_) {
+    KCP_LOG_ERROR("[KCPClient] 未连接到服务器");
+    return -1;
+  }
+
+  return connection_->send_stream(channel, producer);
+}
+
 /**
  * 断开连接
  */
@@ -114,7 +173,7 @@ void KCPClient::disconnect() {
     return;
   }
 
-  std::cout << "[KCPClient] 断开连接" << std::endl;
+  KCP_LOG_INFO("[KCPClient] 断开连接");
 
   running_ = false;
 
@@ -124,8 +183,8 @@ void KCPClient::disconnect() {
   // 停止UDP接收
   uv_udp_recv_stop(&udp_handle_);
 
-  // 关闭连接
-  connection_->close();
+  // 关闭连接（连接对象随后释放，无法继续排空发送队列）
+  connection_->abort();
   connection_.reset();
 }
 
@@ -134,13 +193,13 @@ void KCPClient::disconnect() {
  */
 void KCPClient::run() {
   if (!running_) {
-    std::cerr << "[KCPClient] 客户端未连接" << std::endl;
+    KCP_LOG_ERROR("[KCPClient] 客户端未连接");
     return;
   }
 
-  std::cout << "[KCPClient] 事件循环开始运行" << std::endl;
+  KCP_LOG_INFO("[KCPClient] 事件循环开始运行");
   uv_run(loop_, UV_RUN_DEFAULT);
-  std::cout << "[KCPClient] 事件循环已退出" << std::endl;
+  KCP_LOG_INFO("[KCPClient] 事件循环已退出");
 }
 
 /**
@@ -153,7 +212,7 @@ void KCPClient::stop() {
 
   disconnect();
   uv_stop(loop_);
-  std::cout << "[KCPClient] 客户端已停止" << std::endl;
+  KCP_LOG_INFO("[KCPClient] 客户端已停止");
 }
 
 /**
@@ -165,6 +224,35 @@ void KCPClient::set_data_callback(KCPConnection::DataCallback cb) {
   }
 }
 
+/**
+ * 设置通道数据接收回调函数
+ */
+void KCPClient::set_channel_data_callback(
+    KCPConnection::ChannelDataCallback cb) {
+  if (connection_) {
+    connection_->set_channel_data_callback(cb);
+  }
+}
+
+/**
+ * 设置流式消息接收回调函数
+ */
+void KCPClient::set_stream_callback(KCPConnection::StreamCallback cb) {
+  if (connection_) {
+    connection_->set_stream_callback(cb);
+  }
+}
+
+/**
+ * 设置应用层缓冲区接收方式
+ */
+void KCPClient::set_buffer_receiver(KCPConnection::BufferAllocator alloc,
+                                    KCPConnection::BufferDataCallback cb) {
+  if (connection_) {
+    connection_->set_buffer_receiver(alloc, cb);
+  }
+}
+
 /**
  * 设置连接关闭回调函数
  */
@@ -174,6 +262,26 @@ void KCPClient::set_close_callback(KCPConnection::CloseCallback cb) {
   }
 }
 
+/**
+ * 设置可写回调函数
+ */
+void KCPClient::set_writable_callback(KCPConnection::WritableCallback cb) {
+  if (connection_) {
+    connection_->set_writable_callback(cb);
+  }
+}
+
+/**
+ * 设置发送队列水位
+ */
+void KCPClient::set_send_watermarks(uint32_t high_packets, uint32_t low_packets,
+                                    size_t high_bytes, size_t low_bytes) {
+  if (connection_) {
+    connection_->set_send_watermarks(high_packets, low_packets, high_bytes,
+                                     low_bytes);
+  }
+}
+
 /**
  * 设置KCP配置
  */
@@ -187,10 +295,10 @@ void KCPClient::set_kcp_config(int nodelay, int interval, int resend, int nc,
   kcp_rcvwnd_ = rcvwnd;
   kcp_mtu_ = mtu;
 
-  std::cout << "[KCPClient] KCP配置已更新: "
-            << "nodelay=" << nodelay << ", interval=" << interval
-            << ", resend=" << resend << ", nc=" << nc << ", sndwnd=" << sndwnd
-            << ", rcvwnd=" << rcvwnd << ", mtu=" << mtu << std::endl;
+  KCP_LOG_INFO("[KCPClient] KCP配置已更新: " << "nodelay=" << nodelay
+               << ", interval=" << interval << ", resend=" << resend
+               << ", nc=" << nc << ", sndwnd=" << sndwnd << ", rcvwnd="
+               << rcvwnd << ", mtu=" << mtu);
 }
 
 /**
@@ -200,6 +308,18 @@ bool KCPClient::is_connected() const {
   return connection_ && connection_->get_state() == KCPConnection::CONNECTED;
 }
 
+/**
+ * 获取连接统计信息
+ */
+KCPConnection::Stats KCPClient::get_stats() const {
+  if (!connection_) {
+    KCPConnection::Stats stats;
+    memset(&stats, 0, sizeof(stats));
+    return stats;
+  }
+  return connection_->get_stats();
+}
+
 /**
  * 获取当前时间戳
  */
@@ -228,7 +348,7 @@ void KCPClient::on_udp_recv(uv_udp_t *handle, ssize_t nread,
   KCPClient *client = (KCPClient *)handle->data;
 
   if (nread < 0) {
-    std::cerr << "[KCPClient] UDP接收错误: " << uv_strerror(nread) << std::endl;
+    KCP_LOG_ERROR("[KCPClient] UDP接收错误: " << uv_strerror(nread));
     return;
   }
 
@@ -237,7 +357,13 @@ void KCPClient::on_udp_recv(uv_udp_t *handle, ssize_t nread,
   }
 
   if (flags & UV_UDP_PARTIAL) {
-    std::cerr << "[KCPClient] UDP数据被截断" << std::endl;
+    KCP_LOG_WARN("[KCPClient] UDP数据被截断");
+    return;
+  }
+
+  // 只接受来自服务器地址的数据
+  if (!client->connection_ || !client->connection_->get_address().equals(addr)) {
+    KCP_LOG_DEBUG("[KCPClient] 丢弃非服务器地址的数据，len=" << nread);
     return;
   }
 
@@ -263,6 +389,20 @@ void KCPClient::handle_udp_data(const char *data, int len) {
   // 更新活跃时间
   connection_->update_active_time(get_current_ms());
 
+  // 控制包（会话令牌、地址验证挑战）不进入KCP
+  if (KCPControl::is_control(data, len)) {
+    if (KCPClientHandshake::handle_control(connection_.get(), &handshake_state_,
+                                           data, len, get_current_ms())) {
+      on_handshake_done();
+    }
+    return;
+  }
+
+  // 握手期间收到KCP数据说明服务器已创建会话（ACCEPT丢失）
+  if (connection_->get_state() == KCPConnection::CONNECTING) {
+    on_handshake_done();
+  }
+
   // 将数据输入到KCP
   connection_->input(data, len);
 
@@ -270,6 +410,18 @@ void KCPClient::handle_udp_data(const char *data, int len) {
   connection_->recv();
 }
 
+/**
+ * 握手完成
+ */
+void KCPClient::on_handshake_done() {
+  KCPClientHandshake::complete(connection_.get(), get_current_ms());
+  KCP_LOG_INFO("[KCPClient] 握手完成，conv=" << connection_->get_conv());
+
+  if (connect_callback_) {
+    connect_callback_(true);
+  }
+}
+
 /**
  * 更新连接
  */
@@ -280,6 +432,19 @@ void KCPClient::update_connection() {
 
   uint32_t current = get_current_ms();
 
+  // 握手期间不驱动KCP（数据留在发送队列中），只重发HELLO
+  if (connection_->get_state() == KCPConnection::CONNECTING) {
+    if (!handshake_state_.poll(connection_.get(), current)) {
+      KCP_LOG_WARN("[KCPClient] 握手超时，conv=" << connection_->get_conv());
+      ConnectCallback cb = connect_callback_;
+      disconnect();
+      if (cb) {
+        cb(false);
+      }
+    }
+    return;
+  }
+
   // 更新KCP状态
   connection_->update(current);
 
@@ -0,0 +1,127 @@
+#include "kcp_client_handshake.h"
+#include "kcp_log.h"
+
+/**
+ * 构造函数实现
+ */
+KCPClientHandshake::KCPClientHandshake()
+    : has_cookie_(false), cookie_(0), start_(0), hello_time_(0) {}
+
+/**
+ * 开始握手
+ */
+void KCPClientHandshake::start(KCPConnection *conn, uint32_t current) {
+  has_cookie_ = false;
+  cookie_ = 0;
+  start_ = current;
+  send_hello(conn, current);
+}
+
+/**
+ * 驱动握手
+ */
+bool KCPClientHandshake::poll(KCPConnection *conn, uint32_t current) {
+  if ((int32_t)(current - start_) >= (int32_t)kHandshakeTimeout) {
+    return false;
+  }
+  if ((int32_t)(current - hello_time_) >= (int32_t)kHelloInterval) {
+    send_hello(conn, current);
+  }
+  return true;
+}
+
+/**
+ * 获取下一次需要调用poll的时间
+ */
+uint32_t KCPClientHandshake::next_time() const {
+  uint32_t hello = hello_time_ + kHelloInterval;
+  uint32_t deadline = start_ + kHandshakeTimeout;
+  return (int32_t)(hello - deadline) < 0 ? hello : deadline;
+}
+
+/**
+ * 处理控制包
+ */
+bool KCPClientHandshake::handle_control(KCPConnection *conn,
+                                        KCPClientHandshake *handshake,
+                                        const char *data, int len,
+                                        uint32_t current) {
+  uint32_t conv = conn->get_conv();
+  if (*(const uint32_t *)data != conv) {
+    return false;
+  }
+
+  bool connecting = conn->get_state() == KCPConnection::CONNECTING;
+  char packet[KCPControl::kMaxPacketSize];
+  switch (KCPControl::get_cmd(data)) {
+  case KCP_CTRL_TOKEN: {
+    // 保存令牌并确认（确认可能丢失，服务器会重发令牌，每次都回复）
+    KCPSessionToken token;
+    if (!KCPControl::decode_token(data, len, &token)) {
+      return false;
+    }
+    conn->set_session_token(token);
+    int n = KCPControl::encode_simple(packet, conv, KCP_CTRL_TOKEN_ACK);
+    conn->send_udp_direct(packet, n);
+
+    // 令牌在会话创建时下发，可以代替丢失的ACCEPT
+    return connecting;
+  }
+
+  case KCP_CTRL_COOKIE:
+    // 回显cookie，证明本端能收到发往该地址的数据
+    if (!handshake || !connecting ||
+        !KCPControl::decode_value(data, len, &handshake->cookie_)) {
+      return false;
+    }
+    handshake->has_cookie_ = true;
+    handshake->send_hello(conn, current);
+    return false;
+
+  case KCP_CTRL_ACCEPT:
+    return connecting;
+
+  case KCP_CTRL_PMTU_PROBE:
+  case KCP_CTRL_PMTU_ACK:
+    conn->on_pmtu_control(data, len);
+    return false;
+
+  case KCP_CTRL_CHALLENGE: {
+    // 本地地址发生了变化（NAT重绑定等），用令牌证明会话归属
+    uint64_t nonce;
+    const KCPSessionToken *token = conn->get_session_token();
+    if (!token || !KCPControl::decode_challenge(data, len, &nonce)) {
+      return false;
+    }
+    int n = KCPControl::encode_response(packet, conv, nonce, *token);
+    conn->send_udp_direct(packet, n);
+    KCP_LOG_DEBUG("[KCPClientHandshake] 收到地址验证挑战，已应答，conv="
+                  << conv);
+    return false;
+  }
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * 完成握手
+ */
+void KCPClientHandshake::complete(KCPConnection *conn, uint32_t current) {
+  conn->set_state(KCPConnection::CONNECTED);
+
+  // 立即发出握手期间排队的数据
+  conn->update(current);
+}
+
+/**
+ * 发送HELLO
+ */
+void KCPClientHandshake::send_hello(KCPConnection *conn, uint32_t current) {
+  char packet[KCPControl::kMaxPacketSize];
+  int n = KCPControl::encode_hello(packet, conn->get_conv(),
+                                   has_cookie_ ? &cookie_ : nullptr);
+  conn->send_udp_direct(packet, n);
+  hello_time_ = current;
+}
@@ -0,0 +1,573 @@
+#include "kcp_client_pool.h"
+#include "kcp_log.h"
+#include <chrono>
+#include <cstring>
+
+/**
+ * 构造函数实现
+ */
+KCPClientPool::KCPClientPool(uv_loop_t *loop)
+    : loop_(loop), socket_count_(1), socket_buffer_(4 * 1024 * 1024),
+      family_(0), timer_granularity_(10),
+      send_batching_(false), handshake_(false), timeout_(0), kcp_nodelay_(1),
+      kcp_interval_(10), kcp_resend_(2), kcp_nc_(1), kcp_sndwnd_(128),
+      kcp_rcvwnd_(128), kcp_mtu_(1400),
+      max_message_size_(KCPConnection::kDefaultMaxMessageSize), channels_(0),
+      tuning_(false), pmtu_(false), fec_data_(0), fec_parity_(0) {
+  // 发送池在堆上分配：析构时交给正在关闭的socket，等待未完成的发送请求回调
+  send_pool_.reset(new KCPSendPool());
+
+  // 初始化调度定时器
+  // 句柄在堆上分配：关闭在析构之后的事件循环迭代中完成
+  timer_ = new uv_timer_t;
+  uv_timer_init(loop_, timer_);
+  timer_->data = this;
+
+  // 初始化批量发送的check句柄
+  flush_check_ = new uv_check_t;
+  uv_check_init(loop_, flush_check_);
+  flush_check_->data = this;
+
+  memset(&stats_, 0, sizeof(stats_));
+
+  KCP_LOG_INFO("[KCPClientPool] 连接池已创建");
+}
+
+/**
+ * 析构函数实现
+ */
+KCPClientPool::~KCPClientPool() {
+  stop();
+  connections_.clear();
+  closed_connections_.clear();
+
+  // libuv仍持有socket、定时器和check句柄，关闭后在关闭回调中释放
+  if (sockets_.empty()) {
+    send_pool_.reset();
+  } else {
+    SocketCloser *closer = new SocketCloser;
+    closer->remaining = sockets_.size();
+    closer->send_pool = std::move(send_pool_);
+    close_sockets(closer);
+  }
+  uv_close((uv_handle_t *)timer_, on_timer_close);
+  uv_close((uv_handle_t *)flush_check_, on_check_close);
+  KCP_LOG_INFO("[KCPClientPool] 连接池已销毁");
+}
+
+/**
+ * 设置UDP socket数量
+ */
+void KCPClientPool::set_sockets(int count) {
+  if (family_ != 0) {
+    KCP_LOG_WARN("[KCPClientPool] socket已创建，忽略socket数量设置");
+    return;
+  }
+  socket_count_ = count < 1 ? 1 : (count > 1024 ? 1024 : count);
+}
+
+/**
+ * 按地址族创建并绑定socket
+ */
+int KCPClientPool::open_sockets(int family) {
+  KCPAddress local_addr;
+  KCPAddress::parse(family == AF_INET6 ? "::" : "0.0.0.0", 0, &local_addr);
+
+  int slot_size = kcp_mtu_;
+  for (int i = 0; i < socket_count_; i++) {
+    std::unique_ptr<uv_udp_t> handle(new uv_udp_t);
+    uv_udp_init(loop_, handle.get());
+    handle->data = this;
+    sockets_.push_back(std::move(handle));
+    uv_udp_t *udp = sockets_.back().get();
+
+    int ret = uv_udp_bind(udp, local_addr.get(), 0);
+    if (ret < 0) {
+      KCP_LOG_ERROR("[KCPClientPool] 绑定本地地址失败: " << uv_strerror(ret));
+      return ret;
+    }
+
+    // 路径MTU探测需要DF位，发送池槽位需要容纳最大探测长度
+    slot_size =
+        KCPPmtuProber::prepare_socket(udp, kcp_mtu_, pmtu_, pmtu_config_);
+
+    // 每个socket承载多个会话的流量（相当于把多个客户端的缓冲区合并），增大收发缓冲区
+    // （受net.core.rmem_max/wmem_max限制，失败时保持系统默认值）
+    if (socket_buffer_ > 0) {
+      int size = socket_buffer_;
+      uv_recv_buffer_size((uv_handle_t *)udp, &size);
+      size = socket_buffer_;
+      uv_send_buffer_size((uv_handle_t *)udp, &size);
+    }
+
+    ret = uv_udp_recv_start(udp, alloc_buffer, on_udp_recv);
+    if (ret < 0) {
+      KCP_LOG_ERROR("[KCPClientPool] 启动接收失败: " << uv_strerror(ret));
+      return ret;
+    }
+  }
+
+  // 初始化共享的UDP发送池，槽位大小与MTU（启用探测时为最大探测长度）一致
+  send_pool_->setup(slot_size, 1024, send_batching_, flush_check_,
+                    on_flush_check);
+
+  // 所有会话由同一个定时器和时间轮驱动
+  timer_wheel_.reset(get_current_ms(), timer_granularity_);
+  int ret = uv_timer_start(timer_, on_timer, timer_granularity_,
+                           timer_granularity_);
+  if (ret < 0) {
+    KCP_LOG_ERROR("[KCPClientPool] 启动定时器失败: " << uv_strerror(ret));
+    return ret;
+  }
+
+  family_ = family;
+  stats_.sockets = (uint32_t)sockets_.size();
+  KCP_LOG_INFO("[KCPClientPool] 已创建 " << sockets_.size() << " 个UDP socket");
+  return 0;
+}
+
+/**
+ * 关闭socket（句柄在关闭回调中释放）
+ */
+void KCPClientPool::close_sockets(SocketCloser *closer) {
+  uv_timer_stop(timer_);
+  uv_check_stop(flush_check_);
+  for (size_t i = 0; i < sockets_.size(); i++) {
+    uv_udp_t *handle = sockets_[i].release();
+    handle->data = closer;
+    uv_close((uv_handle_t *)handle, on_socket_close);
+  }
+  sockets_.clear();
+  family_ = 0;
+  stats_.sockets = 0;
+}
+
+/**
+ * socket关闭回调函数
+ */
+void KCPClientPool::on_socket_close(uv_handle_t *handle) {
+  SocketCloser *closer = (SocketCloser *)handle->data;
+  delete (uv_udp_t *)handle;
+  if (closer && --closer->remaining == 0) {
+    delete closer;
+  }
+}
+
+/**
+ * 定时器关闭回调函数
+ */
+void KCPClientPool::on_timer_close(uv_handle_t *handle) {
+  delete (uv_timer_t *)handle;
+}
+
+/**
+ * check句柄关闭回调函数
+ */
+void KCPClientPool::on_check_close(uv_handle_t *handle) {
+  delete (uv_check_t *)handle;
+}
+
+/**
+ * 创建一个会话并连接到服务器
+ */
+KCPConnection *KCPClientPool::connect(const std::string &server_ip,
+                                      int server_port, uint32_t conv) {
+  if (conv == 0 || connections_.find(conv)) {
+    KCP_LOG_ERROR("[KCPClientPool] 无效或重复的conv: " << conv);
+    return nullptr;
+  }
+
+  // 创建服务器地址结构（IPv4或IPv6）
+  KCPAddress server_addr;
+  int ret = KCPAddress::parse(server_ip, server_port, &server_addr);
+  if (ret < 0) {
+    KCP_LOG_ERROR("[KCPClientPool] 无效的服务器地址: " << uv_strerror(ret));
+    return nullptr;
+  }
+
+  // 第一次连接时创建socket，之后所有会话共享
+  if (family_ == 0) {
+    ret = open_sockets(server_addr.family());
+    if (ret < 0) {
+      close_sockets();
+      return nullptr;
+    }
+  } else if (server_addr.family() != family_) {
+    KCP_LOG_ERROR("[KCPClientPool] 服务器地址族与socket不一致");
+    return nullptr;
+  }
+
+  // 按conv分配socket
+  uv_udp_t *handle = sockets_[conv % sockets_.size()].get();
+  std::unique_ptr<KCPConnection> owned(
+      new KCPConnection(conv, handle, server_addr.get()));
+  KCPConnection *conn = owned.get();
+  conn->set_send_pool(send_pool_.get());
+
+  // 初始化KCP参数
+  conn->init_kcp(kcp_nodelay_, kcp_interval_, kcp_resend_, kcp_nc_, kcp_sndwnd_,
+                 kcp_rcvwnd_, kcp_mtu_);
+  conn->set_max_message_size(max_message_size_);
+  conn->set_channels(channels_);
+  conn->set_adaptive_tuning(tuning_, tuning_bounds_);
+  conn->set_compression(compression_);
+  conn->set_fec(fec_data_, fec_parity_);
+  conn->set_pmtu_discovery(pmtu_, pmtu_config_);
+
+  conn->set_close_callback(
+      [this](KCPConnection *c) { this->on_connection_close(c); });
+
+  // 有新数据待发送时，在下一个tick处理该会话
+  conn->set_schedule_callback([this](KCPConnection *c) {
+    timer_wheel_.schedule(c->get_conv(), get_current_ms());
+  });
+
+  uint32_t current = get_current_ms();
+  conn->update_active_time(current);
+  connections_.insert(std::move(owned));
+  stats_.sessions_created++;
+
+  // 未启用握手时直接进入已连接状态，否则保持CONNECTING直到收到ACCEPT
+  if (!handshake_) {
+    conn->set_state(KCPConnection::CONNECTED);
+    schedule_connection(conn, current);
+    KCP_LOG_DEBUG("[KCPClientPool] 已创建会话，conv=" << conv);
+    if (connect_callback_) {
+      connect_callback_(conn, true);
+    }
+    return conn;
+  }
+
+  handshakes_[conv].start(conn, current);
+  schedule_connection(conn, current);
+  KCP_LOG_DEBUG("[KCPClientPool] 开始握手，conv=" << conv);
+  return conn;
+}
+
+/**
+ * 断开会话
+ */
+void KCPClientPool::disconnect(uint32_t conv) {
+  KCPConnection *conn = connections_.find(conv);
+  if (!conn) {
+    return;
+  }
+
+  // 先从会话表中移除（延迟释放），再关闭，避免关闭回调中重复移除
+  remove_connection(conv);
+  conn->abort();
+}
+
+/**
+ * 断开所有会话并停止接收
+ */
+void KCPClientPool::stop() {
+  // 关闭回调中会移除会话，先复制conv列表
+  std::vector<uint32_t> convs;
+  convs.reserve(connections_.size());
+  for (size_t i = 0; i < connections_.size(); i++) {
+    convs.push_back(connections_.at(i)->get_conv());
+  }
+  for (size_t i = 0; i < convs.size(); i++) {
+    disconnect(convs[i]);
+  }
+  closed_connections_.clear();
+
+  uv_timer_stop(timer_);
+  send_pool_->flush();
+  uv_check_stop(flush_check_);
+  for (size_t i = 0; i < sockets_.size(); i++) {
+    uv_udp_recv_stop(sockets_[i].get());
+  }
+}
+
+/**
+ * 遍历所有会话
+ */
+void KCPClientPool::for_each_connection(
+    const std::function<void(KCPConnection *)> &fn) const {
+  for (size_t i = 0; i < connections_.size(); i++) {
+    fn(connections_.at(i));
+  }
+}
+
+/**
+ * 设置KCP配置
+ */
+void KCPClientPool::set_kcp_config(int nodelay, int interval, int resend,
+                                   int nc, int sndwnd, int rcvwnd, int mtu) {
+  kcp_nodelay_ = nodelay;
+  kcp_interval_ = interval;
+  kcp_resend_ = resend;
+  kcp_nc_ = nc;
+  kcp_sndwnd_ = sndwnd;
+  kcp_rcvwnd_ = rcvwnd;
+  kcp_mtu_ = mtu;
+}
+
+/**
+ * 获取统计信息
+ */
+KCPClientPool::Stats KCPClientPool::get_stats() const {
+  Stats stats = stats_;
+  stats.sessions_active = (uint32_t)connections_.size();
+  stats.sessions_connecting = (uint32_t)handshakes_.size();
+  stats.scheduled = (uint32_t)timer_wheel_.size();
+  return stats;
+}
+
+/**
+ * 获取当前时间戳
+ */
+uint32_t KCPClientPool::get_current_ms() {
+  auto now = std::chrono::steady_clock::now();
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      now.time_since_epoch());
+  return static_cast<uint32_t>(ms.count());
+}
+
+/**
+ * 内存分配回调函数
+ */
+void KCPClientPool::alloc_buffer(uv_handle_t *handle, size_t suggested_size,
+                                 uv_buf_t *buf) {
+  KCPClientPool *pool = (KCPClientPool *)handle->data;
+  *buf = uv_buf_init(pool->recv_buffer_, sizeof(pool->recv_buffer_));
+}
+
+/**
+ * UDP接收回调函数
+ */
+void KCPClientPool::on_udp_recv(uv_udp_t *handle, ssize_t nread,
+                                const uv_buf_t *buf,
+                                const struct sockaddr *addr, unsigned flags) {
+  KCPClientPool *pool = (KCPClientPool *)handle->data;
+
+  if (nread < 0) {
+    KCP_LOG_ERROR("[KCPClientPool] UDP接收错误: " << uv_strerror(nread));
+    pool->stats_.recv_errors++;
+    return;
+  }
+
+  if (nread == 0 || !addr) {
+    return;
+  }
+
+  if (flags & UV_UDP_PARTIAL) {
+    KCP_LOG_WARN("[KCPClientPool] UDP数据被截断");
+    pool->stats_.drops_partial++;
+    return;
+  }
+
+  pool->handle_udp_data(buf->base, (int)nread, addr);
+  pool->closed_connections_.clear();
+}
+
+/**
+ * 定时器回调函数
+ */
+void KCPClientPool::on_timer(uv_timer_t *handle) {
+  KCPClientPool *pool = (KCPClientPool *)handle->data;
+  pool->update_connections();
+}
+
+/**
+ * 批量发送回调函数
+ */
+void KCPClientPool::on_flush_check(uv_check_t *handle) {
+  KCPClientPool *pool = (KCPClientPool *)handle->data;
+  pool->send_pool_->flush();
+}
+
+/**
+ * 处理UDP数据：按conv分发到会话
+ */
+void KCPClientPool::handle_udp_data(const char *data, int len,
+                                    const struct sockaddr *addr) {
+  stats_.packets_in++;
+  stats_.bytes_in += len;
+
+  // KCP包、控制包和FEC包的前4字节都是conv
+  if (len < 4) {
+    stats_.drops_short++;
+    return;
+  }
+  uint32_t conv = *(const uint32_t *)data;
+  KCPConnection *conn = connections_.find(conv);
+  if (!conn) {
+    stats_.drops_no_session++;
+    KCP_LOG_DEBUG("[KCPClientPool] 丢弃未知会话的数据，conv=" << conv);
+    return;
+  }
+
+  // 只接受来自该会话服务器地址的数据
+  if (!conn->get_address().equals(addr)) {
+    stats_.drops_bad_addr++;
+    KCP_LOG_DEBUG("[KCPClientPool] 丢弃非服务器地址的数据，conv=" << conv);
+    return;
+  }
+
+  // 更新活跃时间
+  uint32_t current = get_current_ms();
+  conn->update_active_time(current);
+
+  // 控制包（握手、会话令牌、地址验证挑战）不进入KCP
+  if (KCPControl::is_control(data, len)) {
+    handle_control(conn, data, len);
+    return;
+  }
+
+  // 握手期间收到KCP数据说明服务器已创建会话（ACCEPT丢失）
+  if (conn->get_state() == KCPConnection::CONNECTING) {
+    on_handshake_done(conn);
+    if (connections_.find(conv) != conn) {
+      return;
+    }
+  }
+
+  // 将数据输入到KCP并尝试接收
+  conn->input(data, len);
+  conn->recv();
+
+  // 会话可能在回调中被关闭（对象延迟释放，指针仍然有效）
+  if (connections_.find(conv) == conn) {
+    schedule_connection(conn, current);
+  }
+}
+
+/**
+ * 处理控制包
+ */
+void KCPClientPool::handle_control(KCPConnection *conn, const char *data,
+                                   int len) {
+  auto it = handshakes_.find(conn->get_conv());
+  KCPClientHandshake *handshake = it != handshakes_.end() ? &it->second : nullptr;
+  if (KCPClientHandshake::handle_control(conn, handshake, data, len,
+                                         get_current_ms())) {
+    on_handshake_done(conn);
+  }
+}
+
+/**
+ * 握手完成
+ */
+void KCPClientPool::on_handshake_done(KCPConnection *conn) {
+  uint32_t conv = conn->get_conv();
+  handshakes_.erase(conv);
+  uint32_t current = get_current_ms();
+  KCPClientHandshake::complete(conn, current);
+  KCP_LOG_DEBUG("[KCPClientPool] 握手完成，conv=" << conv);
+
+  if (connect_callback_) {
+    connect_callback_(conn, true);
+  }
+  if (connections_.find(conv) == conn) {
+    schedule_connection(conn, current);
+  }
+}
+
+/**
+ * 更新到期的会话
+ */
+void KCPClientPool::update_connections() {
+  uint32_t current = get_current_ms();
+
+  // 推进时间轮，收集截止时间已到的会话
+  expired_convs_.clear();
+  timer_wheel_.advance(current, expired_convs_);
+
+  for (size_t i = 0; i < expired_convs_.size(); i++) {
+    service_connection(expired_convs_[i], current);
+  }
+  closed_connections_.clear();
+}
+
+/**
+ * 处理单个到期会话
+ */
+void KCPClientPool::service_connection(uint32_t conv, uint32_t current) {
+  KCPConnection *conn = connections_.find(conv);
+  if (!conn) {
+    return;
+  }
+
+  // 握手期间不驱动KCP（数据留在发送队列中），只重发HELLO
+  auto it = handshakes_.find(conv);
+  if (it != handshakes_.end()) {
+    if (!it->second.poll(conn, current)) {
+      KCP_LOG_WARN("[KCPClientPool] 握手超时，conv=" << conv);
+      stats_.handshake_failures++;
+      remove_connection(conv);
+      conn->abort();
+      if (connect_callback_) {
+        connect_callback_(conn, false);
+      }
+      return;
+    }
+    schedule_connection(conn, current);
+    return;
+  }
+
+  // 检查会话是否超时
+  if (timeout_ > 0 && conn->is_timeout(current, timeout_)) {
+    KCP_LOG_INFO("[KCPClientPool] 会话超时，conv=" << conv);
+    stats_.sessions_timed_out++;
+    remove_connection(conv);
+    conn->abort();
+    return;
+  }
+
+  // 更新KCP状态并尝试接收数据
+  conn->update(current);
+  conn->recv();
+
+  // 会话可能在回调中被关闭（对象延迟释放，指针仍然有效）
+  if (connections_.find(conv) != conn) {
+    return;
+  }
+  schedule_connection(conn, current);
+}
+
+/**
+ * 将会话加入时间轮
+ */
+void KCPClientPool::schedule_connection(KCPConnection *conn, uint32_t current) {
+  uint32_t conv = conn->get_conv();
+  auto it = handshakes_.find(conv);
+  if (it != handshakes_.end()) {
+    // 握手期间按HELLO重发时间和握手超时时间调度
+    timer_wheel_.schedule(conv, it->second.next_time());
+    return;
+  }
+
+  // is_timeout使用 > timeout 判断，超时截止时间需要再加1ms
+  // 不检测超时时，空闲会话在有新数据（收到或发送）之前不需要处理
+  uint32_t idle_deadline = timeout_ > 0
+                               ? conn->get_active_time() + timeout_ + 1
+                               : current + kIdleInterval;
+  timer_wheel_.schedule(conv, conn->next_update_time(current, idle_deadline));
+}
+
+/**
+ * 移除会话
+ */
+void KCPClientPool::remove_connection(uint32_t conv) {
+  std::unique_ptr<KCPConnection> conn = connections_.remove(conv);
+  if (conn) {
+    KCP_LOG_DEBUG("[KCPClientPool] 移除会话，conv=" << conv);
+    timer_wheel_.cancel(conv);
+    handshakes_.erase(conv);
+    closed_connections_.push_back(std::move(conn));
+    stats_.sessions_closed++;
+  }
+}
+
+/**
+ * 连接关闭回调
+ */
+void KCPClientPool::on_connection_close(KCPConnection *conn) {
+  if (close_callback_) {
+    close_callback_(conn);
+  }
+  remove_connection(conn->get_conv());
+}
@@ -0,0 +1,373 @@
+#include "kcp_compress.h"
+#include "kcp_log.h"
+#include <chrono>
+#include <cstring>
+
+#ifdef KCP_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef KCP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// LZ4的最大匹配距离，流式模式保留的历史长度
+static const size_t kLz4History = 64 * 1024;
+
+// LZ4流式模式的环形缓冲区：两端以相同的规则放置消息（放不下时回到开头），
+// 保证每条消息之前的kLz4History字节历史仍在原位；超过kLz4History的消息不使用历史
+static const size_t kLz4Ring = 2 * kLz4History;
+
+/**
+ * 压缩上下文（流式模式下保留历史）
+ */
+struct KCPCompressor::Context {
+#ifdef KCP_HAVE_LZ4
+  LZ4_stream_t *lz4;                // 压缩端流状态
+  LZ4_streamDecode_t *lz4_decode;   // 解压端流状态
+  std::vector<char> lz4_ring;       // 压缩端环形缓冲区
+  std::vector<char> lz4_decode_ring; // 解压端环形缓冲区
+  size_t lz4_pos;                   // 压缩端下一条消息的位置
+  size_t lz4_decode_pos;            // 解压端下一条消息的位置
+#endif
+#ifdef KCP_HAVE_ZSTD
+  ZSTD_CCtx *cctx;
+  ZSTD_DCtx *dctx;
+#endif
+
+  Context() {
+#ifdef KCP_HAVE_LZ4
+    lz4 = nullptr;
+    lz4_decode = nullptr;
+    lz4_pos = 0;
+    lz4_decode_pos = 0;
+#endif
+#ifdef KCP_HAVE_ZSTD
+    cctx = nullptr;
+    dctx = nullptr;
+#endif
+  }
+
+  ~Context() {
+#ifdef KCP_HAVE_LZ4
+    if (lz4) {
+      LZ4_freeStream(lz4);
+    }
+    if (lz4_decode) {
+      LZ4_freeStreamDecode(lz4_decode);
+    }
+#endif
+#ifdef KCP_HAVE_ZSTD
+    if (cctx) {
+      ZSTD_freeCCtx(cctx);
+    }
+    if (dctx) {
+      ZSTD_freeDCtx(dctx);
+    }
+#endif
+  }
+};
+
+static inline uint64_t now_us() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * 构造函数实现
+ */
+KCPCompressor::KCPCompressor(const Config &config, int contexts)
+    : config_(config) {
+  memset(&stats_, 0, sizeof(stats_));
+  if (config_.algorithm != NONE && !available(config_.algorithm)) {
+    KCP_LOG_WARN("[KCPCompressor] 压缩算法未编译，不压缩，algorithm="
+                 << (int)config_.algorithm);
+    config_.algorithm = NONE;
+  }
+  if (config_.threshold < 1) {
+    config_.threshold = 1;
+  }
+  contexts_.resize(config_.streaming && contexts > 1 ? contexts : 1);
+}
+
+/**
+ * 析构函数实现
+ */
+KCPCompressor::~KCPCompressor() {}
+
+/**
+ * 编译时是否启用了该算法
+ */
+bool KCPCompressor::available(Algorithm algorithm) {
+  switch (algorithm) {
+  case NONE:
+    return true;
+#ifdef KCP_HAVE_LZ4
+  case LZ4:
+    return true;
+#endif
+#ifdef KCP_HAVE_ZSTD
+  case ZSTD:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+/**
+ * 压缩格式可能增加的最大长度
+ */
+size_t KCPCompressor::max_overhead(size_t max_size) {
+  // LZ4/zstd的最坏情况约为 len/255 + 16 / len/256 + 64，再加上头部和流式flush的块头
+  return max_size / 255 + 128;
+}
+
+/**
+ * 获取上下文
+ */
+KCPCompressor::Context &KCPCompressor::context(int index) {
+  if (!config_.streaming || index < 0 || index >= (int)contexts_.size()) {
+    index = 0;
+  }
+  std::unique_ptr<Context> &ctx = contexts_[index];
+  if (ctx) {
+    return *ctx;
+  }
+  ctx.reset(new Context());
+
+#ifdef KCP_HAVE_LZ4
+  if (config_.algorithm == LZ4 && config_.streaming) {
+    ctx->lz4 = LZ4_createStream();
+    ctx->lz4_decode = LZ4_createStreamDecode();
+    ctx->lz4_ring.resize(kLz4Ring);
+    ctx->lz4_decode_ring.resize(kLz4Ring);
+  }
+#endif
+#ifdef KCP_HAVE_ZSTD
+  if (config_.algorithm == ZSTD) {
+    ctx->cctx = ZSTD_createCCtx();
+    ctx->dctx = ZSTD_createDCtx();
+    ZSTD_CCtx_setParameter(ctx->cctx, ZSTD_c_compressionLevel, config_.level);
+    if (config_.streaming) {
+      ZSTD_CCtx_setParameter(ctx->cctx, ZSTD_c_windowLog, config_.window_log);
+    }
+    // 字典在整个上下文的生命周期内有效（ZSTD_compress2只重置会话）
+    if (!config_.dictionary.empty()) {
+      ZSTD_CCtx_loadDictionary(ctx->cctx, config_.dictionary.data(),
+                               config_.dictionary.size());
+      ZSTD_DCtx_loadDictionary(ctx->dctx, config_.dictionary.data(),
+                               config_.dictionary.size());
+    }
+  }
+#endif
+  return *ctx;
+}
+
+/**
+ * 压缩一条消息
+ */
+bool KCPCompressor::compress(int context_index, const char *data, size_t len,
+                             char *header, const char **out,
+                             size_t *out_len) {
+  *header = (char)NONE;
+  *out = nullptr;
+  *out_len = 0;
+  if (config_.algorithm == NONE || len < (size_t)config_.threshold) {
+    return true;
+  }
+
+  uint64_t start = now_us();
+  size_t n = compress_block(context(context_index), data, len);
+  stats_.compress_time_us += now_us() - start;
+
+  // 流式模式下历史已经更新（失败时压缩器的状态也不再可靠），接收端没有收到这条
+  // 消息的压缩数据就无法解压之后的消息，因此不能回退为原始消息
+  if (config_.streaming) {
+    if (n == 0) {
+      return false;
+    }
+  } else if (n == 0 || n + kHeaderSize >= len + 1) {
+    // 非流式模式下压缩失败或没有收益时发送原始消息
+    return true;
+  }
+
+  char *packet = compress_buf_.data();
+  packet[0] = (char)config_.algorithm;
+  for (int i = 0; i < 4; i++) {
+    packet[1 + i] = (char)(len >> (8 * i));
+  }
+  *out = packet;
+  *out_len = n + kHeaderSize;
+  stats_.compressed_messages++;
+  stats_.raw_bytes += len;
+  stats_.compressed_bytes += *out_len;
+  return true;
+}
+
+/**
+ * 压缩到compress_buf_的头部之后
+ */
+size_t KCPCompressor::compress_block(Context &ctx, const char *data,
+                                     size_t len) {
+  (void)ctx;
+  (void)data;
+#ifdef KCP_HAVE_LZ4
+  if (config_.algorithm == LZ4) {
+    int bound = LZ4_compressBound((int)len);
+    if (compress_buf_.size() < (size_t)bound + kHeaderSize) {
+      compress_buf_.resize((size_t)bound + kHeaderSize);
+    }
+    char *dst = compress_buf_.data() + kHeaderSize;
+    int level = config_.level < 1 ? 1 : config_.level;
+    int n;
+    if (ctx.lz4 && len <= kLz4History) {
+      // 原始数据不保证在下一条消息时仍然有效，先复制到环形缓冲区
+      if (ctx.lz4_pos + len > kLz4Ring) {
+        ctx.lz4_pos = 0;
+      }
+      char *src = ctx.lz4_ring.data() + ctx.lz4_pos;
+      memcpy(src, data, len);
+      n = LZ4_compress_fast_continue(ctx.lz4, src, dst, (int)len, bound, level);
+      ctx.lz4_pos += len;
+    } else {
+      n = LZ4_compress_fast(data, dst, (int)len, bound, level);
+    }
+    return n > 0 ? (size_t)n : 0;
+  }
+#endif
+#ifdef KCP_HAVE_ZSTD
+  if (config_.algorithm == ZSTD) {
+    size_t bound = ZSTD_compressBound(len);
+    if (compress_buf_.size() < bound + kHeaderSize) {
+      compress_buf_.resize(bound + kHeaderSize);
+    }
+    if (!config_.streaming) {
+      size_t n = ZSTD_compress2(ctx.cctx, compress_buf_.data() + kHeaderSize,
+                                bound, data, len);
+      return ZSTD_isError(n) ? 0 : n;
+    }
+
+    // 流式：flush到块边界，接收端收到这条消息即可完整解压，帧不结束
+    ZSTD_inBuffer in = {data, len, 0};
+    ZSTD_outBuffer out = {compress_buf_.data() + kHeaderSize, bound, 0};
+    while (true) {
+      size_t remaining = ZSTD_compressStream2(ctx.cctx, &out, &in, ZSTD_e_flush);
+      if (ZSTD_isError(remaining)) {
+        KCP_LOG_ERROR("[KCPCompressor] zstd压缩失败: "
+                      << ZSTD_getErrorName(remaining));
+        return 0;
+      }
+      if (remaining == 0) {
+        return out.pos;
+      }
+      compress_buf_.resize(compress_buf_.size() + remaining + 64);
+      out.dst = compress_buf_.data() + kHeaderSize;
+      out.size = compress_buf_.size() - kHeaderSize;
+    }
+  }
+#endif
+  (void)len;
+  return 0;
+}
+
+/**
+ * 解压一条消息
+ */
+bool KCPCompressor::decompress(int context_index, const char *data, size_t len,
+                               size_t max_size, const char **out,
+                               size_t *out_len) {
+  if (len < 1) {
+    return false;
+  }
+  uint8_t flag = (uint8_t)data[0];
+  if (flag == NONE) {
+    *out = data + 1;
+    *out_len = len - 1;
+    return true;
+  }
+  if (flag != config_.algorithm || len < (size_t)kHeaderSize) {
+    return false;
+  }
+
+  size_t raw_len = 0;
+  for (int i = 3; i >= 0; i--) {
+    raw_len = (raw_len << 8) | (uint8_t)data[1 + i];
+  }
+  if (raw_len > max_size) {
+    return false;
+  }
+
+  uint64_t start = now_us();
+  const char *raw = decompress_block(context(context_index), data + kHeaderSize,
+                                     len - kHeaderSize, raw_len);
+  stats_.decompress_time_us += now_us() - start;
+  if (!raw) {
+    return false;
+  }
+  stats_.decompressed_messages++;
+  *out = raw;
+  *out_len = raw_len;
+  return true;
+}
+
+/**
+ * 解压
+ */
+const char *KCPCompressor::decompress_block(Context &ctx, const char *data,
+                                            size_t len, size_t raw_len) {
+  // 保证空消息时data()也有效
+  if (decompress_buf_.size() < raw_len + 1) {
+    decompress_buf_.resize(raw_len + 1);
+  }
+  char *dst = decompress_buf_.data();
+  (void)ctx;
+  (void)data;
+  (void)len;
+  (void)dst;
+
+#ifdef KCP_HAVE_LZ4
+  if (config_.algorithm == LZ4) {
+    if (!ctx.lz4_decode || raw_len > kLz4History) {
+      int n = LZ4_decompress_safe(data, dst, (int)len, (int)raw_len);
+      return n == (int)raw_len ? dst : nullptr;
+    }
+    // 与压缩端相同的放置规则，直接解压到环形缓冲区
+    if (ctx.lz4_decode_pos + raw_len > kLz4Ring) {
+      ctx.lz4_decode_pos = 0;
+    }
+    char *ring = ctx.lz4_decode_ring.data() + ctx.lz4_decode_pos;
+    int n = LZ4_decompress_safe_continue(ctx.lz4_decode, data, ring, (int)len,
+                                         (int)raw_len);
+    if (n != (int)raw_len) {
+      return nullptr;
+    }
+    ctx.lz4_decode_pos += raw_len;
+    return ring;
+  }
+#endif
+#ifdef KCP_HAVE_ZSTD
+  if (config_.algorithm == ZSTD) {
+    if (!config_.streaming) {
+      size_t n = ZSTD_decompressDCtx(ctx.dctx, dst, raw_len, data, len);
+      return !ZSTD_isError(n) && n == raw_len ? dst : nullptr;
+    }
+    ZSTD_inBuffer in = {data, len, 0};
+    ZSTD_outBuffer out = {dst, raw_len, 0};
+    while (in.pos < in.size) {
+      size_t in_pos = in.pos;
+      size_t out_pos = out.pos;
+      size_t ret = ZSTD_decompressStream(ctx.dctx, &out, &in);
+      if (ZSTD_isError(ret)) {
+        KCP_LOG_ERROR("[KCPCompressor] zstd解压失败: " << ZSTD_getErrorName(ret));
+        return nullptr;
+      }
+      if (in.pos == in_pos && out.pos == out_pos) {
+        break;
+      }
+    }
+    return in.pos == in.size && out.pos == raw_len ? dst : nullptr;
+  }
+#endif
+  return nullptr;
+}
@@ -1,6 +1,17 @@
 #include "kcp_connection.h"
+#include "kcp_allocator.h"
+#include "kcp_log.h"
+#include "kcp_send_pool.h"
+#include <chrono>
 #include <cstring>
-#include <iostream>
+#include <vector>
+
+// 线程内共享的接收缓冲区
+// 同一线程的所有连接复用，按实际消息大小扩容，避免每个连接内嵌64KB数组
+static thread_local std::vector<char> t_recv_buffer;
+
+// 共享接收缓冲区是否正在被回调使用（回调中嵌套recv时使用临时缓冲区）
+static thread_local bool t_recv_buffer_busy = false;
 
 /**
  * 构造函数实现
@@ -8,10 +19,20 @@
  */
 KCPConnection::KCPConnection(uint32_t conv, uv_udp_t *udp_handle,
                              const struct sockaddr *addr)
-    : conv_(conv), udp_handle_(udp_handle), state_(CONNECTING),
-      last_active_time_(0) {
-  // 复制对端地址
-  memcpy(&addr_, addr, sizeof(struct sockaddr_storage));
+    : conv_(conv), udp_handle_(udp_handle), send_pool_(nullptr), addr_(addr),
+      state_(CONNECTING), last_active_time_(0),
+      max_message_size_(kDefaultMaxMessageSize),
+      drain_timeout_(kDefaultDrainTimeout), drain_deadline_(0), pending_head_(0),
+      pending_bytes_(0), pending_messages_(0), high_packets_(0), low_packets_(0), high_bytes_(0),
+      low_bytes_(0), write_blocked_(false), fec_auto_(false), pumping_(false),
+      has_token_(false), token_confirmed_(false), control_time_(0) {
+
+  memset(&counters_, 0, sizeof(counters_));
+  memset(&token_, 0, sizeof(token_));
+
+  // 安装KCP分级内存分配器（进程内只安装一次）
+  // 在创建第一个KCP控制块之前安装，保证所有控制块都由同一个分配器分配和释放
+  KCPSlabAllocator::install();
 
   // 创建KCP控制块
   // conv: 会话ID，必须在通信双方保持一致
@@ -22,7 +43,8 @@ KCPConnection::KCPConnection(uint32_t conv, uv_udp_t *udp_handle,
   // 当KCP需要发送数据时，会调用这个函数
   kcp_->output = udp_output;
 
-  std::cout << "[KCPConnection] 创建连接，conv=" << conv << std::endl;
+  KCP_LOG_INFO("[KCPConnection] 创建连接，conv=" << conv << ", addr="
+               << addr_.to_string());
 }
 
 /**
@@ -36,7 +58,7 @@ KCPConnection::~KCPConnection() {
     ikcp_release(kcp_);
     kcp_ = nullptr;
   }
-  std::cout << "[KCPConnection] 销毁连接，conv=" << conv_ << std::endl;
+  KCP_LOG_INFO("[KCPConnection] 销毁连接，conv=" << conv_);
 }
 
 /**
@@ -60,10 +82,10 @@ void KCPConnection::init_kcp(int nodelay, int interval, int resend, int nc,
   // MSS: 自动计算为 MTU - 24 (KCP协议头)
   ikcp_setmtu(kcp_, mtu);
 
-  std::cout << "[KCPConnection] 初始化KCP参数: "
-            << "nodelay=" << nodelay << ", interval=" << interval
-            << ", resend=" << resend << ", nc=" << nc << ", sndwnd=" << sndwnd
-            << ", rcvwnd=" << rcvwnd << ", mtu=" << mtu << std::endl;
+  KCP_LOG_DEBUG("[KCPConnection] 初始化KCP参数: " << "nodelay=" << nodelay
+                << ", interval=" << interval << ", resend=" << resend
+                << ", nc=" << nc << ", sndwnd=" << sndwnd << ", rcvwnd="
+                << rcvwnd << ", mtu=" << mtu);
 }
 
 /**
@@ -79,7 +101,7 @@ void KCPConnection::set_minrto(int minrto) {
   // 这个值决定了RTO的下限，避免RTO过小导致不必要的重传
   kcp_->rx_minrto = minrto;
 
-  std::cout << "[KCPConnection] 设置最小RTO: " << minrto << "ms" << std::endl;
+  KCP_LOG_DEBUG("[KCPConnection] 设置最小RTO: " << minrto << "ms");
 }
 
 /**
@@ -97,8 +119,7 @@ void KCPConnection::set_fastresend(int fastresend) {
   // 例如：fastresend=2，收到ACK 5,7,8时会重传包6
   kcp_->fastresend = fastresend;
 
-  std::cout << "[KCPConnection] 设置快速重传触发次数: " << fastresend
-            << std::endl;
+  KCP_LOG_DEBUG("[KCPConnection] 设置快速重传触发次数: " << fastresend);
 }
 
 /**
@@ -116,8 +137,7 @@ void KCPConnection::set_stream_mode(int stream) {
   //           数据会被连续发送和接收，没有消息边界的概念
   kcp_->stream = stream;
 
-  std::cout << "[KCPConnection] 设置流模式: "
-            << (stream ? "流模式" : "消息模式") << std::endl;
+  KCP_LOG_DEBUG("[KCPConnection] 设置流模式: " << (stream ? "流模式" : "消息模式"));
 }
 
 /**
@@ -136,7 +156,7 @@ void KCPConnection::set_dead_link(int dead_link) {
   // 设置过大会延迟连接断开的检测时间
   kcp_->dead_link = dead_link;
 
-  std::cout << "[KCPConnection] 设置最大重传次数: " << dead_link << std::endl;
+  KCP_LOG_DEBUG("[KCPConnection] 设置最大重传次数: " << dead_link);
 }
 
 /**
@@ -153,7 +173,11 @@ int KCPConnection::get_waitsnd() const {
   // 1. 流量控制：当waitsnd过大时暂停发送
   // 2. 拥塞检测：判断网络是否拥塞
   // 3. 队列管理：避免内存占用过大
-  return ikcp_waitsnd(kcp_);
+  int waitsnd = ikcp_waitsnd(kcp_);
+  if (mux_) {
+    waitsnd += (int)mux_->queued_chunks((int)kcp_->mss - KCPChannelMux::kHeaderSize);
+  }
+  return waitsnd;
 }
 
 /**
@@ -161,38 +185,608 @@ int KCPConnection::get_waitsnd() const {
  * 将数据发送到KCP发送队列
  */
 int KCPConnection::send(const char *data, int len) {
-  if (!kcp_ || state_ != CONNECTED) {
+  if (len < 0) {
     return -1;
   }
+  int ret = check_sendable((size_t)len);
+  if (ret < 0) {
+    return ret;
+  }
+
+  // 启用压缩或多通道时发送到通道0
+  if (compressor_ || mux_) {
+    uv_buf_t buf = uv_buf_init((char *)data, (unsigned int)len);
+    return compressor_ ? send_compressed(0, &buf, 1, (size_t)len)
+                       : enqueue_channel(0, &buf, 1, (size_t)len);
+  }
 
   // 调用ikcp_send将数据加入发送队列
   // KCP会自动进行分片、编号、加入发送队列
   // 返回值：0表示成功，<0表示失败（如发送队列满）
-  int ret = ikcp_send(kcp_, data, len);
+  ret = ikcp_send(kcp_, data, len);
+  if (ret < 0) {
+    KCP_LOG_ERROR("[KCPConnection] 发送失败，conv=" << conv_ << ", ret=" << ret);
+    return ret;
+  }
+
+  counters_.messages_sent++;
+  counters_.bytes_sent += len;
+  track_pending(len, now_ms(), true);
+
+  KCP_LOG_DEBUG("[KCPConnection] 发送数据（KCP可靠），conv=" << conv_ << ", len="
+                << len);
+
+  // 通知调度器尽快update，将数据发送出去
+  if (schedule_callback_) {
+    schedule_callback_(this);
+  }
+  return 0;
+}
+
+/**
+ * 分散-聚集发送（可靠传输，通过KCP）
+ * 通过ikcp_sendv直接从多个缓冲区分片
+ */
+int KCPConnection::sendv(const uv_buf_t *bufs, int count) {
+  if (count < 0) {
+    return -1;
+  }
+
+  // 转换为ikcp_sendv的参数格式，常见的少量缓冲区使用栈上数组
+  const int kInlineBufs = 16;
+  const char *inline_ptrs[kInlineBufs];
+  int inline_lens[kInlineBufs];
+  std::vector<const char *> heap_ptrs;
+  std::vector<int> heap_lens;
+  const char **ptrs = inline_ptrs;
+  int *lens = inline_lens;
+  if (count > kInlineBufs) {
+    heap_ptrs.resize(count);
+    heap_lens.resize(count);
+    ptrs = heap_ptrs.data();
+    lens = heap_lens.data();
+  }
+
+  size_t total = 0;
+  for (int i = 0; i < count; i++) {
+    ptrs[i] = bufs[i].base;
+    lens[i] = (int)bufs[i].len;
+    total += bufs[i].len;
+  }
+
+  int ret = check_sendable(total);
+  if (ret < 0) {
+    return ret;
+  }
+
+  if (compressor_) {
+    return send_compressed(0, bufs, count, total);
+  }
+  if (mux_) {
+    return enqueue_channel(0, bufs, count, total);
+  }
+
+  ret = ikcp_sendv(kcp_, ptrs, lens, count);
   if (ret < 0) {
-    std::cerr << "[KCPConnection] 发送失败，conv=" << conv_ << ", ret=" << ret
-              << std::endl;
+    KCP_LOG_ERROR("[KCPConnection] 发送失败，conv=" << conv_ << ", ret=" << ret);
     return ret;
   }
 
-  std::cout << "[KCPConnection] 发送数据（KCP可靠），conv=" << conv_
-            << ", len=" << len << std::endl;
+  counters_.messages_sent++;
+  counters_.bytes_sent += total;
+  track_pending((int)total, now_ms(), true);
+
+  KCP_LOG_DEBUG("[KCPConnection] 发送数据（KCP可靠，" << count << "个缓冲区），conv="
+                << conv_ << ", len=" << total);
+
+  // 通知调度器尽快update，将数据发送出去
+  if (schedule_callback_) {
+    schedule_callback_(this);
+  }
   return 0;
 }
 
+/**
+ * 设置通道数量
+ */
+void KCPConnection::set_channels(int count) {
+  if (count <= 0) {
+    mux_.reset();
+    return;
+  }
+  if (count > KCPChannelMux::kMaxChannels) {
+    count = KCPChannelMux::kMaxChannels;
+  }
+  mux_.reset(new KCPChannelMux(count));
+}
+
+/**
+ * 设置消息压缩
+ */
+void KCPConnection::set_compression(const KCPCompressor::Config &config) {
+  if (config.algorithm == KCPCompressor::NONE) {
+    compressor_.reset();
+    return;
+  }
+  // 上下文按需创建，按最大通道数预留，与set_channels的调用顺序无关
+  compressor_.reset(new KCPCompressor(config, KCPChannelMux::kMaxChannels));
+}
+
+/**
+ * 启用或关闭KCP参数自适应调节
+ */
+void KCPConnection::set_adaptive_tuning(bool enable,
+                                        const KCPAdaptiveTuner::Bounds &bounds) {
+  if (!enable) {
+    tuner_.reset();
+    return;
+  }
+  tuner_.reset(new KCPAdaptiveTuner(bounds));
+}
+
+/**
+ * 启用或关闭路径MTU探测
+ */
+void KCPConnection::set_pmtu_discovery(bool enable,
+                                       const KCPPmtuProber::Config &config) {
+  if (!enable || !kcp_) {
+    prober_.reset();
+    return;
+  }
+  prober_.reset(new KCPPmtuProber(config, kcp_->mtu + fec_overhead()));
+  apply_mtu(prober_->mtu());
+}
+
+/**
+ * 启用或关闭FEC
+ */
+void KCPConnection::set_fec(int data_shards, int parity_shards) {
+  if (!kcp_) {
+    return;
+  }
+  // 保持UDP包长（路径MTU）不变，只调整KCP的MTU
+  uint32_t path_mtu = kcp_->mtu + fec_overhead();
+  if (data_shards <= 0 || parity_shards <= 0) {
+    fec_encoder_.reset();
+  } else {
+    fec_encoder_.reset(new KCPFecEncoder(data_shards, parity_shards));
+    KCP_LOG_INFO("[KCPConnection] 启用FEC，conv=" << conv_ << ", data="
+                 << fec_encoder_->data_shards() << ", parity="
+                 << fec_encoder_->parity_shards());
+  }
+  ikcp_setmtu(kcp_, (int)(path_mtu - fec_overhead()));
+}
+
+/**
+ * 处理PMTU控制包
+ */
+bool KCPConnection::on_pmtu_control(const char *data, int len) {
+  uint8_t cmd = KCPControl::get_cmd(data);
+  if (cmd == KCP_CTRL_PMTU_PROBE) {
+    uint32_t id;
+    if (KCPControl::decode_probe(data, len, &id)) {
+      char packet[KCPControl::kMaxPacketSize];
+      int n = KCPControl::encode_probe_ack(packet, conv_, id, len);
+      send_udp_direct(packet, n);
+    }
+    return true;
+  }
+  if (cmd != KCP_CTRL_PMTU_ACK) {
+    return false;
+  }
+
+  uint32_t id;
+  int size;
+  if (prober_ && KCPControl::decode_probe_ack(data, len, &id, &size)) {
+    uint32_t mtu = prober_->on_ack(id, size);
+    if (mtu != 0) {
+      apply_mtu(mtu);
+    }
+  }
+  return true;
+}
+
+/**
+ * 推进路径MTU探测
+ */
+void KCPConnection::poll_pmtu(uint32_t current) {
+  uint32_t id = 0;
+  uint32_t mtu = 0;
+  int size = prober_->poll(current, &id, &mtu);
+  if (mtu != 0) {
+    apply_mtu(mtu);
+  }
+  if (size <= 0) {
+    return;
+  }
+
+  static thread_local std::vector<char> t_probe_buffer;
+  if (t_probe_buffer.size() < (size_t)size) {
+    t_probe_buffer.resize(size);
+  }
+  int n = KCPControl::encode_probe(t_probe_buffer.data(), conv_, id, size);
+  // 超过本机接口MTU的探测发送失败（EMSGSIZE），按超时处理
+  output(t_probe_buffer.data(), n);
+}
+
+/**
+ * 修改KCP的MTU
+ */
+void KCPConnection::apply_mtu(uint32_t mtu) {
+  mtu -= fec_overhead();
+  if (mtu == kcp_->mtu) {
+    return;
+  }
+  KCP_LOG_DEBUG("[KCPConnection] 路径MTU已更新，conv=" << conv_ << ", mtu="
+                << kcp_->mtu << " -> " << mtu);
+  // 已进入发送队列的数据段保持原来的长度，之后的分片按新的mss切分
+  if (ikcp_setmtu(kcp_, (int)mtu) == 0) {
+    counters_.pmtu_updates++;
+  }
+}
+
+/**
+ * 发送数据到指定通道
+ */
+int KCPConnection::send_channel(uint8_t channel, const char *data, int len) {
+  if (len < 0) {
+    return -1;
+  }
+  uv_buf_t buf = uv_buf_init((char *)data, (unsigned int)len);
+  return sendv_channel(channel, &buf, 1);
+}
+
+/**
+ * 分散-聚集发送到指定通道
+ */
+int KCPConnection::sendv_channel(uint8_t channel, const uv_buf_t *bufs,
+                                 int count) {
+  if (count < 0 || !mux_ || channel >= mux_->channels()) {
+    return -1;
+  }
+
+  size_t total = 0;
+  for (int i = 0; i < count; i++) {
+    total += bufs[i].len;
+  }
+  int ret = check_sendable(total);
+  if (ret < 0) {
+    return ret;
+  }
+  if (compressor_) {
+    return send_compressed(channel, bufs, count, total);
+  }
+  return enqueue_channel(channel, bufs, count, total);
+}
+
+/**
+ * 流式发送一条大消息
+ */
+int KCPConnection::send_stream(uint8_t channel, StreamProducer producer) {
+  if (!producer || !mux_ || channel >= mux_->channels()) {
+    return -1;
+  }
+  // 流式消息的长度不受最大消息长度限制
+  int ret = check_sendable(0);
+  if (ret < 0) {
+    return ret;
+  }
+
+  mux_->enqueue_stream(channel, producer, now_ms());
+  counters_.messages_sent++;
+
+  KCP_LOG_DEBUG("[KCPConnection] 开始流式发送（通道" << (int)channel
+                << "），conv=" << conv_);
+
+  pump_channels();
+  if (schedule_callback_) {
+    schedule_callback_(this);
+  }
+  return 0;
+}
+
+/**
+ * 发送前的公共检查
+ */
+int KCPConnection::check_sendable(size_t total) {
+  // 握手期间（CONNECTING）数据只进入发送队列，握手完成后发出
+  if (!kcp_ || (state_ != CONNECTED && state_ != CONNECTING)) {
+    return -1;
+  }
+
+  // 检查消息长度，超过上限时拒绝发送（对端也会拒绝接收）
+  if (total > (size_t)max_message_size_) {
+    KCP_LOG_WARN("[KCPConnection] 消息超过最大长度，conv=" << conv_ << ", len="
+                 << total << ", max=" << max_message_size_);
+    return kErrMessageTooLarge;
+  }
+
+  // 达到高水位时拒绝，由应用层在可写回调中重试
+  if (!is_writable()) {
+    counters_.queue_full++;
+    write_blocked_ = true;
+    return kErrQueueFull;
+  }
+  return 0;
+}
+
+/**
+ * 将消息加入通道队列并尝试分片
+ */
+int KCPConnection::enqueue_channel(uint8_t channel, const uv_buf_t *bufs,
+                                   int count, size_t total) {
+  mux_->enqueue(channel, bufs, count, now_ms());
+  counters_.messages_sent++;
+  counters_.bytes_sent += total;
+
+  KCP_LOG_DEBUG("[KCPConnection] 发送数据（通道" << (int)channel << "），conv="
+                << conv_ << ", len=" << total);
+
+  pump_channels();
+
+  // 通知调度器尽快update，将数据发送出去
+  if (schedule_callback_) {
+    schedule_callback_(this);
+  }
+  return 0;
+}
+
+/**
+ * 压缩消息后发送
+ */
+int KCPConnection::send_compressed(uint8_t channel, const uv_buf_t *bufs,
+                                   int count, size_t total) {
+  // 压缩需要连续的输入，多个缓冲区先合并
+  static thread_local std::vector<char> t_gather_buffer;
+  const char *data = count == 1 ? bufs[0].base : nullptr;
+  if (count != 1) {
+    t_gather_buffer.resize(total + 1);
+    size_t offset = 0;
+    for (int i = 0; i < count; i++) {
+      memcpy(t_gather_buffer.data() + offset, bufs[i].base, bufs[i].len);
+      offset += bufs[i].len;
+    }
+    data = t_gather_buffer.data();
+  }
+
+  char header;
+  const char *packed = nullptr;
+  size_t packed_len = 0;
+  if (!compressor_->compress(channel, data, total, &header, &packed,
+                             &packed_len)) {
+    // 流式压缩的历史已与对端不一致，之后的消息都无法解压，关闭连接
+    KCP_LOG_ERROR("[KCPConnection] 消息压缩失败，关闭连接，conv=" << conv_
+                  << ", len=" << total);
+    abort();
+    return kErrCompressFailed;
+  }
+  uv_buf_t wire[2];
+  int wire_count = 1;
+  if (packed) {
+    wire[0] = uv_buf_init((char *)packed, (unsigned int)packed_len);
+  } else {
+    wire[0] = uv_buf_init(&header, 1);
+    wire[1] = uv_buf_init((char *)data, (unsigned int)total);
+    wire_count = 2;
+    packed_len = total + 1;
+  }
+
+  if (mux_) {
+    return enqueue_channel(channel, wire, wire_count, total);
+  }
+
+  const char *ptrs[2];
+  int lens[2];
+  for (int i = 0; i < wire_count; i++) {
+    ptrs[i] = wire[i].base;
+    lens[i] = (int)wire[i].len;
+  }
+  int ret = ikcp_sendv(kcp_, ptrs, lens, wire_count);
+  if (ret < 0) {
+    KCP_LOG_ERROR("[KCPConnection] 发送失败，conv=" << conv_ << ", ret=" << ret);
+    return ret;
+  }
+
+  counters_.messages_sent++;
+  counters_.bytes_sent += total;
+  track_pending((int)packed_len, now_ms(), true);
+
+  KCP_LOG_DEBUG("[KCPConnection] 发送数据（压缩），conv=" << conv_ << ", len="
+                << total << " -> " << packed_len);
+
+  // 通知调度器尽快update，将数据发送出去
+  if (schedule_callback_) {
+    schedule_callback_(this);
+  }
+  return 0;
+}
+
+/**
+ * 解压收到的消息
+ */
+bool KCPConnection::decompress_message(uint8_t channel, const char *data,
+                                       size_t len, const char **message,
+                                       size_t *size) {
+  if (!compressor_->decompress(channel, data, len, (size_t)max_message_size_,
+                               message, size)) {
+    KCP_LOG_ERROR("[KCPConnection] 消息解压失败，关闭连接，conv=" << conv_
+                  << ", len=" << len);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * 发送窗口还能容纳的分片数
+ */
+uint32_t KCPConnection::channel_room() const {
+  IUINT32 window = kcp_->snd_wnd < kcp_->rmt_wnd ? kcp_->snd_wnd : kcp_->rmt_wnd;
+  if (kcp_->nocwnd == 0 && kcp_->cwnd < window) {
+    window = kcp_->cwnd;
+  }
+  IUINT32 used = kcp_->nsnd_buf + kcp_->nsnd_que;
+  return window > used ? window - used : 0;
+}
+
+/**
+ * 按通道优先级取出分片
+ */
+void KCPConnection::pump_channels() {
+  if (!mux_ || !kcp_ || !mux_->has_pending() || pumping_ ||
+      state_ == DISCONNECTED) {
+    return;
+  }
+  pumping_ = true;
+
+  static thread_local std::vector<char> t_chunk_buffer;
+  if (t_chunk_buffer.size() < kcp_->mss) {
+    t_chunk_buffer.resize(kcp_->mss);
+  }
+
+  // 每个分片不超过mss，只占一个KCP数据段
+  for (uint32_t room = channel_room(); room > 0 && mux_->has_pending(); room--) {
+    int payload = 0;
+    uint8_t flags = 0;
+    uint32_t enqueue_time = 0;
+    int n = mux_->next_chunk(t_chunk_buffer.data(), (int)kcp_->mss, &payload,
+                             &flags, &enqueue_time);
+    if (n <= 0) {
+      break;
+    }
+    // 分片已从通道队列取出，发送失败（分配数据段失败）时无法放回，
+    // 对端会看到残缺的消息，关闭连接
+    int ret = ikcp_send(kcp_, t_chunk_buffer.data(), n);
+    if (ret < 0) {
+      KCP_LOG_ERROR("[KCPConnection] 通道分片发送失败，关闭连接，conv=" << conv_
+                    << ", len=" << n << ", ret=" << ret);
+      pumping_ = false;
+      abort();
+      return;
+    }
+    // 流式消息的字节数在生产时才确定
+    if (flags & KCPChannelMux::FLAG_STREAM) {
+      counters_.bytes_sent += payload;
+    }
+    // 送达延迟从消息入队（含在通道队列中的等待）计到最后一个分片被确认
+    track_pending(payload, enqueue_time,
+                  (flags & KCPChannelMux::FLAG_LAST) != 0);
+  }
+  pumping_ = false;
+}
+
+/**
+ * 处理接收到的通道分片
+ */
+bool KCPConnection::deliver_chunk(const char *data, int len) {
+  uint8_t channel = 0;
+  uint8_t flags = 0;
+  const char *message = nullptr;
+  size_t size = 0;
+  // 压缩格式可能比原始消息略长
+  int limit = max_message_size_;
+  if (compressor_) {
+    limit += (int)KCPCompressor::max_overhead(max_message_size_);
+  }
+  int ret = mux_->on_chunk(data, len, limit, (bool)stream_callback_, &channel,
+                           &flags, &message, &size);
+  if (ret == KCPChannelMux::CHUNK_ERROR) {
+    KCP_LOG_ERROR("[KCPConnection] 通道分片无效，关闭连接，conv=" << conv_
+                  << ", len=" << len);
+    return false;
+  }
+  if (ret == KCPChannelMux::CHUNK_STREAM) {
+    deliver_stream_chunk(channel, flags, message, (int)size);
+    return true;
+  }
+  if (ret != KCPChannelMux::CHUNK_COMPLETE) {
+    return true;
+  }
+  // 流式消息不压缩
+  if (compressor_ && !(flags & KCPChannelMux::FLAG_STREAM) &&
+      !decompress_message(channel, message, size, &message, &size)) {
+    return false;
+  }
+
+  deliver_message(channel, message, size);
+  return true;
+}
+
+/**
+ * 交付重组或解压后的完整消息
+ */
+void KCPConnection::deliver_message(uint8_t channel, const char *message,
+                                    size_t size) {
+  // 按通道回调优先，其次是应用层缓冲区，最后是普通数据回调
+  if (!channel_data_callback_ && buffer_allocator_) {
+    char *app_buffer = buffer_allocator_(this, (int)size);
+    if (!app_buffer) {
+      // 消息已经从KCP接收队列中取出，无法保留
+      KCP_LOG_WARN("[KCPConnection] 应用层缓冲区分配失败，丢弃消息，conv="
+                   << conv_ << ", len=" << size);
+      return;
+    }
+    memcpy(app_buffer, message, size);
+    counters_.messages_received++;
+    counters_.bytes_received += size;
+    if (buffer_data_callback_) {
+      buffer_data_callback_(this, app_buffer, (int)size);
+    }
+    KCP_LOG_DEBUG("[KCPConnection] 接收数据（应用层缓冲区），conv=" << conv_
+                  << ", channel=" << (int)channel << ", len=" << size);
+    return;
+  }
+
+  counters_.messages_received++;
+  counters_.bytes_received += size;
+  if (channel_data_callback_) {
+    channel_data_callback_(this, channel, message, (int)size);
+  } else if (data_callback_) {
+    data_callback_(this, message, (int)size);
+  }
+
+  KCP_LOG_DEBUG("[KCPConnection] 接收数据（通道" << (int)channel << "），conv="
+                << conv_ << ", len=" << size);
+}
+
+/**
+ * 将流式分片按BEGIN、DATA、END/ABORT事件交付
+ */
+void KCPConnection::deliver_stream_chunk(uint8_t channel, uint8_t flags,
+                                         const char *data, int len) {
+  // 回调中可能修改stream_callback_，先复制一份
+  StreamCallback cb = stream_callback_;
+  if (flags & KCPChannelMux::FLAG_FIRST) {
+    cb(this, channel, STREAM_BEGIN, nullptr, 0);
+  }
+  if (len > 0) {
+    counters_.bytes_received += len;
+    cb(this, channel, STREAM_DATA, data, len);
+  }
+  if (flags & KCPChannelMux::FLAG_LAST) {
+    if (flags & KCPChannelMux::FLAG_ABORT) {
+      cb(this, channel, STREAM_ABORT, nullptr, 0);
+    } else {
+      counters_.messages_received++;
+      cb(this, channel, STREAM_END, nullptr, 0);
+    }
+    KCP_LOG_DEBUG("[KCPConnection] 流式接收结束（通道" << (int)channel
+                  << "），conv=" << conv_);
+  }
+}
+
 /**
  * 直接发送UDP数据（不可靠传输）
  * 绕过KCP，直接通过UDP发送数据
  */
 int KCPConnection::send_udp_direct(const char *data, int len) {
-  if (!udp_handle_ || state_ != CONNECTED) {
+  // 握手包在CONNECTING状态下发送
+  if (!udp_handle_ || (state_ != CONNECTED && state_ != CONNECTING)) {
     return -1;
   }
 
   // 检查数据长度，避免IP分片
   if (len > 1472) {
-    std::cerr << "[KCPConnection] UDP直接发送数据过大，len=" << len
-              << " (建议<1472字节)" << std::endl;
+    KCP_LOG_WARN("[KCPConnection] UDP直接发送数据过大，len=" << len << " (建议<1472字节)");
     // 不阻止发送，但给出警告
   }
 
@@ -204,13 +798,13 @@ int KCPConnection::send_udp_direct(const char *data, int len) {
   // - 没有流量控制
   int ret = output(data, len);
   if (ret < 0) {
-    std::cerr << "[KCPConnection] UDP直接发送失败，conv=" << conv_
-              << ", ret=" << ret << std::endl;
+    KCP_LOG_ERROR("[KCPConnection] UDP直接发送失败，conv=" << conv_ << ", ret="
+                  << ret);
     return ret;
   }
 
-  std::cout << "[KCPConnection] UDP直接发送（不可靠），conv=" << conv_
-            << ", len=" << len << std::endl;
+  KCP_LOG_DEBUG("[KCPConnection] UDP直接发送（不可靠），conv=" << conv_ << ", len="
+                << len);
   return 0;
 }
 
@@ -227,16 +821,71 @@ int KCPConnection::input(const char *data, int len) {
   // KCP会解析协议头，处理ACK、重传等逻辑
   // 将数据包加入接收队列或处理确认信息
   // 返回值：0表示成功，<0表示数据格式错误
-  int ret = ikcp_input(kcp_, data, len);
+  counters_.packets_in++;
+  counters_.bytes_in += len;
+
+  int ret = KCPFecDecoder::is_fec(data, len) ? input_fec(data, len)
+                                             : input_kcp(data, len);
   if (ret < 0) {
-    std::cerr << "[KCPConnection] 输入数据失败，conv=" << conv_
-              << ", ret=" << ret << std::endl;
     return ret;
   }
 
+  // ACK/UNA可能推进了snd_una，弹出已被完全确认的消息
+  ack_pending();
+
   return 0;
 }
 
+/**
+ * 处理FEC包
+ */
+int KCPConnection::input_fec(const char *data, int len) {
+  if (!fec_decoder_) {
+    fec_decoder_.reset(new KCPFecDecoder());
+  }
+  // 以数据包中的编码参数为准（提前结束的组，校验包中的data_shards会变小）
+  if (fec_auto_ && !fec_encoder_ && (uint8_t)data[4] == KCP_FEC_DATA) {
+    int data_shards, parity_shards;
+    KCPFecDecoder::get_shards(data, &data_shards, &parity_shards);
+    set_fec(data_shards, parity_shards);
+  }
+
+  const char *packet;
+  int packet_len;
+  if (fec_decoder_->input(data, len, &packet, &packet_len) !=
+      KCPFecDecoder::FEC_OK) {
+    counters_.input_errors++;
+    KCP_LOG_ERROR("[KCPConnection] FEC包格式错误，conv=" << conv_ << ", len="
+                  << len);
+    return -1;
+  }
+
+  int ret = 0;
+  if (packet) {
+    ret = input_kcp(packet, packet_len);
+  }
+  // 恢复出的包与原包在KCP层去重，重复到达不影响正确性
+  for (int i = 0; i < fec_decoder_->recovered_count(); i++) {
+    packet = fec_decoder_->recovered(i, &packet_len);
+    input_kcp(packet, packet_len);
+  }
+  counters_.fec_recovered = fec_decoder_->total_recovered();
+  counters_.fec_unrecovered = fec_decoder_->total_unrecovered();
+  return ret;
+}
+
+/**
+ * 将一个KCP包输入协议栈
+ */
+int KCPConnection::input_kcp(const char *data, int len) {
+  int ret = ikcp_input(kcp_, data, len);
+  if (ret < 0) {
+    counters_.input_errors++;
+    KCP_LOG_ERROR("[KCPConnection] 输入数据失败，conv=" << conv_ << ", ret=" << ret);
+  }
+  return ret;
+}
+
 /**
  * 更新KCP状态
  * 必须定期调用此函数来驱动KCP协议运行
@@ -253,7 +902,53 @@ void KCPConnection::update(uint32_t current) {
   // 2. 快速重传：根据配置进行快速重传
   // 3. 拥塞控制：更新拥塞窗口
   // 4. 发送数据：将发送队列中的数据发送出去
+  // 启用多通道时先按优先级补充即将进入发送窗口的分片
+  pump_channels();
+  // 上次update之后没能凑满的FEC组：本次update结束时提前发送校验包，
+  // 避免低速率或突发末尾的数据包得不到保护（最多延迟一个update间隔）
+  bool fec_open = fec_encoder_ && fec_encoder_->pending() > 0;
+  uint32_t fec_group = fec_open ? fec_encoder_->group() : 0;
   ikcp_update(kcp_, current);
+  if (fec_open && fec_encoder_ && fec_encoder_->group() == fec_group &&
+      fec_encoder_->flush(conv_)) {
+    send_fec_parity();
+  }
+
+  if (prober_ && state_ == CONNECTED) {
+    poll_pmtu(current);
+  }
+
+  // 排空期间使用固定的短间隔，不参与自适应调节
+  if (tuner_ && state_ == CONNECTED && tuner_->sample(kcp_, current)) {
+    KCP_LOG_DEBUG("[KCPConnection] 参数已调整，conv=" << conv_
+                  << ", loss=" << tuner_->loss_ratio() << ", snd_wnd="
+                  << kcp_->snd_wnd << ", interval=" << kcp_->interval
+                  << ", minrto=" << kcp_->rx_minrto << ", fastresend="
+                  << kcp_->fastresend);
+  }
+
+  // 发送队列回落到低水位以下，通知应用层继续发送
+  if (write_blocked_ && state_ == CONNECTED && below_low_watermark()) {
+    write_blocked_ = false;
+    counters_.writable_events++;
+    if (writable_callback_) {
+      writable_callback_(this);
+    }
+  }
+
+  // 排空完成（数据全部被确认）、超时或链路失效（重传次数达到dead_link）时关闭
+  if (state_ == DISCONNECTING) {
+    int waitsnd = get_waitsnd();
+    if (waitsnd == 0) {
+      KCP_LOG_DEBUG("[KCPConnection] 发送队列已排空，conv=" << conv_);
+      finish_close();
+    } else if ((int32_t)(current - drain_deadline_) >= 0 ||
+               kcp_->state == (IUINT32)-1) {
+      KCP_LOG_WARN("[KCPConnection] 排空未完成，放弃未确认的数据，conv=" << conv_
+                   << ", waitsnd=" << waitsnd);
+      finish_close();
+    }
+  }
 }
 
 /**
@@ -271,6 +966,68 @@ uint32_t KCPConnection::check(uint32_t current) {
   return ikcp_check(kcp_, current);
 }
 
+/**
+ * 检查KCP是否空闲
+ * 没有待发送数据、待确认数据、待发送ACK和窗口探测时，update不会产生任何输出
+ */
+bool KCPConnection::is_idle() const {
+  if (!kcp_) {
+    return true;
+  }
+
+  return kcp_->nsnd_que == 0 && kcp_->nsnd_buf == 0 && kcp_->ackcount == 0 &&
+         kcp_->probe == 0 && kcp_->rmt_wnd != 0;
+}
+
+/**
+ * 立即发出发送队列中的数据
+ */
+void KCPConnection::flush() {
+  if (!kcp_ || state_ == CONNECTING) {
+    return;
+  }
+
+  pump_channels();
+  ikcp_flush(kcp_);
+}
+
+/**
+ * 计算下次需要update的时间
+ */
+uint32_t KCPConnection::next_update_time(uint32_t current,
+                                         uint32_t idle_deadline) {
+  // 通道队列中有数据且发送窗口有空间时立即处理（ACK在input中到达）
+  if (mux_ && mux_->has_pending() && channel_room() > 0) {
+    return current;
+  }
+
+  // 等待可写的连接回落到低水位以下时立即处理（ACK在input中到达）
+  if (write_blocked_ && state_ == CONNECTED && below_low_watermark()) {
+    return current;
+  }
+
+  // 排空期间：已排空时立即处理，否则不晚于排空截止时间
+  if (state_ == DISCONNECTING) {
+    if (get_waitsnd() == 0) {
+      return current;
+    }
+    if ((int32_t)(drain_deadline_ - idle_deadline) < 0) {
+      idle_deadline = drain_deadline_;
+    }
+  }
+
+  if (is_idle()) {
+    return idle_deadline;
+  }
+
+  // 取ikcp_check与空闲截止时间中较早的一个
+  uint32_t next = check(current);
+  if ((int32_t)(idle_deadline - next) < 0) {
+    return idle_deadline;
+  }
+  return next;
+}
+
 /**
  * 接收数据
  * 从KCP接收队列读取数据
@@ -282,32 +1039,268 @@ bool KCPConnection::recv() {
 
   bool has_data = false;
 
+  // 回调中嵌套调用recv（如在回调中驱动其他连接）时不能复用正在使用的共享缓冲区
+  std::vector<char> nested_buffer;
+  std::vector<char> &buffer = t_recv_buffer_busy ? nested_buffer : t_recv_buffer;
+  bool owns_shared = !t_recv_buffer_busy;
+  t_recv_buffer_busy = true;
+
   // 循环接收，直到接收队列为空
   while (true) {
+    // 查询下一条完整消息的大小
+    // 返回值：>0表示消息长度，<0表示没有完整的消息
+    int size = ikcp_peeksize(kcp_);
+    if (size < 0) {
+      // 没有更多数据
+      break;
+    }
+
+    // 超过最大消息长度视为协议错误，关闭连接而不是截断
+    // （启用多通道时在重组时检查，这里只检查单个分片）
+    int limit = max_message_size_ + (mux_ ? (int)KCPChannelMux::kHeaderSize : 0);
+    if (compressor_ && !mux_) {
+      limit += (int)KCPCompressor::max_overhead(max_message_size_);
+    }
+    if (size > limit) {
+      KCP_LOG_ERROR("[KCPConnection] 接收消息超过最大长度，关闭连接，conv=" << conv_
+                    << ", size=" << size << ", max=" << max_message_size_);
+      if (owns_shared) {
+        t_recv_buffer_busy = false;
+      }
+      abort();
+      return has_data;
+    }
+
+    // 应用层缓冲区接收：分片直接从数据段复制到应用层缓冲区
+    // （启用多通道或压缩时在重组/解压后由deliver_message复制）
+    if (buffer_allocator_ && !mux_ && !compressor_) {
+      char *app_buffer = buffer_allocator_(this, size);
+      if (!app_buffer) {
+        // 应用层暂不接收，消息保留在接收队列中，下次recv时重试
+        break;
+      }
+
+      int len = ikcp_recv(kcp_, app_buffer, size);
+      if (len < 0) {
+        break;
+      }
+
+      has_data = true;
+      counters_.messages_received++;
+      counters_.bytes_received += len;
+
+      if (buffer_data_callback_) {
+        buffer_data_callback_(this, app_buffer, len);
+      }
+
+      KCP_LOG_DEBUG("[KCPConnection] 接收数据（应用层缓冲区），conv="
+                    << conv_ << ", len=" << len);
+
+      if (state_ == DISCONNECTED) {
+        break;
+      }
+      continue;
+    }
+
+    if (buffer.size() < (size_t)size) {
+      buffer.resize(size);
+    }
+
     // 调用ikcp_recv从接收队列读取数据
-    // recv_buffer_: 接收缓冲区
-    // sizeof(recv_buffer_): 缓冲区大小
+    // buffer: 接收缓冲区（至少为消息大小）
     // 返回值：>0表示接收到的字节数，<0表示没有数据或错误
-    int len = ikcp_recv(kcp_, recv_buffer_, sizeof(recv_buffer_));
+    int len = ikcp_recv(kcp_, buffer.data(), size);
     if (len < 0) {
-      // 没有更多数据
       break;
     }
 
     has_data = true;
 
-    // 调用数据接收回调函数
-    if (data_callback_) {
-      data_callback_(this, recv_buffer_, len);
+    // 多通道：按通道重组，消息完整时交付
+    if (mux_) {
+      if (!deliver_chunk(buffer.data(), len)) {
+        if (owns_shared) {
+          t_recv_buffer_busy = false;
+        }
+        abort();
+        return has_data;
+      }
+      if (state_ == DISCONNECTED) {
+        break;
+      }
+      continue;
+    }
+
+    const char *message = buffer.data();
+    size_t message_len = (size_t)len;
+    if (compressor_ &&
+        !decompress_message(0, buffer.data(), (size_t)len, &message,
+                            &message_len)) {
+      if (owns_shared) {
+        t_recv_buffer_busy = false;
+      }
+      abort();
+      return has_data;
     }
 
-    std::cout << "[KCPConnection] 接收数据，conv=" << conv_ << ", len=" << len
-              << std::endl;
+    // 解压后的消息按通道0交付（未启用压缩时直接调用数据回调）
+    if (compressor_) {
+      deliver_message(0, message, message_len);
+    } else {
+      counters_.messages_received++;
+      counters_.bytes_received += message_len;
+
+      // 调用数据接收回调函数
+      if (data_callback_) {
+        data_callback_(this, message, (int)message_len);
+      }
+
+      KCP_LOG_DEBUG("[KCPConnection] 接收数据，conv=" << conv_ << ", len="
+                    << message_len);
+    }
+
+    // 连接可能在回调中被关闭
+    if (state_ == DISCONNECTED) {
+      break;
+    }
   }
 
+  if (owns_shared) {
+    t_recv_buffer_busy = false;
+  }
   return has_data;
 }
 
+/**
+ * 获取统计信息快照
+ */
+KCPConnection::Stats KCPConnection::get_stats() const {
+  Stats stats = counters_;
+  if (kcp_) {
+    stats.srtt = kcp_->rx_srtt;
+    stats.rttvar = kcp_->rx_rttval;
+    stats.rto = kcp_->rx_rto;
+    stats.cwnd = kcp_->cwnd;
+    stats.snd_wnd = kcp_->snd_wnd;
+    stats.rmt_wnd = kcp_->rmt_wnd;
+    stats.mtu = kcp_->mtu;
+    stats.interval = kcp_->interval;
+    stats.minrto = kcp_->rx_minrto;
+    stats.fastresend = kcp_->fastresend;
+    stats.nsnd_que = kcp_->nsnd_que;
+    stats.nsnd_buf = kcp_->nsnd_buf;
+    stats.nrcv_que = kcp_->nrcv_que;
+    stats.nrcv_buf = kcp_->nrcv_buf;
+    stats.xmit = kcp_->xmit;
+    stats.fast_retransmits = kcp_->fastxmit;
+    stats.window_probes = kcp_->probexmit;
+    stats.dead_links = kcp_->deadxmit;
+  }
+  stats.pending_messages = pending_messages_;
+  stats.pending_bytes = queued_bytes();
+  stats.ack_latency_count = ack_latency_.count();
+  stats.ack_latency_p50 = ack_latency_.percentile(50);
+  stats.ack_latency_p99 = ack_latency_.percentile(99);
+  stats.ack_latency_p999 = ack_latency_.percentile(99.9);
+  stats.ack_latency_max = ack_latency_.max();
+  if (prober_) {
+    stats.pmtu_probes = prober_->probes_sent();
+  }
+  if (compressor_) {
+    const KCPCompressor::Stats &compress = compressor_->get_stats();
+    stats.compressed_messages = compress.compressed_messages;
+    stats.compress_raw_bytes = compress.raw_bytes;
+    stats.compress_bytes = compress.compressed_bytes;
+    stats.compression_ratio =
+        compress.raw_bytes ? (double)compress.compressed_bytes / compress.raw_bytes
+                           : 0;
+    stats.compress_time_us = compress.compress_time_us;
+    stats.decompress_time_us = compress.decompress_time_us;
+  }
+  if (tuner_) {
+    stats.tuner_adjustments = tuner_->adjustments();
+    stats.loss_ratio = tuner_->loss_ratio();
+  }
+  return stats;
+}
+
+/**
+ * 记录一条已提交到KCP的消息
+ */
+void KCPConnection::track_pending(int len, uint32_t enqueue_time, bool last) {
+  // 新消息的分片都在发送队列末尾，序号在进入发送窗口时按顺序分配：
+  // 发送队列中的第k个分片（从0开始）序号为snd_nxt + k
+  PendingMessage message;
+  message.last_sn = kcp_->snd_nxt + kcp_->nsnd_que - 1;
+  message.enqueue_time = enqueue_time;
+  message.len = len;
+  message.last = last;
+
+  pending_bytes_ += len;
+
+  // 流模式下数据可能合并到上一条消息的分片中，序号相同时只保留最新一条（字节数合并）
+  if (pending_.size() > pending_head_ &&
+      pending_.back().last_sn == message.last_sn) {
+    message.len += pending_.back().len;
+    if (pending_.back().last) {
+      pending_messages_--;
+    }
+    pending_.back() = message;
+  } else {
+    pending_.push_back(message);
+  }
+  if (last) {
+    pending_messages_++;
+  }
+}
+
+/**
+ * 弹出已被完全确认的消息并记录送达延迟
+ */
+void KCPConnection::ack_pending() {
+  if (pending_head_ == pending_.size()) {
+    return;
+  }
+
+  uint32_t una = kcp_->snd_una;
+  uint32_t current = 0;
+  while (pending_head_ < pending_.size()) {
+    const PendingMessage &message = pending_[pending_head_];
+    // snd_una之前的序号都已被确认
+    if ((int32_t)(una - message.last_sn) <= 0) {
+      break;
+    }
+    if (message.last) {
+      if (current == 0) {
+        current = now_ms();
+      }
+      ack_latency_.record(current - message.enqueue_time);
+      pending_messages_--;
+    }
+    pending_bytes_ -= message.len;
+    pending_head_++;
+  }
+
+  // 已确认的元素超过一半时压缩，保证均摊O(1)
+  if (pending_head_ == pending_.size()) {
+    pending_.clear();
+    pending_head_ = 0;
+  } else if (pending_head_ > 64 && pending_head_ * 2 > pending_.size()) {
+    pending_.erase(pending_.begin(), pending_.begin() + pending_head_);
+    pending_head_ = 0;
+  }
+}
+
+/**
+ * 获取当前时间戳（毫秒）
+ */
+uint32_t KCPConnection::now_ms() {
+  auto now = std::chrono::steady_clock::now();
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      now.time_since_epoch());
+  return static_cast<uint32_t>(ms.count());
+}
+
 /**
  * 检查连接是否超时
  */
@@ -323,45 +1316,138 @@ bool KCPConnection::is_timeout(uint32_t current, uint32_t timeout) const {
  */
 void KCPConnection::close() {
   if (state_ == DISCONNECTED) {
-    std::cout << "[KCPConnection] 连接已经关闭，conv=" << conv_ << std::endl;
+    KCP_LOG_DEBUG("[KCPConnection] 连接已经关闭，conv=" << conv_);
+    return;
+  }
+  if (state_ == DISCONNECTING) {
+    // 已在排空：按新的排空超时时间提前截止时间（如服务器优雅关闭）
+    uint32_t deadline = now_ms() + drain_timeout_;
+    if ((int32_t)(deadline - drain_deadline_) < 0) {
+      drain_deadline_ = deadline;
+      if (schedule_callback_) {
+        schedule_callback_(this);
+      }
+    }
     return;
   }
 
-  std::cout << "[KCPConnection] 开始关闭连接，conv=" << conv_
-            << ", 当前状态=" << state_ << std::endl;
+  KCP_LOG_DEBUG("[KCPConnection] 开始关闭连接，conv=" << conv_ << ", 当前状态=" << state_);
 
-  // 如果还在连接中或已连接，先进入DISCONNECTING状态
-  if (state_ == CONNECTING || state_ == CONNECTED) {
-    state_ = DISCONNECTING;
-    std::cout << "[KCPConnection] 状态转换: -> DISCONNECTING, conv=" << conv_
-              << std::endl;
+  // 握手未完成的连接、发送队列为空或不排空时立即关闭
+  int waitsnd = get_waitsnd();
+  if (state_ != CONNECTED || waitsnd == 0 || drain_timeout_ == 0) {
+    finish_close();
+    return;
+  }
 
-    // 检查发送队列
-    int waitsnd = get_waitsnd();
-    if (waitsnd > 0) {
-      std::cout << "[KCPConnection] 等待发送队列清空，waitsnd=" << waitsnd
-                << ", conv=" << conv_ << std::endl;
-      // 注意：实际应用中应该在update中检查队列是否清空
-      // 这里演示状态转换逻辑
-      // 在update_connections中应该检查DISCONNECTING状态的连接
-      // 当waitsnd==0时再转为DISCONNECTED
-    } else {
-      std::cout << "[KCPConnection] 发送队列已空，立即断开, conv=" << conv_
-                << std::endl;
-    }
+  // 进入DISCONNECTING状态，由调度器继续update直到发送队列排空
+  state_ = DISCONNECTING;
+  drain_deadline_ = now_ms() + drain_timeout_;
+  KCP_LOG_DEBUG("[KCPConnection] 状态转换: -> DISCONNECTING, waitsnd=" << waitsnd
+                << ", conv=" << conv_);
+
+  // 缩短更新间隔，重传和ACK处理不受较大interval配置的拖累
+  if (kcp_->interval > (IUINT32)kDrainInterval) {
+    // 其余参数传-1表示保持不变
+    ikcp_nodelay(kcp_, -1, kDrainInterval, -1, -1);
   }
 
+  if (schedule_callback_) {
+    schedule_callback_(this);
+  }
+}
+
+/**
+ * 设置发送队列水位
+ */
+void KCPConnection::set_send_watermarks(uint32_t high_packets,
+                                        uint32_t low_packets, size_t high_bytes,
+                                        size_t low_bytes) {
+  high_packets_ = high_packets;
+  low_packets_ = low_packets < high_packets ? low_packets : high_packets;
+  high_bytes_ = high_bytes;
+  low_bytes_ = low_bytes < high_bytes ? low_bytes : high_bytes;
+}
+
+/**
+ * 发送队列是否低于高水位
+ */
+bool KCPConnection::is_writable() const {
+  if (high_packets_ > 0 && (uint32_t)get_waitsnd() >= high_packets_) {
+    return false;
+  }
+  if (high_bytes_ > 0 && queued_bytes() >= high_bytes_) {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * 发送队列是否已回落到低水位以下
+ */
+bool KCPConnection::below_low_watermark() const {
+  if (high_packets_ > 0 && (uint32_t)get_waitsnd() > low_packets_) {
+    return false;
+  }
+  if (high_bytes_ > 0 && queued_bytes() > low_bytes_) {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * 未确认及排队中的消息字节数
+ */
+uint64_t KCPConnection::queued_bytes() const {
+  return pending_bytes_ + (mux_ ? mux_->queued_bytes() : 0);
+}
+
+/**
+ * 立即关闭连接
+ */
+void KCPConnection::abort() {
+  if (state_ == DISCONNECTED) {
+    return;
+  }
+  finish_close();
+}
+
+/**
+ * 转为DISCONNECTED状态并调用关闭回调
+ */
+void KCPConnection::finish_close() {
   // 转为DISCONNECTED状态
   state_ = DISCONNECTED;
-  std::cout << "[KCPConnection] 状态转换: -> DISCONNECTED, conv=" << conv_
-            << std::endl;
+  KCP_LOG_DEBUG("[KCPConnection] 状态转换: -> DISCONNECTED, conv=" << conv_);
 
   // 调用关闭回调
   if (close_callback_) {
     close_callback_(this);
   }
 
-  std::cout << "[KCPConnection] 连接已关闭，conv=" << conv_ << std::endl;
+  KCP_LOG_INFO("[KCPConnection] 连接已关闭，conv=" << conv_);
+}
+
+/**
+ * 设置重传事件回调函数
+ */
+void KCPConnection::set_event_callback(EventCallback cb) {
+  event_callback_ = cb;
+  if (kcp_) {
+    // 只有设置了回调才挂载钩子，避免每次重传都进行空的函数调用
+    kcp_->onevent = event_callback_ ? kcp_event : nullptr;
+  }
+}
+
+/**
+ * KCP事件回调函数（静态）
+ */
+void KCPConnection::kcp_event(int event, uint32_t sn, uint32_t xmit,
+                              uint32_t rto, ikcpcb *kcp, void *user) {
+  KCPConnection *conn = (KCPConnection *)user;
+  if (conn && conn->event_callback_) {
+    conn->event_callback_(conn, (Event)event, sn, xmit, rto);
+  }
 }
 
 /**
@@ -377,10 +1463,41 @@ int KCPConnection::udp_output(const char *buf, int len, ikcpcb *kcp,
     return -1;
   }
 
-  // 调用实际的输出函数
+  // 启用FEC时先编码，再调用实际的输出函数
+  if (conn->fec_encoder_) {
+    return conn->output_fec(buf, len);
+  }
   return conn->output(buf, len);
 }
 
+/**
+ * FEC编码后发送
+ */
+int KCPConnection::output_fec(const char *buf, int len) {
+  static thread_local std::vector<char> t_fec_buffer;
+  if (t_fec_buffer.size() < (size_t)len + KCPFecEncoder::kOverhead) {
+    t_fec_buffer.resize((size_t)len + KCPFecEncoder::kOverhead);
+  }
+  int n = fec_encoder_->encode(conv_, buf, len, t_fec_buffer.data());
+  int ret = output(t_fec_buffer.data(), n);
+  send_fec_parity();
+  return ret;
+}
+
+/**
+ * 发送已生成的校验包
+ */
+void KCPConnection::send_fec_parity() {
+  for (int i = 0; i < fec_encoder_->parity_ready(); i++) {
+    int parity_len;
+    const char *parity = fec_encoder_->parity(i, &parity_len);
+    if (output(parity, parity_len) >= 0) {
+      counters_.fec_parity_sent++;
+    }
+  }
+  fec_encoder_->clear_parity();
+}
+
 /**
  * 实际的UDP数据发送函数
  * 通过libuv的UDP接口发送数据
@@ -390,6 +1507,19 @@ int KCPConnection::output(const char *buf, int len) {
     return -1;
   }
 
+  // 优先使用发送池，复用发送请求和缓冲区
+  // 只统计成功交给发送池或libuv的包
+  if (send_pool_) {
+    int ret = send_pool_->send(udp_handle_, buf, len, get_addr());
+    if (ret < 0) {
+      counters_.send_errors++;
+      return ret;
+    }
+    counters_.packets_out++;
+    counters_.bytes_out += len;
+    return 0;
+  }
+
   // 分配发送请求对象
   // uv_udp_send_t是libuv的异步发送请求结构
   uv_udp_send_t *send_req = new uv_udp_send_t;
@@ -416,8 +1546,8 @@ int KCPConnection::output(const char *buf, int len) {
                           // 发送完成回调
                           // status: 0表示成功，<0表示失败
                           if (status < 0) {
-                            std::cerr << "[KCPConnection] UDP发送失败: "
-                                      << uv_strerror(status) << std::endl;
+                            KCP_LOG_WARN("[KCPConnection] UDP发送失败: "
+                                         << uv_strerror(status));
                           }
 
                           // 释放发送缓冲区
@@ -430,12 +1560,14 @@ int KCPConnection::output(const char *buf, int len) {
 
   if (ret < 0) {
     // 发送失败，立即释放资源
-    std::cerr << "[KCPConnection] uv_udp_send失败: " << uv_strerror(ret)
-              << std::endl;
+    KCP_LOG_ERROR("[KCPConnection] uv_udp_send失败: " << uv_strerror(ret));
     delete[] send_buf;
     delete send_req;
+    counters_.send_errors++;
     return ret;
   }
 
+  counters_.packets_out++;
+  counters_.bytes_out += len;
   return 0;
 }
@@ -0,0 +1,142 @@
+#include "kcp_connection_table.h"
+
+// 初始槽位数量（2的幂）
+static const size_t kInitialSlots = 64;
+
+/**
+ * 构造函数实现
+ */
+KCPConnectionTable::KCPConnectionTable() { rehash(kInitialSlots); }
+
+/**
+ * conv哈希函数
+ * 使用murmur3的finalizer混洗，计算开销极小
+ */
+uint32_t KCPConnectionTable::hash(uint32_t conv) {
+  conv ^= conv >> 16;
+  conv *= 0x85ebca6b;
+  conv ^= conv >> 13;
+  conv *= 0xc2b2ae35;
+  conv ^= conv >> 16;
+  return conv;
+}
+
+/**
+ * 查找conv所在的槽位
+ */
+ptrdiff_t KCPConnectionTable::find_slot(uint32_t conv) const {
+  size_t pos = hash(conv) & mask_;
+  while (true) {
+    const Slot &slot = slots_[pos];
+    if (slot.index < 0) {
+      return -1;
+    }
+    if (slot.conv == conv) {
+      return (ptrdiff_t)pos;
+    }
+    pos = (pos + 1) & mask_;
+  }
+}
+
+/**
+ * 查找连接
+ */
+KCPConnection *KCPConnectionTable::find(uint32_t conv) const {
+  ptrdiff_t pos = find_slot(conv);
+  if (pos < 0) {
+    return nullptr;
+  }
+  return dense_[slots_[pos].index].get();
+}
+
+/**
+ * 插入连接
+ */
+KCPConnection *KCPConnectionTable::insert(std::unique_ptr<KCPConnection> conn) {
+  // 保持负载因子不超过50%，线性探测的查找长度保持很短
+  if ((dense_.size() + 1) * 2 > slots_.size()) {
+    rehash(slots_.size() * 2);
+  }
+
+  uint32_t conv = conn->get_conv();
+  size_t pos = hash(conv) & mask_;
+  while (slots_[pos].index >= 0) {
+    pos = (pos + 1) & mask_;
+  }
+
+  slots_[pos].conv = conv;
+  slots_[pos].index = (int32_t)dense_.size();
+  dense_convs_.push_back(conv);
+  dense_.push_back(std::move(conn));
+  return dense_.back().get();
+}
+
+/**
+ * 移除连接
+ * 索引数组使用向后移动删除（不使用墓碑），稠密数组使用与末尾交换删除
+ */
+std::unique_ptr<KCPConnection> KCPConnectionTable::remove(uint32_t conv) {
+  ptrdiff_t found = find_slot(conv);
+  if (found < 0) {
+    return std::unique_ptr<KCPConnection>();
+  }
+
+  size_t pos = (size_t)found;
+  int32_t index = slots_[pos].index;
+
+  // 从稠密数组中取出连接，把最后一个连接移动到空出的位置
+  std::unique_ptr<KCPConnection> conn = std::move(dense_[index]);
+  size_t last = dense_.size() - 1;
+  if ((size_t)index != last) {
+    dense_[index] = std::move(dense_[last]);
+    dense_convs_[index] = dense_convs_[last];
+    slots_[find_slot(dense_convs_[index])].index = index;
+  }
+  dense_.pop_back();
+  dense_convs_.pop_back();
+
+  // 向后移动删除：把探测链上后续的槽位前移，保持链的连续性
+  size_t hole = pos;
+  size_t next = (pos + 1) & mask_;
+  while (slots_[next].index >= 0) {
+    size_t home = hash(slots_[next].conv) & mask_;
+    // 如果next的理想位置不在(hole, next]区间内，则可以前移到hole
+    bool movable = (hole <= next) ? (home <= hole || home > next)
+                                  : (home <= hole && home > next);
+    if (movable) {
+      slots_[hole] = slots_[next];
+      hole = next;
+    }
+    next = (next + 1) & mask_;
+  }
+  slots_[hole].index = -1;
+
+  return conn;
+}
+
+/**
+ * 清空所有连接
+ */
+void KCPConnectionTable::clear() {
+  dense_.clear();
+  dense_convs_.clear();
+  rehash(kInitialSlots);
+}
+
+/**
+ * 扩容索引数组并重建索引
+ */
+void KCPConnectionTable::rehash(size_t capacity) {
+  Slot empty = {0, -1};
+  slots_.assign(capacity, empty);
+  mask_ = capacity - 1;
+
+  for (size_t i = 0; i < dense_convs_.size(); i++) {
+    size_t pos = hash(dense_convs_[i]) & mask_;
+    while (slots_[pos].index >= 0) {
+      pos = (pos + 1) & mask_;
+    }
+    slots_[pos].conv = dense_convs_[i];
+    slots_[pos].index = (int32_t)i;
+  }
+}
@@ -0,0 +1,291 @@
+#include "kcp_control.h"
+#include <cstring>
+#include <random>
+
+/**
+ * 小端编码/解码
+ */
+static inline void put32(char *p, uint32_t v) {
+  for (int i = 0; i < 4; i++) {
+    p[i] = (char)(v >> (8 * i));
+  }
+}
+
+static inline void put64(char *p, uint64_t v) {
+  for (int i = 0; i < 8; i++) {
+    p[i] = (char)(v >> (8 * i));
+  }
+}
+
+static inline uint32_t get32(const char *p) {
+  uint32_t v = 0;
+  for (int i = 3; i >= 0; i--) {
+    v = (v << 8) | (uint8_t)p[i];
+  }
+  return v;
+}
+
+static inline uint64_t get64(const char *p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) {
+    v = (v << 8) | (uint8_t)p[i];
+  }
+  return v;
+}
+
+/**
+ * 计算RESPONSE的mac：SipHash(令牌, conv + nonce)
+ */
+static uint64_t response_mac(const KCPSessionToken &token, uint32_t conv,
+                             uint64_t nonce) {
+  char input[12];
+  put32(input, conv);
+  put64(input + 4, nonce);
+  return KCPControl::siphash(token.bytes, input, sizeof(input));
+}
+
+/**
+ * 编码TOKEN包
+ */
+int KCPControl::encode_token(char *out, uint32_t conv,
+                             const KCPSessionToken &token) {
+  put32(out, conv);
+  out[4] = (char)KCP_CTRL_TOKEN;
+  memcpy(out + 5, token.bytes, sizeof(token.bytes));
+  return 5 + (int)sizeof(token.bytes);
+}
+
+/**
+ * 解码TOKEN包
+ */
+bool KCPControl::decode_token(const char *data, int len,
+                              KCPSessionToken *token) {
+  if (len < 5 + (int)sizeof(token->bytes)) {
+    return false;
+  }
+  memcpy(token->bytes, data + 5, sizeof(token->bytes));
+  return true;
+}
+
+/**
+ * 编码只有命令字的控制包
+ */
+int KCPControl::encode_simple(char *out, uint32_t conv, uint8_t cmd) {
+  put32(out, conv);
+  out[4] = (char)cmd;
+  return 5;
+}
+
+/**
+ * 编码HELLO包
+ */
+int KCPControl::encode_hello(char *out, uint32_t conv, const uint64_t *cookie) {
+  memset(out, 0, kHelloSize);
+  put32(out, conv);
+  out[4] = (char)KCP_CTRL_HELLO;
+  if (cookie) {
+    out[5] = 1;
+    put64(out + 6, *cookie);
+  }
+  return kHelloSize;
+}
+
+/**
+ * 解码HELLO包
+ */
+bool KCPControl::decode_hello(const char *data, int len, bool *has_cookie,
+                              uint64_t *cookie) {
+  if (len < kHelloSize) {
+    return false;
+  }
+  *has_cookie = data[5] != 0;
+  *cookie = get64(data + 6);
+  return true;
+}
+
+/**
+ * 编码携带一个64位值的控制包
+ */
+int KCPControl::encode_value(char *out, uint32_t conv, uint8_t cmd,
+                             uint64_t value) {
+  put32(out, conv);
+  out[4] = (char)cmd;
+  put64(out + 5, value);
+  return 13;
+}
+
+/**
+ * 解码携带一个64位值的控制包
+ */
+bool KCPControl::decode_value(const char *data, int len, uint64_t *value) {
+  if (len < 13) {
+    return false;
+  }
+  *value = get64(data + 5);
+  return true;
+}
+
+/**
+ * 编码CHALLENGE包
+ */
+int KCPControl::encode_challenge(char *out, uint32_t conv, uint64_t nonce) {
+  return encode_value(out, conv, KCP_CTRL_CHALLENGE, nonce);
+}
+
+/**
+ * 解码CHALLENGE包
+ */
+bool KCPControl::decode_challenge(const char *data, int len, uint64_t *nonce) {
+  return decode_value(data, len, nonce);
+}
+
+/**
+ * 编码RESPONSE包
+ */
+int KCPControl::encode_response(char *out, uint32_t conv, uint64_t nonce,
+                                const KCPSessionToken &token) {
+  put32(out, conv);
+  out[4] = (char)KCP_CTRL_RESPONSE;
+  put64(out + 5, nonce);
+  put64(out + 13, response_mac(token, conv, nonce));
+  return 21;
+}
+
+/**
+ * 解码并校验RESPONSE包
+ */
+bool KCPControl::verify_response(const char *data, int len,
+                                 const KCPSessionToken &token,
+                                 uint64_t *nonce) {
+  if (len < 21) {
+    return false;
+  }
+  *nonce = get64(data + 5);
+  return get64(data + 13) == response_mac(token, get32(data), *nonce);
+}
+
+/**
+ * 编码PMTU_PROBE包
+ */
+int KCPControl::encode_probe(char *out, uint32_t conv, uint32_t id, int size) {
+  if (size < kProbeMinSize) {
+    size = kProbeMinSize;
+  }
+  put32(out, conv);
+  out[4] = (char)KCP_CTRL_PMTU_PROBE;
+  put32(out + 5, id);
+  memset(out + kProbeMinSize, 0, (size_t)(size - kProbeMinSize));
+  return size;
+}
+
+/**
+ * 解码PMTU_PROBE包
+ */
+bool KCPControl::decode_probe(const char *data, int len, uint32_t *id) {
+  if (len < kProbeMinSize) {
+    return false;
+  }
+  *id = get32(data + 5);
+  return true;
+}
+
+/**
+ * 编码PMTU_ACK包
+ */
+int KCPControl::encode_probe_ack(char *out, uint32_t conv, uint32_t id,
+                                 int size) {
+  put32(out, conv);
+  out[4] = (char)KCP_CTRL_PMTU_ACK;
+  put32(out + 5, id);
+  out[9] = (char)(size & 0xFF);
+  out[10] = (char)((size >> 8) & 0xFF);
+  return kProbeAckSize;
+}
+
+/**
+ * 解码PMTU_ACK包
+ */
+bool KCPControl::decode_probe_ack(const char *data, int len, uint32_t *id,
+                                  int *size) {
+  if (len < 11) {
+    return false;
+  }
+  *id = get32(data + 5);
+  *size = (uint8_t)data[9] | ((uint8_t)data[10] << 8);
+  return true;
+}
+
+/**
+ * SipHash-2-4
+ * 参考实现：https://github.com/veorq/SipHash
+ */
+#define SIP_ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+#define SIP_ROUND                                                              \
+  do {                                                                         \
+    v0 += v1;                                                                  \
+    v1 = SIP_ROTL(v1, 13);                                                     \
+    v1 ^= v0;                                                                  \
+    v0 = SIP_ROTL(v0, 32);                                                     \
+    v2 += v3;                                                                  \
+    v3 = SIP_ROTL(v3, 16);                                                     \
+    v3 ^= v2;                                                                  \
+    v0 += v3;                                                                  \
+    v3 = SIP_ROTL(v3, 21);                                                     \
+    v3 ^= v0;                                                                  \
+    v2 += v1;                                                                  \
+    v1 = SIP_ROTL(v1, 17);                                                     \
+    v1 ^= v2;                                                                  \
+    v2 = SIP_ROTL(v2, 32);                                                     \
+  } while (0)
+
+uint64_t KCPControl::siphash(const uint8_t key[16], const void *data,
+                             size_t len) {
+  const char *in = (const char *)data;
+  uint64_t k0 = get64((const char *)key);
+  uint64_t k1 = get64((const char *)key + 8);
+  uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+  uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+  uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+  uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+  size_t blocks = len / 8;
+  for (size_t i = 0; i < blocks; i++) {
+    uint64_t m = get64(in + i * 8);
+    v3 ^= m;
+    SIP_ROUND;
+    SIP_ROUND;
+    v0 ^= m;
+  }
+
+  // 最后不足8字节的部分与长度一起组成最后一个块
+  uint64_t b = ((uint64_t)len) << 56;
+  const char *tail = in + blocks * 8;
+  for (size_t i = 0; i < (len & 7); i++) {
+    b |= ((uint64_t)(uint8_t)tail[i]) << (8 * i);
+  }
+  v3 ^= b;
+  SIP_ROUND;
+  SIP_ROUND;
+  v0 ^= b;
+
+  v2 ^= 0xff;
+  SIP_ROUND;
+  SIP_ROUND;
+  SIP_ROUND;
+  SIP_ROUND;
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#undef SIP_ROUND
+#undef SIP_ROTL
+
+/**
+ * 生成128位随机密钥
+ */
+void KCPControl::random_key(uint8_t key[16]) {
+  std::random_device device;
+  for (int i = 0; i < 16; i += 4) {
+    uint32_t value = device();
+    memcpy(key + i, &value, 4);
+  }
+}
@@ -0,0 +1,395 @@
+#include "kcp_fec.h"
+#include <cstring>
+
+/**
+ * GF(2^8)运算表（本原多项式 x^8 + x^4 + x^3 + x^2 + 1，生成元2）
+ */
+struct GFTables {
+  uint8_t exp[512];
+  uint8_t log[256];
+
+  GFTables() {
+    int x = 1;
+    for (int i = 0; i < 255; i++) {
+      exp[i] = (uint8_t)x;
+      log[x] = (uint8_t)i;
+      x <<= 1;
+      if (x & 0x100) {
+        x ^= 0x11D;
+      }
+    }
+    for (int i = 255; i < 512; i++) {
+      exp[i] = exp[i - 255];
+    }
+    log[0] = 0;
+  }
+};
+
+static const GFTables &gf() {
+  static const GFTables tables;
+  return tables;
+}
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+  if (a == 0 || b == 0) {
+    return 0;
+  }
+  const GFTables &t = gf();
+  return t.exp[t.log[a] + t.log[b]];
+}
+
+static inline uint8_t gf_inv(uint8_t a) {
+  const GFTables &t = gf();
+  return t.exp[255 - t.log[a]];
+}
+
+/**
+ * dst ^= c * src（逐字节）
+ */
+static void gf_mul_add(uint8_t *dst, const uint8_t *src, uint8_t c, size_t n) {
+  if (c == 0) {
+    return;
+  }
+  if (c == 1) {
+    for (size_t i = 0; i < n; i++) {
+      dst[i] ^= src[i];
+    }
+    return;
+  }
+  // 先生成c的乘法表，每字节一次查表
+  uint8_t row[256];
+  for (int x = 0; x < 256; x++) {
+    row[x] = gf_mul(c, (uint8_t)x);
+  }
+  for (size_t i = 0; i < n; i++) {
+    dst[i] ^= row[src[i]];
+  }
+}
+
+/**
+ * Cauchy矩阵元素：第i个校验包中第j个数据包的系数 1 / ((kMaxShards + i) xor j)
+ * 系数与组内数据包数量无关，提前结束的组（k个数据包）取前k列，
+ * 编码矩阵 [I; C] 的任意k行构成的方阵都可逆
+ */
+static inline uint8_t cauchy(int i, int j) {
+  return gf_inv((uint8_t)((KCPFecEncoder::kMaxShards + i) ^ j));
+}
+
+/**
+ * 写入FEC包头
+ */
+static void put_header(uint8_t *out, uint32_t conv, uint8_t type,
+                       int data_shards, int parity_shards, uint32_t group,
+                       int index) {
+  for (int i = 0; i < 4; i++) {
+    out[i] = (uint8_t)(conv >> (8 * i));
+  }
+  out[4] = type;
+  out[5] = (uint8_t)((data_shards << 4) | parity_shards);
+  out[6] = (uint8_t)group;
+  out[7] = (uint8_t)(group >> 8);
+  out[8] = (uint8_t)(group >> 16);
+  out[9] = (uint8_t)index;
+}
+
+static int clamp_shards(int n) {
+  return n < 1 ? 1 : (n > KCPFecEncoder::kMaxShards ? KCPFecEncoder::kMaxShards : n);
+}
+
+/**
+ * 编码器构造函数实现
+ */
+KCPFecEncoder::KCPFecEncoder(int data_shards, int parity_shards)
+    : data_shards_(clamp_shards(data_shards)),
+      parity_shards_(clamp_shards(parity_shards)), group_(0), index_(0),
+      shard_len_(0), parity_ready_(false), parity_(parity_shards_) {}
+
+/**
+ * 编码一个KCP输出包
+ */
+int KCPFecEncoder::encode(uint32_t conv, const char *packet, int len,
+                          char *out) {
+  uint8_t *shard = (uint8_t *)out + kHeaderSize;
+  put_header((uint8_t *)out, conv, KCP_FEC_DATA, data_shards_, parity_shards_,
+             group_, index_);
+  shard[0] = (uint8_t)len;
+  shard[1] = (uint8_t)(len >> 8);
+  memcpy(shard + 2, packet, len);
+  size_t shard_len = (size_t)len + 2;
+
+  // 新的一组：清空校验数据
+  if (index_ == 0) {
+    shard_len_ = 0;
+    for (int i = 0; i < parity_shards_; i++) {
+      parity_[i].resize(kHeaderSize);
+    }
+  }
+  if (shard_len > shard_len_) {
+    shard_len_ = shard_len;
+    for (int i = 0; i < parity_shards_; i++) {
+      parity_[i].resize(kHeaderSize + shard_len_, 0);
+    }
+  }
+
+  // 逐包累加到校验数据，不保存数据包
+  for (int i = 0; i < parity_shards_; i++) {
+    gf_mul_add(parity_[i].data() + kHeaderSize, shard,
+               cauchy(i, index_), shard_len);
+  }
+
+  index_++;
+  if (index_ == data_shards_) {
+    finish_group(conv);
+  }
+  return (int)shard_len + kHeaderSize;
+}
+
+/**
+ * 提前结束当前未满的组
+ */
+bool KCPFecEncoder::flush(uint32_t conv) {
+  if (index_ == 0 || parity_ready_) {
+    return false;
+  }
+  finish_group(conv);
+  return true;
+}
+
+/**
+ * 结束当前组
+ */
+void KCPFecEncoder::finish_group(uint32_t conv) {
+  for (int i = 0; i < parity_shards_; i++) {
+    put_header(parity_[i].data(), conv, KCP_FEC_PARITY, index_, parity_shards_,
+               group_, index_ + i);
+  }
+  parity_ready_ = true;
+  group_ = (group_ + 1) & 0xFFFFFF;
+  index_ = 0;
+}
+
+/**
+ * 获取第i个校验包
+ */
+const char *KCPFecEncoder::parity(int i, int *len) const {
+  *len = (int)parity_[i].size();
+  return (const char *)parity_[i].data();
+}
+
+/**
+ * 校验包已发送
+ */
+void KCPFecEncoder::clear_parity() { parity_ready_ = false; }
+
+/**
+ * 解码器构造函数实现
+ */
+KCPFecDecoder::KCPFecDecoder() : total_recovered_(0), total_unrecovered_(0) {
+  for (int i = 0; i < kGroupWindow; i++) {
+    groups_[i].used = false;
+    groups_[i].done = false;
+  }
+}
+
+/**
+ * 处理一个FEC包
+ */
+int KCPFecDecoder::input(const char *packet, int len, const char **data,
+                         int *data_len) {
+  recovered_.clear();
+  *data = nullptr;
+  *data_len = 0;
+  if (!is_fec(packet, len)) {
+    return FEC_INVALID;
+  }
+
+  int data_shards, parity_shards;
+  get_shards(packet, &data_shards, &parity_shards);
+  const uint8_t *header = (const uint8_t *)packet;
+  uint32_t group = header[6] | (header[7] << 8) | ((uint32_t)header[8] << 16);
+  int index = header[9];
+  bool is_data = header[4] == KCP_FEC_DATA;
+  if (data_shards < 1 || parity_shards < 1 ||
+      index >= data_shards + parity_shards ||
+      is_data != (index < data_shards)) {
+    return FEC_INVALID;
+  }
+
+  const uint8_t *body = header + KCPFecEncoder::kHeaderSize;
+  size_t body_len = (size_t)(len - KCPFecEncoder::kHeaderSize);
+  if (is_data) {
+    if (body_len < 2) {
+      return FEC_INVALID;
+    }
+    size_t size = body[0] | (body[1] << 8);
+    if (size > body_len - 2) {
+      return FEC_INVALID;
+    }
+    // 数据包直接交付，同时保留一份用于恢复同组的其他数据包
+    *data = (const char *)body + 2;
+    *data_len = (int)size;
+  }
+
+  Group &g = groups_[group % kGroupWindow];
+  if (!g.used || g.group != group) {
+    // 比当前槽位更早的组已经过时（24位序号比较）
+    uint32_t diff = (group - g.group) & 0xFFFFFF;
+    if (g.used && (diff == 0 || diff >= 0x800000)) {
+      return FEC_OK;
+    }
+    reset_group(g, group, data_shards, parity_shards);
+  }
+  if (g.done || g.parity_shards != parity_shards) {
+    return FEC_OK;
+  }
+  if (g.data_shards != data_shards) {
+    // 提前结束的组：校验包带有实际的数据包数量k，数据包带有配置值；
+    // 按第一个校验包把组缩短为k个数据包（之前只能收到序号小于k的数据包）
+    if (is_data) {
+      if (index >= g.data_shards) {
+        return FEC_OK;
+      }
+    } else {
+      if (data_shards > g.data_shards || (g.present >> data_shards) != 0) {
+        return FEC_OK;
+      }
+      g.data_shards = data_shards;
+      g.shards.resize(data_shards + parity_shards);
+      for (int k = data_shards; k < data_shards + parity_shards; k++) {
+        g.shards[k].clear();
+      }
+    }
+  }
+  if (g.present & (1u << index)) {
+    return FEC_OK;
+  }
+
+  g.shards[index].assign(body, body + body_len);
+  if (body_len > g.max_len) {
+    g.max_len = body_len;
+  }
+  g.present |= 1u << index;
+  g.received++;
+
+  uint32_t data_mask = (1u << g.data_shards) - 1;
+  if ((g.present & data_mask) == data_mask) {
+    g.done = true;
+  } else if (g.received >= g.data_shards) {
+    recover(g);
+    g.done = true;
+  }
+  return FEC_OK;
+}
+
+/**
+ * 获取恢复出的第i个KCP包
+ */
+const char *KCPFecDecoder::recovered(int i, int *len) const {
+  *len = recovered_[i].second;
+  return (const char *)recovered_[i].first;
+}
+
+/**
+ * 重置组
+ */
+void KCPFecDecoder::reset_group(Group &g, uint32_t group, int data_shards,
+                                int parity_shards) {
+  if (g.used && !g.done) {
+    total_unrecovered_++;
+  }
+  g.used = true;
+  g.done = false;
+  g.group = group;
+  g.data_shards = data_shards;
+  g.parity_shards = parity_shards;
+  g.present = 0;
+  g.received = 0;
+  g.max_len = 0;
+  g.shards.resize(data_shards + parity_shards);
+  for (size_t i = 0; i < g.shards.size(); i++) {
+    g.shards[i].clear();
+  }
+}
+
+/**
+ * 用收到的分片恢复丢失的数据包
+ */
+void KCPFecDecoder::recover(Group &g) {
+  int n = g.data_shards;
+  size_t len = g.max_len;
+
+  // 选取n个收到的分片（数据包优先），短分片以0填充到组内最长
+  int rows[KCPFecEncoder::kMaxShards];
+  int count = 0;
+  for (int k = 0; k < n + g.parity_shards && count < n; k++) {
+    if (g.present & (1u << k)) {
+      g.shards[k].resize(len, 0);
+      rows[count++] = k;
+    }
+  }
+
+  // 构造这n个分片对应的编码矩阵行，求逆
+  uint8_t m[KCPFecEncoder::kMaxShards][KCPFecEncoder::kMaxShards];
+  uint8_t inv[KCPFecEncoder::kMaxShards][KCPFecEncoder::kMaxShards];
+  for (int r = 0; r < n; r++) {
+    for (int c = 0; c < n; c++) {
+      if (rows[r] < n) {
+        m[r][c] = rows[r] == c ? 1 : 0;
+      } else {
+        m[r][c] = cauchy(rows[r] - n, c);
+      }
+      inv[r][c] = r == c ? 1 : 0;
+    }
+  }
+  for (int col = 0; col < n; col++) {
+    int pivot = col;
+    while (pivot < n && m[pivot][col] == 0) {
+      pivot++;
+    }
+    if (pivot == n) {
+      return;
+    }
+    if (pivot != col) {
+      for (int c = 0; c < n; c++) {
+        uint8_t t = m[col][c];
+        m[col][c] = m[pivot][c];
+        m[pivot][c] = t;
+        t = inv[col][c];
+        inv[col][c] = inv[pivot][c];
+        inv[pivot][c] = t;
+      }
+    }
+    uint8_t scale = gf_inv(m[col][col]);
+    for (int c = 0; c < n; c++) {
+      m[col][c] = gf_mul(m[col][c], scale);
+      inv[col][c] = gf_mul(inv[col][c], scale);
+    }
+    for (int r = 0; r < n; r++) {
+      uint8_t factor = m[r][col];
+      if (r == col || factor == 0) {
+        continue;
+      }
+      for (int c = 0; c < n; c++) {
+        m[r][c] ^= gf_mul(factor, m[col][c]);
+        inv[r][c] ^= gf_mul(factor, inv[col][c]);
+      }
+    }
+  }
+
+  // 丢失的数据包j = 逆矩阵第j行与所选分片的线性组合
+  for (int j = 0; j < n; j++) {
+    if (g.present & (1u << j)) {
+      continue;
+    }
+    std::vector<uint8_t> &out = g.shards[j];
+    out.assign(len, 0);
+    for (int r = 0; r < n; r++) {
+      gf_mul_add(out.data(), g.shards[rows[r]].data(), inv[j][r], len);
+    }
+    size_t size = out[0] | (out[1] << 8);
+    if (len >= 2 && size <= len - 2) {
+      recovered_.push_back(std::make_pair(out.data() + 2, (int)size));
+      total_recovered_++;
+    }
+  }
+}
@@ -0,0 +1,134 @@
+#include "kcp_histogram.h"
+
+// 每个2的幂区间的子桶位数（16个子桶）
+static const int kSubBits = 4;
+static const uint32_t kSubCount = 1u << kSubBits;
+
+// 最大记录值的位数（2^24-1，作为毫秒约4.6小时）
+static const int kMaxBits = 24;
+static const uint32_t kMaxValue = (1u << kMaxBits) - 1;
+
+// 桶数量：[0, 16)逐一对应，之后每个2的幂区间16个桶
+static const size_t kBucketCount = kSubCount + (kMaxBits - kSubBits) * kSubCount;
+
+/**
+ * 构造函数实现
+ */
+KCPHistogram::KCPHistogram() : count_(0), sum_(0), min_(0), max_(0) {}
+
+/**
+ * 计算值所在的桶下标
+ */
+size_t KCPHistogram::bucket_of(uint32_t value) {
+  if (value < kSubCount) {
+    return value;
+  }
+
+  // 最高位位置m（>= kSubBits），取最高位之后的kSubBits位作为子桶
+  int m = 31 - __builtin_clz(value);
+  uint32_t sub = (value >> (m - kSubBits)) & (kSubCount - 1);
+  return kSubCount + (size_t)(m - kSubBits) * kSubCount + sub;
+}
+
+/**
+ * 计算桶的上界
+ */
+uint32_t KCPHistogram::bucket_upper(size_t index) {
+  if (index < kSubCount) {
+    return (uint32_t)index;
+  }
+
+  size_t offset = index - kSubCount;
+  int shift = (int)(offset / kSubCount);
+  uint32_t sub = (uint32_t)(offset % kSubCount);
+  uint32_t lower = (kSubCount + sub) << shift;
+  return lower + ((1u << shift) - 1);
+}
+
+/**
+ * 记录一个值
+ */
+void KCPHistogram::record(uint32_t value) {
+  if (value > kMaxValue) {
+    value = kMaxValue;
+  }
+  if (buckets_.empty()) {
+    buckets_.assign(kBucketCount, 0);
+  }
+
+  buckets_[bucket_of(value)]++;
+  if (count_ == 0 || value < min_) {
+    min_ = value;
+  }
+  if (value > max_) {
+    max_ = value;
+  }
+  count_++;
+  sum_ += value;
+}
+
+/**
+ * 计算百分位数
+ */
+uint32_t KCPHistogram::percentile(double percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  if (percentile < 0) {
+    percentile = 0;
+  }
+  if (percentile > 100) {
+    percentile = 100;
+  }
+
+  // 第rank个样本（从1开始）所在的桶
+  uint64_t rank = (uint64_t)(percentile / 100.0 * count_ + 0.5);
+  if (rank < 1) {
+    rank = 1;
+  }
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      uint32_t upper = bucket_upper(i);
+      return upper < max_ ? upper : max_;
+    }
+  }
+  return max_;
+}
+
+/**
+ * 合并另一个直方图
+ */
+void KCPHistogram::merge(const KCPHistogram &other) {
+  if (other.count_ == 0) {
+    return;
+  }
+  if (buckets_.empty()) {
+    buckets_.assign(kBucketCount, 0);
+  }
+
+  for (size_t i = 0; i < kBucketCount; i++) {
+    buckets_[i] += other.buckets_[i];
+  }
+  if (count_ == 0 || other.min_ < min_) {
+    min_ = other.min_;
+  }
+  if (other.max_ > max_) {
+    max_ = other.max_;
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+}
+
+/**
+ * 清空所有样本
+ */
+void KCPHistogram::reset() {
+  buckets_.clear();
+  count_ = 0;
+  sum_ = 0;
+  min_ = 0;
+  max_ = 0;
+}
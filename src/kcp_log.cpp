@@ -0,0 +1,170 @@
+#include "kcp_log.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 日志全局状态
+// 故意不释放：其他静态对象析构时仍可能写日志
+struct LogState {
+  std::mutex mutex;              // 保护sink和异步缓冲区
+  std::condition_variable ready; // 异步缓冲区有新日志
+  KCPLog::Sink sink;             // 自定义输出目标
+
+  // 异步环形缓冲区
+  bool async;                                    // 是否处于异步模式
+  bool stopping;                                 // 后台线程正在退出
+  std::vector<std::pair<int, std::string>> ring; // 环形缓冲区
+  size_t head;                                   // 最早一条日志的位置
+  size_t count;                                  // 缓冲区中的日志数量
+  std::thread worker;                            // 后台输出线程
+
+  LogState() : async(false), stopping(false), head(0), count(0) {}
+};
+
+static LogState *g_log = new LogState();
+static std::atomic<int> g_level(KCP_LOG_LEVEL_TRACE);
+static std::atomic<uint64_t> g_dropped(0);
+
+/**
+ * 输出一行日志（调用者需持有g_log->mutex，或处于后台线程中）
+ */
+static void emit(const KCPLog::Sink &sink, int level, const std::string &line) {
+  if (sink) {
+    sink(level, line.data(), line.size());
+    return;
+  }
+
+  // 默认输出：WARN及以上写入stderr，其余写入stdout
+  // 整行一次写入，多线程输出时不会交错
+  FILE *out = level >= KCP_LOG_LEVEL_WARN ? stderr : stdout;
+  std::string text = line;
+  text.push_back('\n');
+  fwrite(text.data(), 1, text.size(), out);
+}
+
+/**
+ * 异步模式后台线程
+ */
+static void async_worker() {
+  std::vector<std::pair<int, std::string>> batch;
+  std::unique_lock<std::mutex> lock(g_log->mutex);
+  while (true) {
+    g_log->ready.wait(lock,
+                      [] { return g_log->count > 0 || g_log->stopping; });
+
+    // 一次取出缓冲区中的所有日志，输出时不持有锁
+    batch.clear();
+    while (g_log->count > 0) {
+      batch.push_back(std::move(g_log->ring[g_log->head]));
+      g_log->head = (g_log->head + 1) % g_log->ring.size();
+      g_log->count--;
+    }
+    bool stopping = g_log->stopping;
+    KCPLog::Sink sink = g_log->sink;
+
+    lock.unlock();
+    for (size_t i = 0; i < batch.size(); i++) {
+      emit(sink, batch[i].first, batch[i].second);
+    }
+    fflush(stdout);
+    lock.lock();
+
+    if (stopping && g_log->count == 0) {
+      return;
+    }
+  }
+}
+
+/**
+ * 设置运行期最低日志级别
+ */
+void KCPLog::set_level(int level) { g_level.store(level); }
+
+/**
+ * 获取运行期最低日志级别
+ */
+int KCPLog::get_level() { return g_level.load(std::memory_order_relaxed); }
+
+/**
+ * 设置输出目标
+ */
+void KCPLog::set_sink(Sink sink) {
+  std::lock_guard<std::mutex> lock(g_log->mutex);
+  g_log->sink = sink;
+}
+
+/**
+ * 启动异步输出
+ */
+void KCPLog::start_async(size_t capacity) {
+  std::lock_guard<std::mutex> lock(g_log->mutex);
+  if (g_log->async) {
+    return;
+  }
+
+  g_log->ring.clear();
+  g_log->ring.resize(capacity > 0 ? capacity : 1);
+  g_log->head = 0;
+  g_log->count = 0;
+  g_log->stopping = false;
+  g_log->async = true;
+  g_log->worker = std::thread(async_worker);
+}
+
+/**
+ * 停止异步输出
+ */
+void KCPLog::stop_async() {
+  std::thread worker;
+  {
+    std::lock_guard<std::mutex> lock(g_log->mutex);
+    if (!g_log->async) {
+      return;
+    }
+    g_log->stopping = true;
+    worker = std::move(g_log->worker);
+  }
+  g_log->ready.notify_one();
+  worker.join();
+
+  std::lock_guard<std::mutex> lock(g_log->mutex);
+  g_log->async = false;
+  g_log->stopping = false;
+}
+
+/**
+ * 获取异步模式下丢弃的日志行数
+ */
+uint64_t KCPLog::get_dropped() { return g_dropped.load(); }
+
+/**
+ * 写入一行日志
+ */
+void KCPLog::write(int level, const std::string &line) {
+  std::unique_lock<std::mutex> lock(g_log->mutex);
+
+  if (!g_log->async || g_log->stopping) {
+    emit(g_log->sink, level, line);
+    return;
+  }
+
+  // 异步模式：写入环形缓冲区，缓冲区满时丢弃（不阻塞事件循环）
+  if (g_log->count == g_log->ring.size()) {
+    g_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  size_t tail = (g_log->head + g_log->count) % g_log->ring.size();
+  g_log->ring[tail].first = level;
+  g_log->ring[tail].second = line;
+  g_log->count++;
+  bool first = g_log->count == 1;
+  lock.unlock();
+
+  if (first) {
+    g_log->ready.notify_one();
+  }
+}
@@ -0,0 +1,203 @@
+#include "kcp_pmtu.h"
+#include "kcp_log.h"
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/**
+ * 构造函数实现
+ */
+KCPPmtuProber::KCPPmtuProber(const Config &config, uint32_t mtu)
+    : config_(config), mtu_(mtu), initial_mtu_(mtu), first_probe_(0),
+      started_(false), searching_(false),
+      verifying_(false), lo_(mtu), hi_(mtu), probe_size_(0), probe_id_(0),
+      probe_time_(0), attempts_(0), next_search_(0), probes_sent_(0) {
+  if (config_.max_mtu < config_.min_mtu) {
+    config_.max_mtu = config_.min_mtu;
+  }
+  if (config_.granularity < 1) {
+    config_.granularity = 1;
+  }
+  if (config_.retries < 1) {
+    config_.retries = 1;
+  }
+  // 确认之前使用min_mtu，避免在黑洞路径上按过大的MTU切分数据
+  if (mtu_ > config_.min_mtu) {
+    mtu_ = config_.min_mtu;
+  }
+}
+
+/**
+ * 推进状态机
+ */
+int KCPPmtuProber::poll(uint32_t current, uint32_t *probe_id,
+                        uint32_t *new_mtu) {
+  *new_mtu = 0;
+
+  if (!started_) {
+    // 第一轮：从min_mtu向上查找，第一个探测使用配置的MTU（通常一次即可确认）
+    started_ = true;
+    searching_ = true;
+    verifying_ = false;
+    lo_ = mtu_;
+    hi_ = config_.max_mtu;
+    first_probe_ = initial_mtu_;
+  } else if (!searching_) {
+    if ((int32_t)(current - next_search_) < 0) {
+      return 0;
+    }
+    // 重新探测：先验证当前MTU（路由变化后可能变小），不高于min_mtu时无需验证
+    searching_ = true;
+    verifying_ = mtu_ > config_.min_mtu;
+    lo_ = mtu_;
+    hi_ = config_.max_mtu;
+    probe_size_ = 0;
+  }
+
+  int size = 0;
+  if (probe_size_ != 0) {
+    if ((int32_t)(current - probe_time_) < (int32_t)config_.probe_timeout) {
+      return 0;
+    }
+    if (attempts_ < config_.retries) {
+      // 同一长度重试（探测包本身也可能因为普通丢包而丢失）
+      size = (int)probe_size_;
+    } else if (verifying_) {
+      // 当前MTU已不可用（路由变化），立即回退到min_mtu再向上查找
+      verifying_ = false;
+      lo_ = config_.min_mtu;
+      hi_ = mtu_ - 1;
+      mtu_ = config_.min_mtu;
+      *new_mtu = mtu_;
+      probe_size_ = 0;
+    } else {
+      hi_ = probe_size_ - 1;
+      probe_size_ = 0;
+    }
+  }
+
+  if (size == 0) {
+    size = verifying_ ? (int)mtu_ : next_probe(current);
+    if (size == 0) {
+      return 0;
+    }
+    attempts_ = 0;
+  }
+
+  probe_size_ = (uint32_t)size;
+  probe_id_++;
+  probe_time_ = current;
+  attempts_++;
+  probes_sent_++;
+  *probe_id = probe_id_;
+  return size;
+}
+
+/**
+ * 推进二分查找
+ */
+int KCPPmtuProber::next_probe(uint32_t current) {
+  if (hi_ <= lo_ || hi_ - lo_ < config_.granularity) {
+    searching_ = false;
+    next_search_ = current + config_.reprobe_interval;
+    return 0;
+  }
+  if (first_probe_ > lo_ && first_probe_ <= hi_) {
+    uint32_t size = first_probe_;
+    first_probe_ = 0;
+    return (int)size;
+  }
+  first_probe_ = 0;
+  return (int)((lo_ + hi_ + 1) / 2);
+}
+
+/**
+ * 处理探测确认
+ */
+uint32_t KCPPmtuProber::on_ack(uint32_t probe_id, int size) {
+  // 同一长度的任意一次重试被确认都有效
+  if (probe_size_ == 0 || (uint32_t)size != probe_size_ ||
+      probe_id_ - probe_id >= (uint32_t)attempts_) {
+    return 0;
+  }
+  probe_size_ = 0;
+
+  if (verifying_) {
+    verifying_ = false;
+    return 0;
+  }
+  lo_ = (uint32_t)size;
+  if (lo_ > mtu_) {
+    mtu_ = lo_;
+    return mtu_;
+  }
+  return 0;
+}
+
+/**
+ * 设置socket的DF位
+ */
+int KCPPmtuProber::set_dont_fragment(uv_udp_t *handle) {
+  uv_os_fd_t fd;
+  int ret = uv_fileno((uv_handle_t *)handle, &fd);
+  if (ret < 0) {
+    return ret;
+  }
+  struct sockaddr_storage local;
+  socklen_t local_len = sizeof(local);
+  if (getsockname(fd, (struct sockaddr *)&local, &local_len) < 0) {
+    return -errno;
+  }
+
+#if defined(IP_MTU_DISCOVER) && defined(IP_PMTUDISC_PROBE)
+  int value = IP_PMTUDISC_PROBE;
+  if (local.ss_family == AF_INET6) {
+#if defined(IPV6_MTU_DISCOVER) && defined(IPV6_PMTUDISC_PROBE)
+    int value6 = IPV6_PMTUDISC_PROBE;
+    if (setsockopt(fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &value6,
+                   sizeof(value6)) < 0) {
+      return -errno;
+    }
+#endif
+    // 双栈socket发往IPv4映射地址的数据包使用IPv4选项，失败不影响IPv6
+    setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &value, sizeof(value));
+    return 0;
+  }
+  if (setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &value, sizeof(value)) < 0) {
+    return -errno;
+  }
+  return 0;
+#elif defined(IP_DONTFRAG)
+  int on = 1;
+  if (local.ss_family == AF_INET6) {
+#ifdef IPV6_DONTFRAG
+    if (setsockopt(fd, IPPROTO_IPV6, IPV6_DONTFRAG, &on, sizeof(on)) < 0) {
+      return -errno;
+    }
+#endif
+    return 0;
+  }
+  if (setsockopt(fd, IPPROTO_IP, IP_DONTFRAG, &on, sizeof(on)) < 0) {
+    return -errno;
+  }
+  return 0;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+/**
+ * 按路径MTU探测配置准备socket
+ */
+int KCPPmtuProber::prepare_socket(uv_udp_t *handle, int mtu, bool enable,
+                                  const Config &config) {
+  if (!enable) {
+    return mtu;
+  }
+  int ret = set_dont_fragment(handle);
+  if (ret < 0) {
+    KCP_LOG_WARN("[KCPPmtuProber] 设置DF位失败，路径MTU探测结果可能偏大: "
+                 << uv_strerror(ret));
+  }
+  return (int)config.max_mtu > mtu ? (int)config.max_mtu : mtu;
+}
@@ -0,0 +1,63 @@
+#include "kcp_post_queue.h"
+
+/**
+ * 构造函数实现
+ * 队列为空时头尾都指向哨兵节点
+ */
+KCPPostQueue::KCPPostQueue() : head_(&stub_), tail_(&stub_) {}
+
+/**
+ * 析构函数实现
+ */
+KCPPostQueue::~KCPPostQueue() {
+  while (KCPPostedMessage *node = pop()) {
+    delete node;
+  }
+}
+
+/**
+ * 入队
+ */
+void KCPPostQueue::push(KCPPostedMessage *node) {
+  node->next.store(nullptr, std::memory_order_relaxed);
+  // 交换队尾后再把前一个节点链接到新节点，链接之前消费者看不到新节点
+  KCPPostedMessage *prev = head_.exchange(node, std::memory_order_acq_rel);
+  prev->next.store(node, std::memory_order_release);
+}
+
+/**
+ * 出队
+ */
+KCPPostedMessage *KCPPostQueue::pop() {
+  KCPPostedMessage *tail = tail_;
+  KCPPostedMessage *next = tail->next.load(std::memory_order_acquire);
+
+  // 跳过哨兵节点
+  if (tail == &stub_) {
+    if (!next) {
+      return nullptr;
+    }
+    tail_ = next;
+    tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+
+  if (next) {
+    tail_ = next;
+    return tail;
+  }
+
+  // tail是最后一个已链接的节点：有生产者正在入队时稍后再取
+  if (tail != head_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+
+  // tail是队列中唯一的节点：放回哨兵节点，之后tail即可出队
+  push(&stub_);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next) {
+    tail_ = next;
+    return tail;
+  }
+  return nullptr;
+}
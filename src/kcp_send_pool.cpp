@@ -0,0 +1,305 @@
+#include "kcp_send_pool.h"
+#include "kcp_log.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
+// 单次sendmmsg最多发送的数据包数量
+static const size_t kMaxMmsgBatch = 64;
+
+/**
+ * 构造函数实现
+ */
+KCPSendPool::KCPSendPool()
+    : slot_size_(0), try_send_(true), batching_(false), batch_handle_(nullptr),
+      in_use_(0), high_water_(0), low_water_(0), acquired_(0),
+      heap_fallbacks_(0), try_send_hits_(0), try_send_fallbacks_(0),
+      batch_flushes_(0), batch_packets_(0), sendmmsg_calls_(0) {}
+
+/**
+ * 析构函数实现
+ */
+KCPSendPool::~KCPSendPool() {}
+
+/**
+ * 初始化发送池
+ * 一次性分配所有请求和缓冲区，之后的分配和释放只操作空闲列表
+ */
+void KCPSendPool::init(int slot_size, int capacity) {
+  if (slot_size < 0) {
+    slot_size = 0;
+  }
+  if (capacity < 0) {
+    capacity = 0;
+  }
+
+  slot_size_ = slot_size;
+  requests_.assign(capacity, Request());
+  slab_.assign((size_t)slot_size * capacity, 0);
+  free_list_.clear();
+  free_list_.reserve(capacity);
+
+  // 逆序放入空闲列表，使分配从低地址开始
+  for (int i = capacity - 1; i >= 0; i--) {
+    Request *request = &requests_[i];
+    request->pool = this;
+    request->data = &slab_[(size_t)i * slot_size];
+    request->pooled = true;
+    free_list_.push_back(request);
+  }
+
+  in_use_ = 0;
+  high_water_ = 0;
+  low_water_ = (uint32_t)capacity;
+  acquired_ = 0;
+  heap_fallbacks_ = 0;
+  try_send_hits_ = 0;
+  try_send_fallbacks_ = 0;
+  batch_flushes_ = 0;
+  batch_packets_ = 0;
+  sendmmsg_calls_ = 0;
+  batch_.clear();
+  batch_.reserve(kMaxMmsgBatch);
+
+  KCP_LOG_INFO("[KCPSendPool] 发送池已初始化，slot_size=" << slot_size
+               << ", capacity=" << capacity);
+}
+
+/**
+ * 初始化发送池并设置批量发送
+ */
+void KCPSendPool::setup(int slot_size, int capacity, bool batching,
+                        uv_check_t *flush_check, uv_check_cb on_flush) {
+  init(slot_size, capacity);
+  set_batching(batching);
+  if (batching) {
+    uv_check_start(flush_check, on_flush);
+  }
+}
+
+/**
+ * 分配发送请求
+ */
+KCPSendPool::Request *KCPSendPool::acquire(int len) {
+  if (len <= slot_size_ && !free_list_.empty()) {
+    Request *request = free_list_.back();
+    free_list_.pop_back();
+
+    in_use_++;
+    acquired_++;
+    if (in_use_ > high_water_) {
+      high_water_ = in_use_;
+    }
+    if (free_list_.size() < low_water_) {
+      low_water_ = (uint32_t)free_list_.size();
+    }
+    return request;
+  }
+
+  // 池已耗尽或数据超过槽位大小，回退到堆分配
+  Request *request = new Request;
+  request->pool = this;
+  request->data = new char[len];
+  request->pooled = false;
+  heap_fallbacks_++;
+  return request;
+}
+
+/**
+ * 释放发送请求
+ */
+void KCPSendPool::release(Request *request) {
+  if (request->pooled) {
+    free_list_.push_back(request);
+    in_use_--;
+    return;
+  }
+
+  delete[] request->data;
+  delete request;
+}
+
+/**
+ * 发送UDP数据
+ */
+int KCPSendPool::send(uv_udp_t *handle, const char *buf, int len,
+                      const struct sockaddr *addr) {
+  if (batching_) {
+    // 批量发送：复制到池中缓冲区排队，等待flush
+    if (batch_handle_ && batch_handle_ != handle) {
+      flush();
+    }
+    batch_handle_ = handle;
+
+    Request *request = acquire(len);
+    memcpy(request->data, buf, len);
+    request->len = len;
+    request->addr.assign(addr);
+    batch_.push_back(request);
+    return 0;
+  }
+
+  if (try_send_) {
+    // 快速路径：直接从KCP的flush缓冲区同步发送，无需复制和分配请求
+    // 当libuv发送队列非空或socket缓冲区已满时返回UV_EAGAIN（保证发送顺序）
+    uv_buf_t direct = uv_buf_init((char *)buf, len);
+    int ret = uv_udp_try_send(handle, &direct, 1, addr);
+    if (ret >= 0) {
+      try_send_hits_++;
+      return 0;
+    }
+    if (ret != UV_EAGAIN) {
+      KCP_LOG_WARN("[KCPSendPool] uv_udp_try_send失败: " << uv_strerror(ret));
+      return ret;
+    }
+    try_send_fallbacks_++;
+  }
+
+  Request *request = acquire(len);
+
+  // 复制数据，异步发送期间原始缓冲区可能已经被KCP复用
+  memcpy(request->data, buf, len);
+  request->len = len;
+  return send_async(handle, request, addr);
+}
+
+/**
+ * 异步发送一个已填充数据的请求
+ */
+int KCPSendPool::send_async(uv_udp_t *handle, Request *request,
+                            const struct sockaddr *addr) {
+  uv_buf_t buffer = uv_buf_init(request->data, request->len);
+
+  int ret = uv_udp_send(&request->req, handle, &buffer, 1, addr, on_send);
+  if (ret < 0) {
+    KCP_LOG_ERROR("[KCPSendPool] uv_udp_send失败: " << uv_strerror(ret));
+    release(request);
+    return ret;
+  }
+
+  return 0;
+}
+
+/**
+ * 发送所有排队的数据
+ */
+void KCPSendPool::flush() {
+  if (batch_.empty()) {
+    return;
+  }
+
+  uv_udp_t *handle = batch_handle_;
+  size_t sent = 0;
+  batch_flushes_++;
+
+#ifdef __linux__
+  // libuv发送队列非空时直接sendmmsg会打乱发送顺序，全部走异步发送
+  uv_os_fd_t fd;
+  if (uv_udp_get_send_queue_count(handle) == 0 &&
+      uv_fileno((const uv_handle_t *)handle, &fd) == 0) {
+    struct mmsghdr msgs[kMaxMmsgBatch];
+    struct iovec iovs[kMaxMmsgBatch];
+
+    while (sent < batch_.size()) {
+      size_t count = batch_.size() - sent;
+      if (count > kMaxMmsgBatch) {
+        count = kMaxMmsgBatch;
+      }
+
+      memset(msgs, 0, sizeof(struct mmsghdr) * count);
+      for (size_t i = 0; i < count; i++) {
+        Request *request = batch_[sent + i];
+        iovs[i].iov_base = request->data;
+        iovs[i].iov_len = request->len;
+        msgs[i].msg_hdr.msg_name = (void *)request->addr.get();
+        msgs[i].msg_hdr.msg_namelen = request->addr.length();
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+
+      int ret;
+      do {
+        ret = sendmmsg(fd, msgs, (unsigned int)count, 0);
+      } while (ret < 0 && errno == EINTR);
+      sendmmsg_calls_++;
+
+      if (ret < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          // socket缓冲区已满，剩余数据回退到异步发送
+          break;
+        }
+        // 首个数据包发送失败（如目标不可达），丢弃该包后继续
+        KCP_LOG_WARN("[KCPSendPool] sendmmsg失败: " << strerror(errno));
+        release(batch_[sent]);
+        batch_[sent] = nullptr;
+        sent++;
+        continue;
+      }
+
+      for (int i = 0; i < ret; i++) {
+        release(batch_[sent + i]);
+        batch_[sent + i] = nullptr;
+      }
+      batch_packets_ += ret;
+      sent += ret;
+
+      if ((size_t)ret < count) {
+        // 部分发送，剩余数据回退到异步发送
+        break;
+      }
+    }
+  }
+#endif
+
+  // 剩余数据（非Linux平台、EAGAIN或发送队列非空）逐个异步发送
+  for (size_t i = sent; i < batch_.size(); i++) {
+    Request *request = batch_[i];
+    send_async(handle, request, request->addr.get());
+  }
+
+  batch_.clear();
+}
+
+/**
+ * 发送完成回调函数
+ * 将请求放回发送池
+ */
+void KCPSendPool::on_send(uv_udp_send_t *req, int status) {
+  if (status < 0) {
+    KCP_LOG_WARN("[KCPSendPool] UDP发送失败: " << uv_strerror(status));
+  }
+
+  Request *request = (Request *)req;
+  request->pool->release(request);
+}
+
+/**
+ * 获取统计信息
+ */
+KCPSendPool::Stats KCPSendPool::get_stats() const {
+  Stats stats;
+  stats.slot_size = (uint32_t)slot_size_;
+  stats.capacity = (uint32_t)requests_.size();
+  stats.in_use = in_use_;
+  stats.high_water = high_water_;
+  stats.low_water = low_water_;
+  stats.acquired = acquired_;
+  stats.heap_fallbacks = heap_fallbacks_;
+  stats.try_send_hits = try_send_hits_;
+  stats.try_send_fallbacks = try_send_fallbacks_;
+  stats.batch_flushes = batch_flushes_;
+  stats.batch_packets = batch_packets_;
+  stats.sendmmsg_calls = sendmmsg_calls_;
+  return stats;
+}
+
+/**
+ * 重置高/低水位统计
+ */
+void KCPSendPool::reset_watermarks() {
+  high_water_ = in_use_;
+  low_water_ = (uint32_t)free_list_.size();
+}
@@ -1,30 +1,68 @@
 #include "kcp_server.h"
+#include "kcp_log.h"
+#include <algorithm>
 #include <chrono>
+#include <cerrno>
 #include <cstring>
-#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 令牌重发、挑战发送的最小间隔（毫秒）
+static const uint32_t kControlInterval = 200;
+
+// 挑战nonce、握手cookie的时间片长度（毫秒），在当前或上一个时间片内有效
+static const uint32_t kChallengeEpoch = 10000;
+
+// 源IP令牌桶数量（必须是2的幂）
+static const size_t kAcceptBuckets = 4096;
 
 /**
  * 构造函数实现
  */
 KCPServer::KCPServer(uv_loop_t *loop)
     : loop_(loop), running_(false), next_conv_(1000), timeout_(30000),
+      drain_timeout_(KCPConnection::kDefaultDrainTimeout),
+      shutting_down_(false),
+      timer_granularity_(10), send_pool_capacity_(1024), expected_sessions_(0),
+      recv_mmsg_slots_(0),
+      send_batching_(false), reuseport_(false), migration_(false),
+      handshake_(false), max_sessions_(0), accept_rate_(0), accept_burst_(1),
       kcp_nodelay_(1), kcp_interval_(10), kcp_resend_(2), kcp_nc_(1),
-      kcp_sndwnd_(128), kcp_rcvwnd_(128), kcp_mtu_(1400) {
-  // 初始化UDP句柄
-  // loop: 事件循环
-  // &udp_handle_: UDP句柄指针
-  uv_udp_init(loop_, &udp_handle_);
-
-  // 设置UDP句柄的data字段为this指针
-  // 在回调函数中可以通过handle->data获取KCPServer对象
-  udp_handle_.data = this;
-
+      kcp_sndwnd_(128), kcp_rcvwnd_(128), kcp_mtu_(1400),
+      max_message_size_(KCPConnection::kDefaultMaxMessageSize),
+      channels_(0), tuning_(false), pmtu_(false), fec_data_(0), fec_parity_(0),
+      fec_auto_(false), high_packets_(0), low_packets_(0), high_bytes_(0),
+      low_bytes_(0),
+      stats_interval_(0) {
   // 初始化定时器
   // 用于定期调用KCP的update函数
   uv_timer_init(loop_, &timer_);
   timer_.data = this;
 
-  std::cout << "[KCPServer] 服务器已创建" << std::endl;
+  // 初始化批量发送的check句柄
+  // check回调在每次事件循环迭代的IO处理之后执行
+  uv_check_init(loop_, &flush_check_);
+  flush_check_.data = this;
+
+  // 初始化统计导出定时器
+  uv_timer_init(loop_, &stats_timer_);
+  stats_timer_.data = this;
+
+  // 初始化投递队列唤醒句柄
+  // 多次uv_async_send在一次循环迭代中合并为一次回调；unref后不阻止uv_run退出
+  uv_async_init(loop_, &post_async_, on_post_async);
+  post_async_.data = this;
+  uv_unref((uv_handle_t *)&post_async_);
+
+  memset(&tick_stats_, 0, sizeof(tick_stats_));
+  memset(&stats_, 0, sizeof(stats_));
+  memset(&closed_totals_, 0, sizeof(closed_totals_));
+
+  // 控制包密钥只在本进程内使用（令牌和nonce都由服务器自己校验），每次启动重新生成
+  KCPControl::random_key(secret_);
+
+  KCP_LOG_INFO("[KCPServer] 服务器已创建");
 }
 
 /**
@@ -35,34 +73,63 @@ KCPServer::~KCPServer() {
 
   // 关闭所有连接
   connections_.clear();
+  reap_connections();
 
-  std::cout << "[KCPServer] 服务器已销毁" << std::endl;
+  KCP_LOG_INFO("[KCPServer] 服务器已销毁");
 }
 
 /**
  * 绑定并启动服务器
  */
 int KCPServer::bind_and_listen(const std::string &ip, int port) {
-  struct sockaddr_in addr;
-
-  // 创建IPv4地址结构
-  // ip.c_str(): IP地址字符串
+  // 创建地址结构（IPv4或IPv6）
+  // ip: IP地址字符串，如"0.0.0.0"、"::"（双栈，同时接收IPv4和IPv6）
   // port: 端口号
-  // &addr: 输出的地址结构
   // 返回值：0表示成功，<0表示失败
-  int ret = uv_ip4_addr(ip.c_str(), port, &addr);
+  KCPAddress addr;
+  int ret = KCPAddress::parse(ip, port, &addr);
+  if (ret < 0) {
+    KCP_LOG_ERROR("[KCPServer] 无效的IP地址: " << uv_strerror(ret));
+    return ret;
+  }
+
+  // 初始化UDP句柄
+  // 批量接收模式需要在初始化时指定UV_UDP_RECVMMSG标志
+  // AF_UNSPEC: 不预先创建socket，在bind时按地址族创建
+  unsigned int udp_flags = AF_UNSPEC;
+  if (recv_mmsg_slots_ > 0) {
+    udp_flags |= UV_UDP_RECVMMSG;
+  }
+  ret = uv_udp_init_ex(loop_, &udp_handle_, udp_flags);
   if (ret < 0) {
-    std::cerr << "[KCPServer] 无效的IP地址: " << uv_strerror(ret) << std::endl;
+    KCP_LOG_ERROR("[KCPServer] 初始化UDP句柄失败: " << uv_strerror(ret));
     return ret;
   }
 
+  // 设置UDP句柄的data字段为this指针
+  // 在回调函数中可以通过handle->data获取KCPServer对象
+  udp_handle_.data = this;
+
+  // 分配接收缓冲区
+  // libuv的recvmmsg按64KB划分槽位，缓冲区大小决定每次最多接收的数据报数量
+  if (recv_mmsg_slots_ > 0) {
+    recv_buffer_.resize((size_t)recv_mmsg_slots_ * 65536);
+  } else {
+    recv_buffer_.resize(65536);
+  }
+
   // 绑定UDP地址
   // &udp_handle_: UDP句柄
-  // (const struct sockaddr*)&addr: 地址结构
-  // 0: 标志位（0表示默认行为，UV_UDP_REUSEADDR表示允许地址重用）
-  ret = uv_udp_bind(&udp_handle_, (const struct sockaddr *)&addr, 0);
+  // addr.get(): 地址结构
+  // 0: 标志位（0表示默认行为，不设置UV_UDP_IPV6ONLY，IPv6地址同时接收IPv4）
+  // 注意：libuv的UV_UDP_REUSEADDR在Linux上不会设置SO_REUSEPORT，需要自行创建socket
+  if (reuseport_) {
+    ret = bind_reuseport(addr.get());
+  } else {
+    ret = uv_udp_bind(&udp_handle_, addr.get(), 0);
+  }
   if (ret < 0) {
-    std::cerr << "[KCPServer] 绑定失败: " << uv_strerror(ret) << std::endl;
+    KCP_LOG_ERROR("[KCPServer] 绑定失败: " << uv_strerror(ret));
     return ret;
   }
 
@@ -72,46 +139,126 @@ int KCPServer::bind_and_listen(const std::string &ip, int port) {
   // on_udp_recv: 数据接收回调（接收到数据时调用）
   ret = uv_udp_recv_start(&udp_handle_, alloc_buffer, on_udp_recv);
   if (ret < 0) {
-    std::cerr << "[KCPServer] 启动接收失败: " << uv_strerror(ret) << std::endl;
+    KCP_LOG_ERROR("[KCPServer] 启动接收失败: " << uv_strerror(ret));
     return ret;
   }
 
+  // 路径MTU探测需要DF位
+  int slot_size =
+      KCPPmtuProber::prepare_socket(&udp_handle_, kcp_mtu_, pmtu_, pmtu_config_);
+
+  // 初始化UDP发送池
+  // 槽位大小与MTU（启用探测时为最大探测长度）一致，KCP每次输出的数据不会超过MTU
+  send_pool_.setup(slot_size, send_pool_capacity_, send_batching_,
+                   &flush_check_, on_flush_check);
+
+  // 按预期会话数量预留KCP内存（分配器在创建第一个连接时安装）
+  if (expected_sessions_ > 0) {
+    KCPSlabAllocator::reserve(expected_sessions_, kcp_mtu_);
+  }
+
+  // 初始化调度时间轮
+  // 每个tick只处理截止时间已到的连接，而不是遍历所有连接
+  timer_wheel_.reset(get_current_ms(), timer_granularity_);
+
   // 启动定时器
   // &timer_: 定时器句柄
   // on_timer: 定时器回调函数
   // 0: 第一次触发延迟（0表示立即触发）
-  // 10: 重复间隔（10ms，与KCP的interval保持一致或更小）
+  // timer_granularity_: 重复间隔（默认10ms，即时间轮粒度）
   // 注意：定时器间隔应该小于等于KCP的interval参数
-  ret = uv_timer_start(&timer_, on_timer, 0, 10);
+  ret = uv_timer_start(&timer_, on_timer, 0, timer_granularity_);
   if (ret < 0) {
-    std::cerr << "[KCPServer] 启动定时器失败: " << uv_strerror(ret)
-              << std::endl;
+    KCP_LOG_ERROR("[KCPServer] 启动定时器失败: " << uv_strerror(ret));
     return ret;
   }
 
+  // 启动周期性统计导出
+  if (stats_interval_ > 0 && stats_export_callback_) {
+    uv_timer_start(&stats_timer_, on_stats_timer, stats_interval_,
+                   stats_interval_);
+  }
+
   running_ = true;
-  std::cout << "[KCPServer] 服务器已启动，监听 " << ip << ":" << port
-            << std::endl;
+  KCP_LOG_INFO("[KCPServer] 服务器已启动，监听 " << addr.to_string()
+               << (uv_udp_using_recvmmsg(&udp_handle_) ? "（recvmmsg批量接收）" : ""));
   return 0;
 }
 
+/**
+ * 创建启用SO_REUSEPORT的socket并绑定
+ */
+int KCPServer::bind_reuseport(const struct sockaddr *addr) {
+#ifdef SO_REUSEPORT
+  int fd = socket(addr->sa_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -errno;
+  }
+
+  int on = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+    int err = -errno;
+    ::close(fd);
+    return err;
+  }
+
+  // IPv6 socket关闭IPV6_V6ONLY，与uv_udp_bind的默认行为一致（双栈）
+  if (addr->sa_family == AF_INET6) {
+    int off = 0;
+    setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+  }
+
+  KCPAddress bind_addr(addr);
+  if (::bind(fd, bind_addr.get(), bind_addr.length()) < 0) {
+    int err = -errno;
+    ::close(fd);
+    return err;
+  }
+
+  // 交给libuv管理（libuv会设置为非阻塞模式）
+  int ret = uv_udp_open(&udp_handle_, fd);
+  if (ret < 0) {
+    ::close(fd);
+  }
+  return ret;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+/**
+ * 获取底层socket描述符
+ */
+int KCPServer::get_socket_fd() const {
+  // UDP句柄在bind_and_listen中初始化，未启动时不可访问
+  if (!running_) {
+    return -1;
+  }
+
+  uv_os_fd_t fd;
+  if (uv_fileno((const uv_handle_t *)&udp_handle_, &fd) < 0) {
+    return -1;
+  }
+  return fd;
+}
+
 /**
  * 运行事件循环
  */
 void KCPServer::run() {
   if (!running_) {
-    std::cerr << "[KCPServer] 服务器未启动" << std::endl;
+    KCP_LOG_ERROR("[KCPServer] 服务器未启动");
     return;
   }
 
-  std::cout << "[KCPServer] 事件循环开始运行" << std::endl;
+  KCP_LOG_INFO("[KCPServer] 事件循环开始运行");
 
   // 运行事件循环
   // UV_RUN_DEFAULT: 默认模式，会一直运行直到没有活跃的句柄和请求
   // 这是一个阻塞调用，会在这里一直执行，处理所有的IO事件
   uv_run(loop_, UV_RUN_DEFAULT);
 
-  std::cout << "[KCPServer] 事件循环已退出" << std::endl;
+  KCP_LOG_INFO("[KCPServer] 事件循环已退出");
 }
 
 /**
@@ -126,6 +273,11 @@ void KCPServer::stop() {
 
   // 停止定时器
   uv_timer_stop(&timer_);
+  uv_timer_stop(&stats_timer_);
+
+  // 发送剩余的排队数据并停止批量发送
+  send_pool_.flush();
+  uv_check_stop(&flush_check_);
 
   // 停止UDP接收
   uv_udp_recv_stop(&udp_handle_);
@@ -134,7 +286,45 @@ void KCPServer::stop() {
   // 会使uv_run返回
   uv_stop(loop_);
 
-  std::cout << "[KCPServer] 服务器已停止" << std::endl;
+  KCP_LOG_INFO("[KCPServer] 服务器已停止");
+}
+
+/**
+ * 优雅关闭所有会话
+ */
+void KCPServer::shutdown(uint32_t deadline, ShutdownCallback cb) {
+  KCP_LOG_INFO("[KCPServer] 开始优雅关闭，会话数=" << connections_.size()
+               << ", deadline=" << deadline << "ms");
+  shutting_down_ = true;
+  shutdown_callback_ = cb;
+
+  // 关闭回调会修改连接表，先收集conv
+  std::vector<uint32_t> convs;
+  convs.reserve(connections_.size());
+  for (size_t i = 0; i < connections_.size(); i++) {
+    convs.push_back(connections_.at(i)->get_conv());
+  }
+  for (size_t i = 0; i < convs.size(); i++) {
+    KCPConnection *conn = connections_.find(convs[i]);
+    if (conn) {
+      conn->set_drain_timeout(deadline);
+      conn->close();
+    }
+  }
+  check_shutdown();
+}
+
+/**
+ * 关闭中且所有会话已移除时调用关闭完成回调
+ */
+void KCPServer::check_shutdown() {
+  if (!shutting_down_ || connections_.size() > 0 || !shutdown_callback_) {
+    return;
+  }
+  KCP_LOG_INFO("[KCPServer] 所有会话已关闭");
+  ShutdownCallback cb = shutdown_callback_;
+  shutdown_callback_ = nullptr;
+  cb();
 }
 
 /**
@@ -150,10 +340,301 @@ void KCPServer::set_kcp_config(int nodelay, int interval, int resend, int nc,
   kcp_rcvwnd_ = rcvwnd;
   kcp_mtu_ = mtu;
 
-  std::cout << "[KCPServer] KCP配置已更新: "
-            << "nodelay=" << nodelay << ", interval=" << interval
-            << ", resend=" << resend << ", nc=" << nc << ", sndwnd=" << sndwnd
-            << ", rcvwnd=" << rcvwnd << ", mtu=" << mtu << std::endl;
+  KCP_LOG_INFO("[KCPServer] KCP配置已更新: " << "nodelay=" << nodelay
+               << ", interval=" << interval << ", resend=" << resend
+               << ", nc=" << nc << ", sndwnd=" << sndwnd << ", rcvwnd="
+               << rcvwnd << ", mtu=" << mtu);
+}
+
+/**
+ * 获取调度统计信息
+ */
+KCPServer::TickStats KCPServer::get_tick_stats() const {
+  TickStats stats = tick_stats_;
+  stats.scheduled = (uint32_t)timer_wheel_.size();
+  return stats;
+}
+
+/**
+ * 获取服务器统计信息
+ */
+KCPServer::Stats KCPServer::get_stats() const {
+  Stats stats = stats_;
+  stats.sessions_active = (uint32_t)connections_.size();
+  return stats;
+}
+
+/**
+ * 遍历所有连接
+ */
+void KCPServer::for_each_connection(
+    const std::function<void(KCPConnection *)> &fn) const {
+  for (size_t i = 0; i < connections_.size(); i++) {
+    fn(connections_.at(i));
+  }
+}
+
+/**
+ * 设置周期性统计导出
+ */
+void KCPServer::set_stats_export(uint32_t interval, StatsExportCallback cb) {
+  stats_interval_ = interval;
+  stats_export_callback_ = cb;
+
+  // 服务器已启动时立即生效
+  if (running_) {
+    uv_timer_stop(&stats_timer_);
+    if (stats_interval_ > 0 && stats_export_callback_) {
+      uv_timer_start(&stats_timer_, on_stats_timer, stats_interval_,
+                     stats_interval_);
+    }
+  }
+}
+
+/**
+ * 输出一个Prometheus指标
+ */
+static void write_metric(std::ostringstream &out, const char *name,
+                         const char *type, const char *help,
+                         const std::string &labels, double value) {
+  out << "# HELP " << name << " " << help << "\n";
+  out << "# TYPE " << name << " " << type << "\n";
+  out << name;
+  if (!labels.empty()) {
+    out << "{" << labels << "}";
+  }
+  out << " " << value << "\n";
+}
+
+/**
+ * 输出一个Prometheus summary指标（分位数由直方图计算）
+ */
+static void write_summary(std::ostringstream &out, const char *name,
+                          const char *help, const std::string &labels,
+                          const KCPHistogram &histogram) {
+  static const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+  out << "# HELP " << name << " " << help << "\n";
+  out << "# TYPE " << name << " summary\n";
+  for (double quantile : kQuantiles) {
+    out << name << "{";
+    if (!labels.empty()) {
+      out << labels << ",";
+    }
+    out << "quantile=\"" << quantile << "\"} "
+        << histogram.percentile(quantile * 100) << "\n";
+  }
+  const char *separator = labels.empty() ? "" : "{";
+  const char *terminator = labels.empty() ? "" : "}";
+  out << name << "_sum" << separator << labels << terminator << " "
+      << histogram.sum() << "\n";
+  out << name << "_count" << separator << labels << terminator << " "
+      << histogram.count() << "\n";
+}
+
+/**
+ * 把一个会话的累计计数器加到合计中
+ */
+void KCPServer::add_session_totals(SessionTotals &totals,
+                                   const KCPConnection::Stats &conn) {
+  totals.packets_out += conn.packets_out;
+  totals.send_errors += conn.send_errors;
+  totals.xmit += conn.xmit;
+  totals.fast_retransmits += conn.fast_retransmits;
+  totals.window_probes += conn.window_probes;
+  totals.fec_recovered += conn.fec_recovered;
+  totals.fec_parity_sent += conn.fec_parity_sent;
+  totals.compress_raw += conn.compress_raw_bytes;
+  totals.compress_bytes += conn.compress_bytes;
+  totals.queue_full += conn.queue_full;
+}
+
+/**
+ * 生成Prometheus文本格式的统计信息
+ */
+std::string KCPServer::format_prometheus(const std::string &labels) const {
+  Stats stats = get_stats();
+  TickStats ticks = get_tick_stats();
+  KCPSendPool::Stats pool = send_pool_.get_stats();
+
+  // 汇总所有连接的状态
+  // 累计计数器从已移除会话的合计开始，保证单调递增
+  uint64_t snd_que = 0, snd_buf = 0, rcv_que = 0, rcv_buf = 0;
+  uint64_t pending_bytes = 0, srtt_sum = 0;
+  int32_t srtt_max = 0;
+  SessionTotals totals = closed_totals_;
+  KCPHistogram ack_latency = closed_latency_;
+  for (size_t i = 0; i < connections_.size(); i++) {
+    KCPConnection::Stats conn = connections_.at(i)->get_stats();
+    ack_latency.merge(connections_.at(i)->get_latency_histogram());
+    add_session_totals(totals, conn);
+    snd_que += conn.nsnd_que;
+    snd_buf += conn.nsnd_buf;
+    rcv_que += conn.nrcv_que;
+    rcv_buf += conn.nrcv_buf;
+    pending_bytes += conn.pending_bytes;
+    srtt_sum += conn.srtt;
+    if (conn.srtt > srtt_max) {
+      srtt_max = conn.srtt;
+    }
+  }
+  double srtt_avg =
+      connections_.size() > 0 ? (double)srtt_sum / connections_.size() : 0;
+
+  std::ostringstream out;
+  write_metric(out, "kcp_server_packets_in_total", "counter",
+               "UDP datagrams received", labels, (double)stats.packets_in);
+  write_metric(out, "kcp_server_bytes_in_total", "counter",
+               "UDP bytes received", labels, (double)stats.bytes_in);
+  write_metric(out, "kcp_server_drops_short_total", "counter",
+               "Datagrams dropped for being shorter than the KCP header",
+               labels, (double)stats.drops_short);
+  write_metric(out, "kcp_server_drops_partial_total", "counter",
+               "Truncated datagrams dropped", labels,
+               (double)stats.drops_partial);
+  write_metric(out, "kcp_server_recv_errors_total", "counter",
+               "UDP receive errors", labels, (double)stats.recv_errors);
+  write_metric(out, "kcp_server_sessions_created_total", "counter",
+               "Sessions created", labels, (double)stats.sessions_created);
+  write_metric(out, "kcp_server_sessions_closed_total", "counter",
+               "Sessions removed", labels, (double)stats.sessions_closed);
+  write_metric(out, "kcp_server_sessions_timed_out_total", "counter",
+               "Sessions removed by idle timeout", labels,
+               (double)stats.sessions_timed_out);
+  write_metric(out, "kcp_server_sessions", "gauge", "Active sessions", labels,
+               (double)stats.sessions_active);
+  write_metric(out, "kcp_server_migrations_total", "counter",
+               "Sessions moved to a verified new address", labels,
+               (double)stats.migrations);
+  write_metric(out, "kcp_server_migration_challenges_total", "counter",
+               "Address challenges sent", labels,
+               (double)stats.migration_challenges);
+  write_metric(out, "kcp_server_migration_failures_total", "counter",
+               "Invalid challenge responses", labels,
+               (double)stats.migration_failures);
+  write_metric(out, "kcp_server_drops_unverified_total", "counter",
+               "Datagrams dropped from an unverified address", labels,
+               (double)stats.drops_unverified);
+  write_metric(out, "kcp_server_cookies_sent_total", "counter",
+               "Handshake cookies sent", labels, (double)stats.cookies_sent);
+  write_metric(out, "kcp_server_bad_cookies_total", "counter",
+               "HELLO packets with an invalid cookie", labels,
+               (double)stats.bad_cookies);
+  write_metric(out, "kcp_server_drops_no_session_total", "counter",
+               "Datagrams dropped for an unknown conv without a handshake",
+               labels, (double)stats.drops_no_session);
+  write_metric(out, "kcp_server_sessions_rejected_total", "counter",
+               "Sessions refused by the session cap or per-source rate limit",
+               labels, (double)stats.sessions_rejected);
+  write_metric(out, "kcp_server_posted_messages_total", "counter",
+               "Messages taken from the cross-thread post queue", labels,
+               (double)stats.posted_messages);
+  write_metric(out, "kcp_server_post_drops_no_session_total", "counter",
+               "Posted messages dropped for an unknown conv", labels,
+               (double)stats.post_drops_no_session);
+  write_metric(out, "kcp_server_post_send_errors_total", "counter",
+               "Posted messages dropped because send failed", labels,
+               (double)stats.post_send_errors);
+  write_metric(out, "kcp_server_post_wakeups_total", "counter",
+               "Event loop wakeups that drained the post queue", labels,
+               (double)stats.post_wakeups);
+  write_metric(out, "kcp_server_ticks_total", "counter", "Scheduler ticks",
+               labels, (double)ticks.ticks);
+  write_metric(out, "kcp_server_serviced_total", "counter",
+               "Connections serviced by the scheduler", labels,
+               (double)ticks.serviced_total);
+  write_metric(out, "kcp_send_pool_in_use", "gauge",
+               "Send pool slots in flight", labels, (double)pool.in_use);
+  write_metric(out, "kcp_send_pool_heap_fallbacks_total", "counter",
+               "Sends that fell back to heap allocation", labels,
+               (double)pool.heap_fallbacks);
+  write_metric(out, "kcp_packets_out_total", "counter",
+               "UDP datagrams sent by sessions", labels,
+               (double)totals.packets_out);
+  write_metric(out, "kcp_send_errors_total", "counter",
+               "UDP sends of sessions that failed immediately", labels,
+               (double)totals.send_errors);
+  write_metric(out, "kcp_retransmits_total", "counter",
+               "RTO retransmits of sessions", labels,
+               (double)totals.xmit);
+  write_metric(out, "kcp_fast_retransmits_total", "counter",
+               "Fast retransmits of sessions", labels,
+               (double)totals.fast_retransmits);
+  write_metric(out, "kcp_fec_recovered_total", "counter",
+               "Packets recovered by FEC in sessions", labels,
+               (double)totals.fec_recovered);
+  write_metric(out, "kcp_fec_parity_sent_total", "counter",
+               "FEC parity packets sent by sessions", labels,
+               (double)totals.fec_parity_sent);
+  write_metric(out, "kcp_compress_raw_bytes_total", "counter",
+               "Bytes of messages compressed by sessions", labels,
+               (double)totals.compress_raw);
+  write_metric(out, "kcp_compress_bytes_total", "counter",
+               "Compressed bytes sent by sessions", labels,
+               (double)totals.compress_bytes);
+  write_metric(out, "kcp_window_probes_total", "counter",
+               "Window probes sent by sessions", labels,
+               (double)totals.window_probes);
+  write_metric(out, "kcp_pending_bytes", "gauge",
+               "Bytes submitted by active sessions and not yet acknowledged",
+               labels, (double)pending_bytes);
+  write_metric(out, "kcp_send_queue_full_total", "counter",
+               "Sends refused at the high water mark by sessions", labels,
+               (double)totals.queue_full);
+  write_metric(out, "kcp_snd_queue", "gauge",
+               "Segments waiting to enter the send window", labels,
+               (double)snd_que);
+  write_metric(out, "kcp_snd_buf", "gauge", "Segments in flight", labels,
+               (double)snd_buf);
+  write_metric(out, "kcp_rcv_queue", "gauge",
+               "Segments waiting for the application", labels,
+               (double)rcv_que);
+  write_metric(out, "kcp_rcv_buf", "gauge", "Out-of-order segments", labels,
+               (double)rcv_buf);
+  write_metric(out, "kcp_srtt_avg_ms", "gauge",
+               "Average smoothed RTT of active sessions", labels, srtt_avg);
+  write_metric(out, "kcp_srtt_max_ms", "gauge",
+               "Maximum smoothed RTT of active sessions", labels,
+               (double)srtt_max);
+  write_summary(out, "kcp_ack_latency_ms",
+                "Time from send() to full acknowledgement",
+                labels, ack_latency);
+  return out.str();
+}
+
+/**
+ * 从其他线程投递消息
+ */
+int KCPServer::post_send(uint32_t conv, std::vector<char> &&data) {
+  return post_message(conv, -1, std::move(data));
+}
+
+/**
+ * 从其他线程投递消息到指定通道
+ */
+int KCPServer::post_send_channel(uint32_t conv, uint8_t channel,
+                                 std::vector<char> &&data) {
+  return post_message(conv, channel, std::move(data));
+}
+
+/**
+ * 入队投递消息并唤醒事件循环
+ */
+int KCPServer::post_message(uint32_t conv, int channel,
+                            std::vector<char> &&data) {
+  if (data.empty()) {
+    return -1;
+  }
+
+  KCPPostedMessage *msg = new KCPPostedMessage();
+  msg->conv = conv;
+  msg->channel = channel;
+  msg->data = std::move(data);
+  post_queue_.push(msg);
+
+  // uv_async_send是线程安全的，事件循环处理之前的重复唤醒只设置一个标志
+  uv_async_send(&post_async_);
+  return 0;
 }
 
 /**
@@ -181,9 +662,11 @@ void KCPServer::alloc_buffer(uv_handle_t *handle, size_t suggested_size,
   // 使用服务器的接收缓冲区
   // uv_buf_init: 初始化libuv缓冲区结构
   // server->recv_buffer_: 缓冲区指针
-  // sizeof(server->recv_buffer_): 缓冲区大小（64KB）
-  // 注意：这里使用静态缓冲区，避免频繁分配内存
-  *buf = uv_buf_init(server->recv_buffer_, sizeof(server->recv_buffer_));
+  // 缓冲区大小：普通模式64KB，批量接收模式 slots * 64KB
+  // 注意：这里使用预分配的缓冲区，避免频繁分配内存
+  //       批量接收模式下收到UV_UDP_MMSG_FREE时也无需释放
+  *buf = uv_buf_init(server->recv_buffer_.data(),
+                     (unsigned int)server->recv_buffer_.size());
 }
 
 /**
@@ -197,28 +680,58 @@ void KCPServer::on_udp_recv(uv_udp_t *handle, ssize_t nread,
 
   // nread < 0 表示接收错误
   if (nread < 0) {
-    std::cerr << "[KCPServer] UDP接收错误: " << uv_strerror(nread) << std::endl;
+    server->stats_.recv_errors++;
+    KCP_LOG_ERROR("[KCPServer] UDP接收错误: " << uv_strerror(nread));
+    server->flush_recv_batch();
     return;
   }
 
-  // nread == 0 表示没有数据
-  if (nread == 0) {
+  // nread == 0 且 addr == nullptr 表示本次接收结束：
+  // - 普通模式：没有更多数据（EAGAIN）
+  // - 批量接收模式：UV_UDP_MMSG_FREE，整批数据报已全部回调完毕
+  if (nread == 0 && !addr) {
+    server->flush_recv_batch();
     return;
   }
 
-  // addr == nullptr 表示没有发送方地址
-  if (!addr) {
+  // nread == 0 表示空数据报
+  if (nread == 0) {
     return;
   }
 
   // flags & UV_UDP_PARTIAL 表示数据被截断（缓冲区太小）
   if (flags & UV_UDP_PARTIAL) {
-    std::cerr << "[KCPServer] UDP数据被截断" << std::endl;
+    server->stats_.drops_partial++;
+    KCP_LOG_WARN("[KCPServer] UDP数据被截断");
     return;
   }
 
   // 处理接收到的数据
   server->handle_udp_data(buf->base, nread, addr);
+
+  // 非批量接收的数据报单独成批，立即处理
+  // 批量接收的数据报（UV_UDP_MMSG_CHUNK）等到UV_UDP_MMSG_FREE时统一处理
+  if (!(flags & UV_UDP_MMSG_CHUNK)) {
+    server->flush_recv_batch();
+  }
+}
+
+/**
+ * 批量发送回调函数实现
+ */
+void KCPServer::on_flush_check(uv_check_t *handle) {
+  KCPServer *server = (KCPServer *)handle->data;
+  server->send_pool_.flush();
+}
+
+/**
+ * 统计导出定时器回调函数实现
+ */
+void KCPServer::on_stats_timer(uv_timer_t *handle) {
+  KCPServer *server = (KCPServer *)handle->data;
+  if (server->stats_export_callback_) {
+    server->stats_export_callback_(server);
+  }
 }
 
 /**
@@ -232,13 +745,31 @@ void KCPServer::on_timer(uv_timer_t *handle) {
   server->update_connections();
 }
 
+/**
+ * 投递队列唤醒回调函数实现
+ */
+void KCPServer::on_post_async(uv_async_t *handle) {
+  KCPServer *server = (KCPServer *)handle->data;
+  server->drain_posted();
+}
+
 /**
  * 处理UDP数据
  */
 void KCPServer::handle_udp_data(const char *data, int len,
                                 const struct sockaddr *addr) {
+  stats_.packets_in++;
+  stats_.bytes_in += len;
+
+  // 控制包（握手、令牌确认、挑战应答）不进入KCP
+  if (KCPControl::is_control(data, len)) {
+    handle_control(data, len, addr);
+    return;
+  }
+
   // KCP数据包至少需要24字节（KCP协议头）
   if (len < 24) {
+    stats_.drops_short++;
     return;
   }
 
@@ -248,19 +779,394 @@ void KCPServer::handle_udp_data(const char *data, int len,
   uint32_t conv = *(uint32_t *)data;
 
   // 查找或创建连接
-  KCPConnection *conn = find_or_create_connection(conv, addr);
-  if (!conn) {
+  // 启用握手时只有通过cookie校验的HELLO才能创建会话
+  KCPConnection *conn;
+  if (handshake_) {
+    conn = connections_.find(conv);
+    if (!conn) {
+      stats_.drops_no_session++;
+      return;
+    }
+  } else {
+    conn = find_or_create_connection(conv, addr);
+    if (!conn) {
+      return;
+    }
+  }
+
+  // 来源地址与会话地址不一致时需要先通过地址验证
+  uint32_t current = get_current_ms();
+  if (migration_ && !check_peer(conn, addr, current)) {
     return;
   }
 
   // 更新连接的活跃时间
-  conn->update_active_time(get_current_ms());
+  conn->update_active_time(current);
 
   // 将数据输入到KCP
   conn->input(data, len);
 
-  // 尝试接收数据
-  conn->recv();
+  // 记录到当前接收批次，recv和调度在整批数据输入完成后进行
+  for (size_t i = 0; i < recv_batch_.size(); i++) {
+    if (recv_batch_[i] == conv) {
+      return;
+    }
+  }
+  recv_batch_.push_back(conv);
+}
+
+/**
+ * 处理控制包
+ */
+void KCPServer::handle_control(const char *data, int len,
+                               const struct sockaddr *addr) {
+  uint8_t cmd = KCPControl::get_cmd(data);
+  if (cmd == KCP_CTRL_HELLO) {
+    if (handshake_) {
+      handle_hello(data, len, addr);
+    }
+    return;
+  }
+
+  // 路径MTU探测只处理会话当前地址的包；未启用握手时，会话尚未建立也无状态地回复探测
+  // （客户端在发出第一个KCP数据包之前就开始探测）。只确认不短于确认包的探测，
+  // 伪造源地址无法放大流量；启用握手时会话在cookie验证之后才建立，不做无状态回复
+  if (cmd == KCP_CTRL_PMTU_PROBE || cmd == KCP_CTRL_PMTU_ACK) {
+    uint32_t conv = *(uint32_t *)data;
+    KCPConnection *conn = connections_.find(conv);
+    uint32_t id;
+    if (conn) {
+      if (conn->get_address().equals(addr)) {
+        conn->update_active_time(get_current_ms());
+        conn->on_pmtu_control(data, len);
+      }
+    } else if (cmd == KCP_CTRL_PMTU_PROBE && !handshake_ &&
+               len >= KCPControl::kProbeAckSize &&
+               KCPControl::decode_probe(data, len, &id)) {
+      char packet[KCPControl::kMaxPacketSize];
+      int n = KCPControl::encode_probe_ack(packet, conv, id, len);
+      send_control(packet, n, addr);
+    }
+    return;
+  }
+  if (!migration_) {
+    return;
+  }
+
+  uint32_t conv = *(uint32_t *)data;
+  KCPConnection *conn = connections_.find(conv);
+  if (!conn || !conn->get_session_token()) {
+    return;
+  }
+
+  switch (KCPControl::get_cmd(data)) {
+  case KCP_CTRL_TOKEN_ACK:
+    // 只接受会话当前地址的确认
+    if (conn->get_address().equals(addr)) {
+      conn->set_token_confirmed(true);
+    }
+    break;
+
+  case KCP_CTRL_RESPONSE: {
+    uint64_t nonce;
+    if (!KCPControl::verify_response(data, len, *conn->get_session_token(),
+                                     &nonce)) {
+      stats_.migration_failures++;
+      return;
+    }
+
+    // nonce必须是本服务器最近签发给该地址的
+    uint32_t current = get_current_ms();
+    uint32_t epoch = current / kChallengeEpoch;
+    if (nonce != address_mac(KCP_CTRL_CHALLENGE, conv, addr, epoch) &&
+        nonce != address_mac(KCP_CTRL_CHALLENGE, conv, addr, epoch - 1)) {
+      stats_.migration_failures++;
+      return;
+    }
+    if (conn->get_address().equals(addr)) {
+      return;
+    }
+
+    KCP_LOG_INFO("[KCPServer] 连接迁移，conv=" << conv << ", "
+                 << conn->get_address().to_string() << " -> "
+                 << KCPAddress(addr).to_string());
+    conn->set_address(addr);
+    conn->update_active_time(current);
+    stats_.migrations++;
+
+    // 之前发往旧地址的数据尽快重传到新地址
+    schedule_connection(conn, current);
+    break;
+  }
+
+  default:
+    break;
+  }
+}
+
+/**
+ * 处理HELLO包
+ */
+void KCPServer::handle_hello(const char *data, int len,
+                             const struct sockaddr *addr) {
+  // 不足kHelloSize的HELLO直接忽略：回复不会比请求大，不能被用于反射放大
+  bool has_cookie;
+  uint64_t cookie;
+  if (!KCPControl::decode_hello(data, len, &has_cookie, &cookie)) {
+    return;
+  }
+
+  uint32_t conv = *(uint32_t *)data;
+  char packet[KCPControl::kMaxPacketSize];
+  KCPConnection *conn = connections_.find(conv);
+  if (conn) {
+    // 会话已存在（ACCEPT丢失后客户端重发HELLO），只回复给会话地址
+    if (conn->get_address().equals(addr)) {
+      int n = KCPControl::encode_simple(packet, conv, KCP_CTRL_ACCEPT);
+      send_control(packet, n, addr);
+    }
+    return;
+  }
+
+  uint32_t current = get_current_ms();
+  uint32_t epoch = current / kChallengeEpoch;
+  if (!has_cookie) {
+    // 第一次请求：回复cookie，不保存任何状态
+    int n = KCPControl::encode_value(
+        packet, conv, KCP_CTRL_COOKIE,
+        address_mac(KCP_CTRL_COOKIE, conv, addr, epoch));
+    send_control(packet, n, addr);
+    stats_.cookies_sent++;
+    return;
+  }
+
+  // cookie只在签发给该地址后的一到两个时间片内有效
+  if (cookie != address_mac(KCP_CTRL_COOKIE, conv, addr, epoch) &&
+      cookie != address_mac(KCP_CTRL_COOKIE, conv, addr, epoch - 1)) {
+    stats_.bad_cookies++;
+    return;
+  }
+
+  conn = find_or_create_connection(conv, addr);
+  if (!conn) {
+    return;
+  }
+  int n = KCPControl::encode_simple(packet, conv, KCP_CTRL_ACCEPT);
+  send_control(packet, n, addr);
+  schedule_connection(conn, current);
+}
+
+/**
+ * 是否允许创建新会话
+ */
+bool KCPServer::admit_session(const struct sockaddr *addr, uint32_t current) {
+  if (max_sessions_ > 0 && connections_.size() >= max_sessions_) {
+    return false;
+  }
+  if (accept_rate_ <= 0) {
+    return true;
+  }
+
+  // 所有令牌桶初始为满
+  if (accept_buckets_.empty()) {
+    AcceptBucket full = {(double)accept_burst_, current};
+    accept_buckets_.assign(kAcceptBuckets, full);
+  }
+
+  // 按源IP（不含端口）选择令牌桶，哈希带密钥，无法构造集中到同一个桶的地址
+  uint8_t input[18];
+  size_t n = KCPAddress(addr).serialize(input, false);
+  AcceptBucket &bucket = accept_buckets_[KCPControl::siphash(secret_, input, n) &
+                                         (kAcceptBuckets - 1)];
+
+  // 按经过的时间补充令牌
+  uint32_t elapsed = current - bucket.time;
+  bucket.time = current;
+  bucket.tokens += elapsed * accept_rate_ / 1000.0;
+  if (bucket.tokens > accept_burst_) {
+    bucket.tokens = accept_burst_;
+  }
+  if (bucket.tokens < 1) {
+    return false;
+  }
+  bucket.tokens -= 1;
+  return true;
+}
+
+/**
+ * 校验数据包的来源地址
+ */
+bool KCPServer::check_peer(KCPConnection *conn, const struct sockaddr *addr,
+                           uint32_t current) {
+  if (conn->get_address().equals(addr)) {
+    // 令牌可能丢失，对端确认之前定期重发
+    if (!conn->is_token_confirmed() &&
+        (int32_t)(current - conn->get_control_time()) >=
+            (int32_t)kControlInterval) {
+      issue_token(conn, current);
+    }
+    return true;
+  }
+
+  stats_.drops_unverified++;
+
+  // 对端还没有确认令牌，无法应答挑战
+  if (!conn->is_token_confirmed()) {
+    return false;
+  }
+
+  // 限制挑战频率（挑战包比触发它的数据包短，不会被用于放大攻击）
+  if ((int32_t)(current - conn->get_control_time()) <
+      (int32_t)kControlInterval) {
+    return false;
+  }
+  conn->set_control_time(current);
+
+  char packet[KCPControl::kMaxPacketSize];
+  uint64_t nonce = address_mac(KCP_CTRL_CHALLENGE, conn->get_conv(), addr,
+                               current / kChallengeEpoch);
+  int len = KCPControl::encode_challenge(packet, conn->get_conv(), nonce);
+  send_control(packet, len, addr);
+  stats_.migration_challenges++;
+
+  KCP_LOG_DEBUG("[KCPServer] 来源地址变化，发送挑战，conv=" << conn->get_conv()
+                << ", addr=" << KCPAddress(addr).to_string());
+  return false;
+}
+
+/**
+ * 为新会话生成并下发会话令牌
+ */
+void KCPServer::issue_token(KCPConnection *conn, uint32_t current) {
+  if (!conn->get_session_token()) {
+    // 令牌 = SipHash(密钥, conv + 会话序号 + 分组序号)，两个64位分组组成128位
+    KCPSessionToken token;
+    for (uint32_t part = 0; part < 2; part++) {
+      uint32_t input[3] = {conn->get_conv(), (uint32_t)stats_.sessions_created,
+                           part};
+      uint64_t value = KCPControl::siphash(secret_, input, sizeof(input));
+      memcpy(token.bytes + part * 8, &value, 8);
+    }
+    conn->set_session_token(token);
+  }
+
+  char packet[KCPControl::kMaxPacketSize];
+  int len = KCPControl::encode_token(packet, conn->get_conv(),
+                                     *conn->get_session_token());
+  send_control(packet, len, conn->get_addr());
+  conn->set_control_time(current);
+}
+
+/**
+ * 计算地址绑定的无状态校验值
+ */
+uint64_t KCPServer::address_mac(uint8_t domain, uint32_t conv,
+                                const struct sockaddr *addr,
+                                uint32_t epoch) const {
+  uint8_t input[9 + 18];
+  input[0] = domain;
+  memcpy(input + 1, &conv, 4);
+  memcpy(input + 5, &epoch, 4);
+  size_t len = 9 + KCPAddress(addr).serialize(input + 9);
+  return KCPControl::siphash(secret_, input, len);
+}
+
+/**
+ * 发送控制包
+ */
+void KCPServer::send_control(const char *data, int len,
+                             const struct sockaddr *addr) {
+  send_pool_.send(&udp_handle_, data, len, addr);
+}
+
+/**
+ * 处理一批接收完成的数据
+ */
+void KCPServer::flush_recv_batch() {
+  if (recv_batch_.empty()) {
+    return;
+  }
+
+  uint32_t current = get_current_ms();
+  for (size_t i = 0; i < recv_batch_.size(); i++) {
+    // 连接可能已在前一个连接的回调中被关闭，按conv重新查找
+    KCPConnection *conn = connections_.find(recv_batch_[i]);
+    if (!conn) {
+      continue;
+    }
+
+    // 尝试接收数据
+    conn->recv();
+
+    // 收到数据后需要回复ACK，重新调度
+    if (connections_.find(recv_batch_[i]) == conn) {
+      schedule_connection(conn, current);
+    }
+  }
+  recv_batch_.clear();
+  reap_connections();
+}
+
+/**
+ * 处理投递队列
+ */
+void KCPServer::drain_posted() {
+  stats_.post_wakeups++;
+
+  // 先把所有消息放入各会话的KCP发送队列，再统一flush：
+  // 同一会话的多条消息合并成尽量少的UDP包
+  size_t count = 0;
+  while (count < kMaxPostBatch) {
+    KCPPostedMessage *msg = post_queue_.pop();
+    if (!msg) {
+      break;
+    }
+    count++;
+
+    KCPConnection *conn = connections_.find(msg->conv);
+    if (!conn) {
+      stats_.post_drops_no_session++;
+    } else {
+      int len = (int)msg->data.size();
+      int ret = msg->channel < 0
+                    ? conn->send(msg->data.data(), len)
+                    : conn->send_channel((uint8_t)msg->channel,
+                                         msg->data.data(), len);
+      if (ret < 0) {
+        stats_.post_send_errors++;
+      } else {
+        post_batch_.push_back(msg->conv);
+      }
+    }
+    delete msg;
+  }
+  stats_.posted_messages += count;
+
+  // 达到单次上限时还有剩余消息，在下一次循环迭代继续处理
+  if (count == kMaxPostBatch) {
+    uv_async_send(&post_async_);
+  }
+
+  if (post_batch_.empty()) {
+    return;
+  }
+
+  // 每个会话只flush一次
+  std::sort(post_batch_.begin(), post_batch_.end());
+  post_batch_.erase(std::unique(post_batch_.begin(), post_batch_.end()),
+                    post_batch_.end());
+
+  uint32_t current = get_current_ms();
+  for (size_t i = 0; i < post_batch_.size(); i++) {
+    KCPConnection *conn = connections_.find(post_batch_[i]);
+    if (!conn) {
+      continue;
+    }
+    conn->flush();
+    schedule_connection(conn, current);
+  }
+  post_batch_.clear();
+  reap_connections();
 }
 
 /**
@@ -270,20 +1176,42 @@ KCPConnection *
 KCPServer::find_or_create_connection(uint32_t conv,
                                      const struct sockaddr *addr) {
   // 查找现有连接
-  auto it = connections_.find(conv);
-  if (it != connections_.end()) {
-    return it->second.get();
+  KCPConnection *existing = connections_.find(conv);
+  if (existing) {
+    return existing;
+  }
+
+  // 优雅关闭中、会话上限、源IP限速
+  if (shutting_down_ || !admit_session(addr, get_current_ms())) {
+    stats_.sessions_rejected++;
+    KCP_LOG_DEBUG("[KCPServer] 拒绝创建会话，conv=" << conv << ", addr="
+                  << KCPAddress(addr).to_string());
+    return nullptr;
   }
 
   // 创建新连接
-  std::cout << "[KCPServer] 创建新连接，conv=" << conv << std::endl;
+  KCP_LOG_INFO("[KCPServer] 创建新连接，conv=" << conv << ", addr="
+               << KCPAddress(addr).to_string());
 
-  // 使用智能指针管理连接对象
-  auto conn = std::make_shared<KCPConnection>(conv, &udp_handle_, addr);
+  // 使用智能指针管理连接对象，所有权交给连接表
+  std::unique_ptr<KCPConnection> owned(
+      new KCPConnection(conv, &udp_handle_, addr));
+  KCPConnection *conn = owned.get();
+  conn->set_send_pool(&send_pool_);
 
   // 初始化KCP参数
   conn->init_kcp(kcp_nodelay_, kcp_interval_, kcp_resend_, kcp_nc_, kcp_sndwnd_,
                  kcp_rcvwnd_, kcp_mtu_);
+  conn->set_max_message_size(max_message_size_);
+  conn->set_drain_timeout(drain_timeout_);
+  conn->set_channels(channels_);
+  conn->set_adaptive_tuning(tuning_, tuning_bounds_);
+  conn->set_compression(compression_);
+  conn->set_fec(fec_data_, fec_parity_);
+  conn->set_fec_auto(fec_auto_);
+  conn->set_pmtu_discovery(pmtu_, pmtu_config_);
+  conn->set_send_watermarks(high_packets_, low_packets_, high_bytes_,
+                            low_bytes_);
 
   // 设置连接为已连接状态
   conn->set_state(KCPConnection::CONNECTED);
@@ -300,56 +1228,118 @@ KCPServer::find_or_create_connection(uint32_t conv,
   conn->set_close_callback(
       [this](KCPConnection *c) { this->on_connection_close(c); });
 
-  // 添加到连接映射
-  connections_[conv] = conn;
+  // 有新数据待发送时，在下一个tick处理该连接
+  conn->set_schedule_callback([this](KCPConnection *c) {
+    timer_wheel_.schedule(c->get_conv(), get_current_ms());
+  });
+
+  // 添加到连接表
+  connections_.insert(std::move(owned));
+  stats_.sessions_created++;
+
+  // 下发会话令牌，用于之后的地址验证
+  if (migration_) {
+    issue_token(conn, get_current_ms());
+  }
 
   // 调用新连接回调
   if (new_connection_callback_) {
-    new_connection_callback_(conn.get());
+    new_connection_callback_(conn);
   }
 
-  return conn.get();
+  return conn;
 }
 
 /**
  * 移除连接
  */
 void KCPServer::remove_connection(uint32_t conv) {
-  auto it = connections_.find(conv);
-  if (it != connections_.end()) {
-    std::cout << "[KCPServer] 移除连接，conv=" << conv << std::endl;
-    connections_.erase(it);
+  std::unique_ptr<KCPConnection> conn = connections_.remove(conv);
+  if (conn) {
+    KCP_LOG_INFO("[KCPServer] 移除连接，conv=" << conv);
+    timer_wheel_.cancel(conv);
+    // 累计计数器并入服务器级合计，导出的counter不会因会话关闭而回落
+    add_session_totals(closed_totals_, conn->get_stats());
+    closed_latency_.merge(conn->get_latency_histogram());
+    closed_connections_.push_back(std::move(conn));
+    stats_.sessions_closed++;
   }
 }
 
 /**
- * 更新所有连接
+ * 释放已移除的连接
+ */
+void KCPServer::reap_connections() { closed_connections_.clear(); }
+
+/**
+ * 更新到期的连接
  */
 void KCPServer::update_connections() {
   uint32_t current = get_current_ms();
 
-  // 遍历所有连接
-  // 注意：使用迭代器遍历，因为可能会删除连接
-  for (auto it = connections_.begin(); it != connections_.end();) {
-    auto &conn = it->second;
+  // 推进时间轮，收集截止时间已到的连接
+  expired_convs_.clear();
+  timer_wheel_.advance(current, expired_convs_);
 
-    // 检查连接是否超时
-    if (conn->is_timeout(current, timeout_)) {
-      std::cout << "[KCPServer] 连接超时，conv=" << conn->get_conv()
-                << std::endl;
-      conn->close();
-      it = connections_.erase(it);
-      continue;
-    }
+  for (size_t i = 0; i < expired_convs_.size(); i++) {
+    service_connection(expired_convs_[i], current);
+  }
+  reap_connections();
+  check_shutdown();
 
-    // 更新KCP状态
-    conn->update(current);
+  // 更新调度统计
+  uint32_t serviced = (uint32_t)expired_convs_.size();
+  tick_stats_.ticks++;
+  tick_stats_.serviced_total += serviced;
+  tick_stats_.serviced_last = serviced;
+  if (serviced > tick_stats_.serviced_max) {
+    tick_stats_.serviced_max = serviced;
+  }
+}
 
-    // 尝试接收数据
-    conn->recv();
+/**
+ * 处理单个到期连接
+ */
+bool KCPServer::service_connection(uint32_t conv, uint32_t current) {
+  KCPConnection *conn = connections_.find(conv);
+  if (!conn) {
+    return false;
+  }
+
+  // 检查连接是否超时
+  if (conn->is_timeout(current, timeout_)) {
+    KCP_LOG_INFO("[KCPServer] 连接超时，conv=" << conv);
+    stats_.sessions_timed_out++;
+    // 先从连接表中移除（延迟释放），再关闭，避免关闭回调中重复移除
+    // 对端已无响应，不再排空发送队列
+    remove_connection(conv);
+    conn->abort();
+    return false;
+  }
+
+  // 更新KCP状态
+  conn->update(current);
+
+  // 尝试接收数据
+  conn->recv();
 
-    ++it;
+  // 连接可能在回调中被关闭（对象延迟释放，指针仍然有效）
+  if (connections_.find(conv) != conn) {
+    return false;
   }
+
+  schedule_connection(conn, current);
+  return true;
+}
+
+/**
+ * 根据连接的下次update时间将其加入时间轮
+ */
+void KCPServer::schedule_connection(KCPConnection *conn, uint32_t current) {
+  // is_timeout使用 > timeout 判断，超时截止时间需要再加1ms
+  uint32_t idle_deadline = conn->get_active_time() + timeout_ + 1;
+  timer_wheel_.schedule(conn->get_conv(),
+                        conn->next_update_time(current, idle_deadline));
 }
 
 /**
@@ -357,9 +1347,8 @@ void KCPServer::update_connections() {
  */
 void KCPServer::on_connection_data(KCPConnection *conn, const char *data,
                                    int len) {
-  std::cout << "[KCPServer] 收到数据，conv=" << conn->get_conv()
-            << ", len=" << len << ", data=" << std::string(data, len)
-            << std::endl;
+  KCP_LOG_TRACE("[KCPServer] 收到数据，conv=" << conn->get_conv() << ", len="
+                << len << ", data=" << std::string(data, len));
 
   // 这里可以处理接收到的数据
   // 示例：回显数据
@@ -370,6 +1359,6 @@ void KCPServer::on_connection_data(KCPConnection *conn, const char *data,
  * 连接关闭回调
  */
 void KCPServer::on_connection_close(KCPConnection *conn) {
-  std::cout << "[KCPServer] 连接关闭，conv=" << conn->get_conv() << std::endl;
+  KCP_LOG_INFO("[KCPServer] 连接关闭，conv=" << conn->get_conv());
   remove_connection(conn->get_conv());
 }
@@ -0,0 +1,243 @@
+#include "kcp_server_cluster.h"
+#include "kcp_log.h"
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/filter.h>
+#include <sys/socket.h>
+#endif
+
+/**
+ * 构造函数实现
+ */
+KCPServerCluster::KCPServerCluster(int threads)
+    : thread_count_(threads > 0 ? threads : 1), conv_routing_(true),
+      running_(false), conv_routed_(false) {
+  KCP_LOG_INFO("[KCPServerCluster] 集群已创建，threads=" << thread_count_);
+}
+
+/**
+ * 析构函数实现
+ */
+KCPServerCluster::~KCPServerCluster() {
+  stop();
+  KCP_LOG_INFO("[KCPServerCluster] 集群已销毁");
+}
+
+/**
+ * 绑定并启动所有工作线程
+ */
+int KCPServerCluster::start(const std::string &ip, int port) {
+  if (running_) {
+    KCP_LOG_ERROR("[KCPServerCluster] 集群已经启动");
+    return -1;
+  }
+
+  // 在调用线程中依次创建并绑定所有分片
+  // reuseport组内socket的顺序与绑定顺序一致，CBPF返回的下标即分片编号
+  for (int i = 0; i < thread_count_; i++) {
+    std::unique_ptr<Worker> worker(new Worker);
+    worker->index = i;
+
+    int ret = uv_loop_init(&worker->loop);
+    if (ret < 0) {
+      KCP_LOG_ERROR("[KCPServerCluster] 初始化事件循环失败: " << uv_strerror(ret));
+      for (auto &w : workers_) {
+        close_worker_loop(w.get());
+      }
+      workers_.clear();
+      return ret;
+    }
+
+    worker->server.reset(new KCPServer(&worker->loop));
+    worker->server->set_reuseport(true);
+    if (shard_init_callback_) {
+      shard_init_callback_(worker->server.get(), i);
+    }
+    if (new_connection_callback_) {
+      worker->server->set_new_connection_callback(new_connection_callback_);
+    }
+
+    uv_async_init(&worker->loop, &worker->stop_async, on_stop_async);
+    worker->stop_async.data = worker.get();
+
+    ret = worker->server->bind_and_listen(ip, port);
+    if (ret < 0) {
+      KCP_LOG_ERROR("[KCPServerCluster] 分片" << i << "绑定失败: "
+                    << uv_strerror(ret));
+      close_worker_loop(worker.get());
+      for (auto &w : workers_) {
+        close_worker_loop(w.get());
+      }
+      workers_.clear();
+      return ret;
+    }
+
+    workers_.push_back(std::move(worker));
+  }
+
+  // 挂载按conv路由的CBPF程序（挂载到组内任意一个socket即对整个组生效）
+  conv_routed_ = thread_count_ == 1;
+  if (conv_routing_ && thread_count_ > 1) {
+    int ret = attach_conv_router(workers_[0]->server->get_socket_fd());
+    if (ret < 0) {
+      KCP_LOG_WARN("[KCPServerCluster] 挂载conv路由失败，退化为四元组哈希: "
+                   << uv_strerror(ret));
+    } else {
+      conv_routed_ = true;
+    }
+  }
+
+  // 启动工作线程，每个线程运行自己的事件循环
+  for (auto &w : workers_) {
+    Worker *worker = w.get();
+    worker->thread = std::thread([worker]() { worker->server->run(); });
+  }
+
+  running_ = true;
+  KCP_LOG_INFO("[KCPServerCluster] 集群已启动，监听 " << ip << ":" << port
+               << ", threads=" << thread_count_);
+  return 0;
+}
+
+/**
+ * 停止所有工作线程
+ */
+void KCPServerCluster::stop() {
+  if (!running_) {
+    return;
+  }
+
+  running_ = false;
+
+  // 通知每个工作线程停止（uv_async_send是libuv中唯一线程安全的接口）
+  for (auto &w : workers_) {
+    uv_async_send(&w->stop_async);
+  }
+
+  for (auto &w : workers_) {
+    if (w->thread.joinable()) {
+      w->thread.join();
+    }
+    close_worker_loop(w.get());
+  }
+  workers_.clear();
+
+  KCP_LOG_INFO("[KCPServerCluster] 集群已停止");
+}
+
+/**
+ * 获取分片服务器
+ */
+KCPServer *KCPServerCluster::get_server(int shard) const {
+  if (shard < 0 || shard >= (int)workers_.size()) {
+    return nullptr;
+  }
+  return workers_[shard]->server.get();
+}
+
+/**
+ * 投递消息到会话所属的分片
+ */
+int KCPServerCluster::post_send(uint32_t conv, std::vector<char> &&data) {
+  if (!running_) {
+    return -1;
+  }
+  if (!conv_routed_) {
+    return UV_ENOTSUP;
+  }
+  int shard = shard_for_conv(conv, (int)workers_.size());
+  return workers_[shard]->server->post_send(conv, std::move(data));
+}
+
+/**
+ * 投递消息到会话所属分片的指定通道
+ */
+int KCPServerCluster::post_send_channel(uint32_t conv, uint8_t channel,
+                                        std::vector<char> &&data) {
+  if (!running_) {
+    return -1;
+  }
+  if (!conv_routed_) {
+    return UV_ENOTSUP;
+  }
+  int shard = shard_for_conv(conv, (int)workers_.size());
+  return workers_[shard]->server->post_send_channel(conv, channel,
+                                                    std::move(data));
+}
+
+/**
+ * 计算conv所属的分片编号
+ */
+int KCPServerCluster::shard_for_conv(uint32_t conv, int shards) {
+  if (shards <= 1) {
+    return 0;
+  }
+
+  // conv在报文中是小端序，BPF_LD按网络字节序（大端）读取，结果为字节翻转后的值
+  uint32_t loaded = ((conv & 0xff) << 24) | ((conv & 0xff00) << 8) |
+                    ((conv >> 8) & 0xff00) | (conv >> 24);
+  return (int)(loaded % (uint32_t)shards);
+}
+
+/**
+ * 挂载按conv路由的CBPF程序
+ */
+int KCPServerCluster::attach_conv_router(int fd) {
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+  if (fd < 0) {
+    return UV_EBADF;
+  }
+
+  // 程序在UDP负载上执行（内核已跳过UDP头）：
+  // A = payload[0..3]（网络字节序）; A = A % shards; return A
+  // 返回值即reuseport组内socket的下标；数据报不足4字节时返回0
+  struct sock_filter code[] = {
+      {BPF_LD | BPF_W | BPF_ABS, 0, 0, 0},
+      {BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)thread_count_},
+      {BPF_RET | BPF_A, 0, 0, 0},
+  };
+  struct sock_fprog prog;
+  prog.len = sizeof(code) / sizeof(code[0]);
+  prog.filter = code;
+
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+                 sizeof(prog)) < 0) {
+    return -errno;
+  }
+  return 0;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+/**
+ * 停止通知回调函数
+ */
+void KCPServerCluster::on_stop_async(uv_async_t *handle) {
+  Worker *worker = (Worker *)handle->data;
+  worker->server->stop();
+}
+
+/**
+ * 关闭工作线程的所有句柄并释放事件循环
+ * 必须在工作线程退出后调用
+ */
+void KCPServerCluster::close_worker_loop(Worker *worker) {
+  worker->server->stop();
+
+  uv_walk(
+      &worker->loop,
+      [](uv_handle_t *handle, void *arg) {
+        if (!uv_is_closing(handle)) {
+          uv_close(handle, nullptr);
+        }
+      },
+      nullptr);
+
+  // 处理关闭回调（包括被取消的发送请求，发送池此时仍然有效）
+  uv_run(&worker->loop, UV_RUN_DEFAULT);
+  uv_loop_close(&worker->loop);
+
+  worker->server.reset();
+}
@@ -0,0 +1,127 @@
+#include "kcp_timer_wheel.h"
+
+/**
+ * 时间差计算（考虑时间戳溢出）
+ * 与KCP内部的_itimediff保持一致
+ */
+static inline int32_t time_diff(uint32_t later, uint32_t earlier) {
+  return (int32_t)(later - earlier);
+}
+
+/**
+ * 构造函数实现
+ */
+KCPTimerWheel::KCPTimerWheel(uint32_t granularity, uint32_t slots)
+    : granularity_(granularity > 0 ? granularity : 1), next_tick_(0),
+      next_tick_time_(0), slots_(slots > 0 ? slots : 1) {}
+
+/**
+ * 重置时间轮
+ */
+void KCPTimerWheel::reset(uint32_t current, uint32_t granularity) {
+  granularity_ = granularity > 0 ? granularity : 1;
+  next_tick_ = 0;
+  next_tick_time_ = current;
+  for (auto &slot : slots_) {
+    slot.clear();
+  }
+  pending_.clear();
+}
+
+/**
+ * 计算截止时间所在的槽位
+ * 已经过期的截止时间放入下一个待处理的槽位
+ */
+uint32_t KCPTimerWheel::slot_of(uint32_t deadline) const {
+  int32_t diff = time_diff(deadline, next_tick_time_);
+  uint32_t offset = diff > 0 ? (uint32_t)diff / granularity_ : 0;
+  return (uint32_t)((next_tick_ + offset) % slots_.size());
+}
+
+/**
+ * 调度连接
+ */
+void KCPTimerWheel::schedule(uint32_t conv, uint32_t deadline) {
+  auto it = pending_.find(conv);
+  if (it != pending_.end()) {
+    // 已有更早的截止时间，无需重复调度
+    if (time_diff(it->second, deadline) <= 0) {
+      return;
+    }
+    // 旧的调度项在槽位中延迟删除
+    it->second = deadline;
+  } else {
+    pending_[conv] = deadline;
+  }
+
+  Entry entry = {conv, deadline};
+  slots_[slot_of(deadline)].push_back(entry);
+}
+
+/**
+ * 取消连接的调度
+ */
+void KCPTimerWheel::cancel(uint32_t conv) { pending_.erase(conv); }
+
+/**
+ * 推进时间轮
+ */
+void KCPTimerWheel::advance(uint32_t current,
+                            std::vector<uint32_t> &expired) {
+  uint32_t processed = 0;
+
+  while (time_diff(current, next_tick_time_) >= 0) {
+    // 落后超过一圈（事件循环长时间阻塞），整体重建时间轮
+    if (processed >= slots_.size()) {
+      rebuild(current, expired);
+      return;
+    }
+
+    std::vector<Entry> &slot = slots_[next_tick_];
+    size_t keep = 0;
+    for (size_t i = 0; i < slot.size(); i++) {
+      const Entry &entry = slot[i];
+      auto it = pending_.find(entry.conv);
+      if (it == pending_.end() || it->second != entry.deadline) {
+        // 已取消或已被更早的截止时间替代
+        continue;
+      }
+      // 截止时间落在本tick内即视为到期（精度为一个粒度）
+      if (time_diff(entry.deadline, next_tick_time_) < (int32_t)granularity_) {
+        pending_.erase(it);
+        expired.push_back(entry.conv);
+        continue;
+      }
+      // 属于后续轮次，保留在槽位中
+      slot[keep++] = entry;
+    }
+    slot.resize(keep);
+
+    next_tick_ = (next_tick_ + 1) % slots_.size();
+    next_tick_time_ += granularity_;
+    processed++;
+  }
+}
+
+/**
+ * 重建时间轮
+ * 收集所有已到期的连接，其余调度项按新的起始时间重新放入槽位
+ */
+void KCPTimerWheel::rebuild(uint32_t current, std::vector<uint32_t> &expired) {
+  next_tick_ = 0;
+  next_tick_time_ = current + granularity_;
+  for (auto &slot : slots_) {
+    slot.clear();
+  }
+
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    if (time_diff(it->second, current) < (int32_t)granularity_) {
+      expired.push_back(it->first);
+      it = pending_.erase(it);
+      continue;
+    }
+    Entry entry = {it->first, it->second};
+    slots_[slot_of(it->second)].push_back(entry);
+    ++it;
+  }
+}
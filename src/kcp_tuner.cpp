@@ -0,0 +1,115 @@
+#include "kcp_tuner.h"
+
+/**
+ * 将值限制在[lo, hi]范围内
+ */
+template <typename T> static T clamp_value(T value, T lo, T hi) {
+  return value < lo ? lo : (value > hi ? hi : value);
+}
+
+/**
+ * 构造函数实现
+ */
+KCPAdaptiveTuner::KCPAdaptiveTuner(const Bounds &bounds)
+    : bounds_(bounds), started_(false), next_sample_(0), last_snd_nxt_(0),
+      last_retrans_(0), min_rtt_(0), loss_ratio_(0), adjustments_(0) {
+  if (bounds_.min_interval < 10) {
+    bounds_.min_interval = 10;
+  }
+  if (bounds_.max_interval < bounds_.min_interval) {
+    bounds_.max_interval = bounds_.min_interval;
+  }
+  if (bounds_.min_wnd < 1) {
+    bounds_.min_wnd = 1;
+  }
+  if (bounds_.max_wnd < bounds_.min_wnd) {
+    bounds_.max_wnd = bounds_.min_wnd;
+  }
+  if (bounds_.max_minrto < bounds_.min_minrto) {
+    bounds_.max_minrto = bounds_.min_minrto;
+  }
+  if (bounds_.min_fastresend < 1) {
+    bounds_.min_fastresend = 1;
+  }
+  if (bounds_.max_fastresend < bounds_.min_fastresend) {
+    bounds_.max_fastresend = bounds_.min_fastresend;
+  }
+}
+
+/**
+ * 采样并调整参数
+ */
+bool KCPAdaptiveTuner::sample(ikcpcb *kcp, uint32_t current) {
+  uint32_t retrans_total = kcp->xmit + kcp->fastxmit;
+  if (!started_) {
+    started_ = true;
+    next_sample_ = current + bounds_.sample_interval;
+    last_snd_nxt_ = kcp->snd_nxt;
+    last_retrans_ = retrans_total;
+    return false;
+  }
+  if ((int32_t)(current - next_sample_) < 0) {
+    return false;
+  }
+  next_sample_ = current + bounds_.sample_interval;
+
+  uint32_t sent = kcp->snd_nxt - last_snd_nxt_;
+  uint32_t retrans = retrans_total - last_retrans_;
+  last_snd_nxt_ = kcp->snd_nxt;
+  last_retrans_ = retrans_total;
+
+  // 周期内没有发送数据或还没有RTT样本时保持原参数
+  if (sent + retrans == 0 || kcp->rx_srtt <= 0) {
+    return false;
+  }
+  loss_ratio_ = (double)retrans / (double)(sent + retrans);
+  bool lossy = loss_ratio_ > bounds_.high_loss;
+  bool clean = loss_ratio_ < bounds_.low_loss;
+  uint32_t srtt = (uint32_t)kcp->rx_srtt;
+  if (min_rtt_ == 0 || srtt < min_rtt_) {
+    min_rtt_ = srtt;
+  }
+  bool congested = srtt > min_rtt_ * bounds_.congestion_rtt;
+
+  // 发送窗口：被占满且链路干净时放大1.5倍，拥塞丢包时缩小到3/4
+  uint32_t wnd = kcp->snd_wnd;
+  if (lossy && congested) {
+    wnd = wnd * 3 / 4;
+  } else if (clean && kcp->nsnd_buf >= kcp->snd_wnd * 3 / 4) {
+    wnd = wnd + wnd / 2 + 1;
+  }
+  wnd = clamp_value(wnd, bounds_.min_wnd, bounds_.max_wnd);
+
+  // update间隔：约为srtt的1/8，一个RTT内flush多次，不明显增加延迟
+  uint32_t interval =
+      clamp_value(srtt / 8, bounds_.min_interval, bounds_.max_interval);
+
+  // 最小RTO：有损时取下限，干净时回到srtt附近
+  uint32_t minrto = (uint32_t)kcp->rx_minrto;
+  if (lossy) {
+    minrto = bounds_.min_minrto;
+  } else if (clean) {
+    minrto = srtt;
+  }
+  minrto = clamp_value(minrto, bounds_.min_minrto, bounds_.max_minrto);
+
+  // 快速重传阈值：每个周期最多调整1
+  int fastresend = kcp->fastresend;
+  if (lossy) {
+    fastresend--;
+  } else if (clean) {
+    fastresend++;
+  }
+  fastresend =
+      clamp_value(fastresend, bounds_.min_fastresend, bounds_.max_fastresend);
+
+  if (wnd == kcp->snd_wnd && interval == kcp->interval &&
+      (IINT32)minrto == kcp->rx_minrto && fastresend == kcp->fastresend) {
+    return false;
+  }
+  ikcp_wndsize(kcp, (int)wnd, 0);
+  ikcp_nodelay(kcp, -1, (int)interval, fastresend, -1);
+  kcp->rx_minrto = (IINT32)minrto;
+  adjustments_++;
+  return true;
+}
@@ -16,6 +16,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <limits.h>
 
 #define IKCP_FASTACK_CONSERVE
 
@@ -290,6 +291,10 @@ ikcpcb* ikcp_create(IUINT32 conv, void *user)
 	kcp->dead_link = IKCP_DEADLINK;
 	kcp->output = NULL;
 	kcp->writelog = NULL;
+	kcp->fastxmit = 0;
+	kcp->probexmit = 0;
+	kcp->deadxmit = 0;
+	kcp->onevent = NULL;
 
 	return kcp;
 }
@@ -463,17 +468,72 @@ int ikcp_peeksize(const ikcpcb *kcp)
 }
 
 
+//---------------------------------------------------------------------
+// scatter-gather cursor: copy bytes from a list of source buffers
+//---------------------------------------------------------------------
+typedef struct
+{
+	const char * const *bufs;
+	const int *lens;
+	int count;
+	int index;
+	int offset;
+}	IKCPGATHER;
+
+static void ikcp_gather(IKCPGATHER *g, char *dst, int size)
+{
+	while (size > 0 && g->index < g->count) {
+		int avail = g->lens[g->index] - g->offset;
+		int chunk = (size < avail)? size : avail;
+		if (chunk > 0) {
+			if (g->bufs[g->index] && dst) {
+				memcpy(dst, g->bufs[g->index] + g->offset, chunk);
+			}
+			if (dst) dst += chunk;
+			g->offset += chunk;
+			size -= chunk;
+		}
+		if (g->offset >= g->lens[g->index]) {
+			g->index++;
+			g->offset = 0;
+		}
+	}
+}
+
+
 //---------------------------------------------------------------------
 // user/upper level send, returns below zero for error
 //---------------------------------------------------------------------
 int ikcp_send(ikcpcb *kcp, const char *buffer, int len)
+{
+	return ikcp_sendv(kcp, &buffer, &len, 1);
+}
+
+
+//---------------------------------------------------------------------
+// scatter-gather send, returns below zero for error
+//---------------------------------------------------------------------
+int ikcp_sendv(ikcpcb *kcp, const char * const *bufs, const int *lens, int n)
 {
 	IKCPSEG *seg;
+	IKCPGATHER gather;
 	int count, i;
 	int sent = 0;
+	int len = 0;
 
 	assert(kcp->mss > 0);
-	if (len < 0) return -1;
+	if (n < 0) return -1;
+
+	for (i = 0; i < n; i++) {
+		if (lens[i] < 0 || lens[i] > INT_MAX - len) return -1;
+		len += lens[i];
+	}
+
+	gather.bufs = bufs;
+	gather.lens = lens;
+	gather.count = n;
+	gather.index = 0;
+	gather.offset = 0;
 
 	// append to previous segment in streaming mode (if possible)
 	if (kcp->stream != 0) {
@@ -489,10 +549,7 @@ int ikcp_send(ikcpcb *kcp, const char *buffer, int len)
 				}
 				iqueue_add_tail(&seg->node, &kcp->snd_queue);
 				memcpy(seg->data, old->data, old->len);
-				if (buffer) {
-					memcpy(seg->data + old->len, buffer, extend);
-					buffer += extend;
-				}
+				ikcp_gather(&gather, seg->data + old->len, extend);
 				seg->len = old->len + extend;
 				seg->frg = 0;
 				len -= extend;
@@ -525,17 +582,14 @@ int ikcp_send(ikcpcb *kcp, const char *buffer, int len)
 		if (seg == NULL) {
 			return -2;
 		}
-		if (buffer && len > 0) {
-			memcpy(seg->data, buffer, size);
+		if (len > 0) {
+			ikcp_gather(&gather, seg->data, size);
 		}
 		seg->len = size;
 		seg->frg = (kcp->stream == 0)? (count - i - 1) : 0;
 		iqueue_init(&seg->node);
 		iqueue_add_tail(&seg->node, &kcp->snd_queue);
 		kcp->nsnd_que++;
-		if (buffer) {
-			buffer += size;
-		}
 		len -= size;
 		sent += size;
 	}
@@ -999,6 +1053,11 @@ void ikcp_flush(ikcpcb *kcp)
 	// flush window probing commands
 	if (kcp->probe & IKCP_ASK_SEND) {
 		seg.cmd = IKCP_CMD_WASK;
+		kcp->probexmit++;
+		if (kcp->onevent) {
+			kcp->onevent(IKCP_EVENT_WND_PROBE, 0, 0, kcp->probe_wait,
+				kcp, kcp->user);
+		}
 		size = (int)(ptr - buffer);
 		if (size + (int)IKCP_OVERHEAD > (int)kcp->mtu) {
 			ikcp_output(kcp, buffer, size);
@@ -1075,6 +1134,10 @@ void ikcp_flush(ikcpcb *kcp)
 			}
 			segment->resendts = current + segment->rto;
 			lost = 1;
+			if (kcp->onevent) {
+				kcp->onevent(IKCP_EVENT_RTO_RETRANS, segment->sn,
+					segment->xmit, segment->rto, kcp, kcp->user);
+			}
 		}
 		else if (segment->fastack >= resent) {
 			if ((int)segment->xmit <= kcp->fastlimit || 
@@ -1084,6 +1147,11 @@ void ikcp_flush(ikcpcb *kcp)
 				segment->fastack = 0;
 				segment->resendts = current + segment->rto;
 				change++;
+				kcp->fastxmit++;
+				if (kcp->onevent) {
+					kcp->onevent(IKCP_EVENT_FAST_RETRANS, segment->sn,
+						segment->xmit, segment->rto, kcp, kcp->user);
+				}
 			}
 		}
 
@@ -1109,6 +1177,13 @@ void ikcp_flush(ikcpcb *kcp)
 			}
 
 			if (segment->xmit >= kcp->dead_link) {
+				if (kcp->state != (IUINT32)-1) {
+					kcp->deadxmit++;
+					if (kcp->onevent) {
+						kcp->onevent(IKCP_EVENT_DEAD_LINK, segment->sn,
+							segment->xmit, segment->rto, kcp, kcp->user);
+					}
+				}
 				kcp->state = (IUINT32)-1;
 			}
 		}
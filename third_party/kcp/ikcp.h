@@ -314,6 +314,9 @@ struct IKCPCB
 	int logmask;
 	int (*output)(const char *buf, int len, struct IKCPCB *kcp, void *user);
 	void (*writelog)(const char *log, struct IKCPCB *kcp, void *user);
+	IUINT32 fastxmit, probexmit, deadxmit;
+	void (*onevent)(int event, IUINT32 sn, IUINT32 xmit, IUINT32 rto,
+		struct IKCPCB *kcp, void *user);
 };
 
 
@@ -332,6 +335,13 @@ typedef struct IKCPCB ikcpcb;
 #define IKCP_LOG_OUT_PROBE		1024
 #define IKCP_LOG_OUT_WINS		2048
 
+// structured events raised from ikcp_flush: counters are always updated
+// (xmit / fastxmit / probexmit / deadxmit), kcp->onevent is called if set
+#define IKCP_EVENT_RTO_RETRANS	1	// segment resent after its rto expired
+#define IKCP_EVENT_FAST_RETRANS	2	// segment resent after fastresend acks skipped it
+#define IKCP_EVENT_WND_PROBE	3	// window probe (IKCP_CMD_WASK) sent, rto=probe_wait
+#define IKCP_EVENT_DEAD_LINK	4	// segment reached dead_link transmissions
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -358,6 +368,10 @@ int ikcp_recv(ikcpcb *kcp, char *buffer, int len);
 // user/upper level send, returns below zero for error
 int ikcp_send(ikcpcb *kcp, const char *buffer, int len);
 
+// scatter-gather send: sends bufs[0..count) as one message, fragmenting
+// directly from the source buffers (no concatenation), same return as ikcp_send
+int ikcp_sendv(ikcpcb *kcp, const char * const *bufs, const int *lens, int count);
+
 // update state (call it repeatedly, every 10ms-100ms), or you can ask 
 // ikcp_check when to call it again (without ikcp_input/_send calling).
 // 'current' - current timestamp in millisec. 